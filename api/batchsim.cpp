@@ -0,0 +1,153 @@
+#ifdef HAVE_CONFIG_H
+#include <sys_config.h>
+#endif
+
+#include <api/mgsim.h>
+
+#include <iostream>
+#include <cstdlib>
+
+#include <argp.h>
+
+using namespace Simulator;
+using namespace std;
+
+// mgsim-batch: run many programs as independent simulations in one
+// process, using the embedding API.
+
+struct BatchConfig
+{
+    string          m_configFile;
+    ConfigMap       m_overrides;
+    vector<string>  m_printvars;
+    vector<string>  m_programs;
+    unsigned        m_threads;
+    uint64_t        m_maxCycles;
+
+    BatchConfig()
+        : m_configFile(MGSIM_CONFIG_PATH),
+          m_overrides(),
+          m_printvars(),
+          m_programs(),
+          m_threads(0),
+          m_maxCycles(0)
+    {
+        const char *v = getenv("MGSIM_BASE_CONFIG");
+        if (v != nullptr)
+            m_configFile = v;
+    }
+};
+
+extern "C"
+{
+const char *argp_program_version =
+    "mgsim-batch " PACKAGE_VERSION "\n"
+    "Copyright (C) 2008-2015 the MGSim project.";
+
+const char *argp_program_bug_address =
+    PACKAGE_BUGREPORT;
+}
+
+static const char *batch_doc =
+    "This program runs each PROGRAM in a separate simulated system, "
+    "using several host threads, and prints a summary of the runs."
+    "\v"
+    "All the systems use the same configuration. The output of the "
+    "programs is interleaved; use per-system files for the I/O devices "
+    "if this matters."
+    "\n\n"
+    "If argument -c is not specified, the base configuration file "
+    "is taken from environment variable MGSIM_BASE_CONFIG if set, "
+    "otherwise from " MGSIM_CONFIG_PATH ".";
+
+static const struct argp_option batch_options[] =
+{
+    { "config", 'c', "FILE", 0, "Read default configuration from FILE.", 1 },
+    { "override", 'o', "NAME=VAL", 0, "Add override option NAME with value VAL. Can be specified multiple times.", 1 },
+    { "jobs", 'j', "N", 0, "Use N host threads (default: one per host CPU).", 2 },
+    { "max-cycles", 'x', "N", 0, "Stop each simulation after N master cycles.", 2 },
+    { "print-final-mvars", 'p', "PATTERN", 0, "Print the value of all monitoring variables matching PATTERN. Can be specified multiple times.", 3 },
+    { 0, 0, 0, 0, 0, 0 }
+};
+
+static error_t batch_parse_opt(int key, char *arg, struct argp_state *state)
+{
+    BatchConfig &config = *(BatchConfig*)state->input;
+
+    switch (key)
+    {
+    case 'c': config.m_configFile = arg; break;
+    case 'j': config.m_threads = strtoul(arg, 0, 0); break;
+    case 'x': config.m_maxCycles = strtoull(arg, 0, 0); break;
+    case 'p': config.m_printvars.push_back(arg); break;
+    case 'o':
+    {
+        string sarg = arg;
+        string::size_type eq = sarg.find_first_of("=");
+        if (eq == string::npos)
+            argp_error(state, "malformed configuration override syntax: %s", arg);
+        config.m_overrides.append(sarg.substr(0, eq), sarg.substr(eq + 1));
+    }
+    break;
+    case ARGP_KEY_ARG: config.m_programs.push_back(arg); break;
+    case ARGP_KEY_NO_ARGS: argp_usage(state); break;
+    default:
+        return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+static struct argp argp = {
+    batch_options, batch_parse_opt, "PROGRAM...", batch_doc, NULL, NULL, NULL
+};
+
+int main(int argc, char** argv)
+{
+    BatchConfig flags;
+    argp_parse(&argp, argc, argv, 0, 0, &flags);
+
+    vector<SimulationSpec> specs(flags.m_programs.size());
+    try
+    {
+        ConfigMap base_config;
+        LoadConfigFile(base_config, flags.m_configFile);
+        for (size_t i = 0; i < specs.size(); ++i)
+        {
+            specs[i].config     = base_config;
+            specs[i].overrides  = flags.m_overrides;
+            specs[i].argv.push_back(flags.m_programs[i]);
+            specs[i].variables  = flags.m_printvars;
+            specs[i].max_cycles = flags.m_maxCycles;
+        }
+    }
+    catch (const exception& e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    vector<SimulationResult> results = RunSimulations(specs, flags.m_threads);
+
+    int status = 0;
+    cout << "### begin batch results" << endl
+         << "# program\tstatus\texit\tcycles\tinstructions\tflops" << endl;
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const SimulationResult& r = results[i];
+        cout << flags.m_programs[i] << '\t'
+             << (!r.error.empty() ? "error" : r.completed ? "done" : "stopped") << '\t'
+             << r.exit_code << '\t'
+             << r.master_cycles << '\t'
+             << r.instructions << '\t'
+             << r.flops << endl;
+        for (auto& v : r.variables)
+            cout << "#   " << v.first << " = " << v.second << endl;
+        if (!r.error.empty())
+        {
+            cout << "#   " << r.error << endl;
+            status = 1;
+        }
+    }
+    cout << "### end batch results" << endl;
+    return status;
+}
@@ -0,0 +1,165 @@
+#include <api/mgsim.h>
+#include <arch/MGSystem.h>
+#include <arch/dev/Selector.h>
+#include <sim/config.h>
+#include <sim/configparser.h>
+#include <sim/readfile.h>
+
+#include <atomic>
+#include <sstream>
+#include <thread>
+
+#ifdef STATIC_KERNEL
+#error The embedding API needs one kernel per system; build it without STATIC_KERNEL.
+#endif
+
+using namespace std;
+
+namespace Simulator
+{
+    void LoadConfigFile(ConfigMap& config, const string& filename)
+    {
+        ConfigParser parser(config);
+        try {
+            parser(read_file(filename));
+        } catch (runtime_error& e) {
+            throw runtime_error("Error reading configuration file: " + filename + "\n" + e.what());
+        }
+    }
+
+    // The defaults of the API come first, so that the overrides of
+    // the specification take precedence. SDL can only be used by one
+    // system per process, so it must be enabled explicitly.
+    static ConfigMap MakeOverrides(const SimulationSpec& spec)
+    {
+        ConfigMap overrides;
+        overrides.append("*.ROMVerboseLoad", "false");
+        overrides.append("*:GfxEnableSDLOutput", "false");
+        for (auto& i : spec.overrides)
+            overrides.append(i.first, i.second);
+        return overrides;
+    }
+
+    struct Simulation::Impl
+    {
+        Config         config;
+        MGSystem       system;
+        vector<string> variables;
+        CycleNo        max_cycles;
+
+        Impl(const SimulationSpec& spec)
+            : config(spec.config, MakeOverrides(spec), spec.argv),
+              system(config, true),
+              variables(spec.variables),
+              max_cycles(spec.max_cycles == 0 ? INFINITE_CYCLES : spec.max_cycles)
+        {}
+
+        void Collect(SimulationResult& result) const;
+    };
+
+    void Simulation::Impl::Collect(SimulationResult& result) const
+    {
+        const Kernel& kernel = *system.GetKernel();
+        result.master_cycles = kernel.GetCycleNo();
+        result.instructions  = system.GetOp();
+        result.flops         = system.GetFlop();
+
+        ostringstream stats;
+        system.PrintAllStatistics(stats);
+        result.statistics = stats.str();
+
+        // The variables are rendered as "name = value" lines.
+        for (auto& pat : variables)
+        {
+            ostringstream os;
+            kernel.GetVariableRegistry().RenderVariables(os, pat, false);
+            istringstream is(os.str());
+            string line;
+            while (getline(is, line))
+            {
+                size_t eq = line.find(" =");
+                if (eq == string::npos)
+                    continue;
+                size_t val = line.find_first_not_of(' ', eq + 2);
+                result.variables[line.substr(0, eq)] = (val == string::npos) ? string() : line.substr(val);
+            }
+        }
+    }
+
+    Simulation::Simulation(const SimulationSpec& spec)
+        : m_impl(new Impl(spec))
+    {
+    }
+
+    Simulation::~Simulation()
+    {
+    }
+
+    MGSystem& Simulation::GetSystem()
+    {
+        return m_impl->system;
+    }
+
+    SimulationResult Simulation::Run()
+    {
+        SimulationResult result;
+        MGSystem& system = m_impl->system;
+
+        // The selector sets/resets O_NONBLOCK on all monitored fds.
+        system.GetSelector().Enable();
+        try
+        {
+            result.completed = (system.Step(m_impl->max_cycles) == STATE_IDLE);
+        }
+        catch (const ProgramTerminationException& e)
+        {
+            result.completed = true;
+            result.exit_code = e.GetExitCode();
+            if (e.TerminateWithAbort())
+                result.error = e.what();
+        }
+        catch (const exception& e)
+        {
+            result.error = e.what();
+        }
+        system.GetSelector().Disable();
+
+        m_impl->Collect(result);
+        return result;
+    }
+
+    vector<SimulationResult> RunSimulations(const vector<SimulationSpec>& specs, unsigned nthreads)
+    {
+        vector<SimulationResult> results(specs.size());
+        atomic<size_t> next(0);
+
+        auto worker = [&]()
+        {
+            for (size_t i; (i = next++) < specs.size(); )
+            {
+                try
+                {
+                    Simulation sim(specs[i]);
+                    results[i] = sim.Run();
+                }
+                catch (const exception& e)
+                {
+                    results[i].error = e.what();
+                }
+            }
+        };
+
+        if (nthreads == 0)
+            nthreads = max(1u, thread::hardware_concurrency());
+        nthreads = min<size_t>(nthreads, specs.size());
+
+        vector<thread> threads;
+        for (unsigned t = 1; t < nthreads; ++t)
+            threads.emplace_back(worker);
+        worker();
+        for (auto& t : threads)
+            t.join();
+
+        return results;
+    }
+}
@@ -0,0 +1,101 @@
+// -*- c++ -*-
+#ifndef MGSIM_API_H
+#define MGSIM_API_H
+
+#include <sim/configmap.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Simulator
+{
+    class MGSystem;
+
+    // Embedding API: construct simulated systems in a host program,
+    // run them and collect their statistics.
+    //
+    // Each Simulation owns its own kernel, configuration and system,
+    // so that several simulations can run concurrently on separate
+    // host threads. A simulation must only be used by one thread at
+    // a time. The host resources remain shared: the I/O devices
+    // should use separate files, and the SDL output is disabled
+    // unless GfxEnableSDLOutput is overridden.
+    //
+    // This header only depends on the standard library and on
+    // sim/configmap.h, which are installed with libmgsim.
+
+    // Read a configuration file in the format of config.ini and
+    // append its settings to a ConfigMap. Throws std::runtime_error
+    // if the file cannot be read or parsed.
+    void LoadConfigFile(ConfigMap& config, const std::string& filename);
+
+    // Description of one simulation, as with the command line of
+    // mgsim.
+    struct SimulationSpec
+    {
+        ConfigMap                config;     ///< Base configuration, as with -c
+        ConfigMap                overrides;  ///< Overrides, as with -o; take precedence over config
+        std::vector<std::string> argv;       ///< The program followed by its arguments
+        std::vector<std::string> variables;  ///< Patterns of the variables to collect, as with -p
+        uint64_t                 max_cycles; ///< Stop after this many master cycles; 0 for no limit
+
+        SimulationSpec() : config(), overrides(), argv(), variables(), max_cycles(0) {}
+    };
+
+    // Outcome and statistics of one simulation.
+    struct SimulationResult
+    {
+        bool        completed;      ///< Whether the program terminated or the system went idle
+        int         exit_code;      ///< Exit code given by the program, if it terminated
+        std::string error;          ///< Error that stopped the simulation, if any
+
+        uint64_t    master_cycles;  ///< Master cycle counter
+        uint64_t    instructions;   ///< Total executed instructions
+        uint64_t    flops;          ///< Total issued floating-point instructions
+
+        std::map<std::string, std::string> variables; ///< Final values of the requested variables
+        std::string statistics;     ///< End-of-simulation statistics, as printed by mgsim
+
+        SimulationResult()
+            : completed(false), exit_code(0), error(), master_cycles(0),
+              instructions(0), flops(0), variables(), statistics() {}
+    };
+
+    class Simulation
+    {
+        struct Impl;
+        std::unique_ptr<Impl> m_impl;
+
+    public:
+        // Construct the system. Throws on configuration errors.
+        // RandomSeed defaults to 0, so that simulations are
+        // reproducible unless a seed is given. The ROM loads are not
+        // reported and the SDL output is disabled by default.
+        explicit Simulation(const SimulationSpec& spec);
+        ~Simulation();
+        Simulation(const Simulation&) = delete;
+        Simulation& operator=(const Simulation&) = delete;
+
+        // Run until the program terminates, the system goes idle,
+        // an error occurs or the cycle limit of the specification is
+        // reached. The errors of the simulated system are reported
+        // in the result, not thrown.
+        SimulationResult Run();
+
+        // The system, for uses beyond this API. Requires the
+        // internal headers of the simulator.
+        MGSystem& GetSystem();
+    };
+
+    // Run independent simulations on a number of host threads; 0
+    // uses one thread per host CPU. The results are in the order of
+    // the specifications. A simulation that cannot be constructed
+    // has its error in its result.
+    std::vector<SimulationResult> RunSimulations(const std::vector<SimulationSpec>& specs,
+                                                 unsigned nthreads = 0);
+}
+
+#endif
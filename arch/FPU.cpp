@@ -196,8 +196,38 @@ bool FPU::OnCompletion(unsigned int unit, const Result& res) const
 
 Result FPU::DoPipeline()
 {
+    const CycleNo now = GetKernel()->GetActiveClock()->GetCycleNo();
+
+    // The kernel may have skipped the cycles since we last waited;
+    // advance the pipelines as if we had run in these cycles, but not
+    // past the first completion, as a cycle in which a result could
+    // not be written back does not advance them. The pipelines are
+    // only advanced in the commit phase; until then, 'skipped' is
+    // added to their state.
+    CycleNo skipped = 0;
+    if (m_resume != 0)
+    {
+        skipped = now - m_resume;
+        for (auto& unit : m_units)
+            if (!unit.slots.empty())
+                skipped = std::min<CycleNo>(skipped, unit.latency - unit.slots.front().state);
+    }
+    const size_t last_source = (m_last_source + skipped) % m_sources.size();
+    if (m_resume != 0)
+    {
+        COMMIT
+        {
+            for (auto& unit : m_units)
+                for (auto& p : unit.slots)
+                    p.state += skipped;
+            m_resume = 0;
+            skipped  = 0;
+        }
+    }
+
     size_t num_units_active = 0, num_units_failed = 0;
-    size_t num_units_full = 0;
+    size_t num_units_full = 0, num_units_done = 0;
+    CycleNo next_done = INFINITE_CYCLES;
     for (size_t i = 0; i < m_units.size(); ++i)
     {
         // Advance a pipeline
@@ -209,8 +239,14 @@ Result FPU::DoPipeline()
 
             bool advance = true;
             Result&  res = unit.slots.front();
-            if (res.state == unit.latency)
+            if (res.state + skipped != unit.latency)
+            {
+                next_done = std::min(next_done, now + unit.latency - (res.state + skipped));
+            }
+            else
             {
+                num_units_done++;
+
                 // This operation has completed
                 // Write back result
                 if (!OnCompletion(i, res))
@@ -252,7 +288,7 @@ Result FPU::DoPipeline()
     }
 
     size_t num_sources_failed = 0, num_sources_active = 0;
-    for (size_t i = m_last_source; i < m_last_source + m_sources.size(); ++i)
+    for (size_t i = last_source; i < last_source + m_sources.size(); ++i)
     {
         size_t source_id = i % m_sources.size();
 
@@ -273,7 +309,7 @@ Result FPU::DoPipeline()
                 // See if the unit can accept a new request
                 // Do this check after the Acquire phase, when the actual pipeline has
                 // moved on and made room for our request.
-                if (!unit.slots.empty() && (!unit.pipelined || unit.slots.back().state == 1))
+                if (!unit.slots.empty() && (!unit.pipelined || unit.slots.back().state + skipped == 1))
                 {
                     // The unit is busy or cannot accept a new operation
                     num_sources_failed++;
@@ -299,14 +335,23 @@ Result FPU::DoPipeline()
         }
     }
 
-    COMMIT { m_last_source = (m_last_source + 1) % m_sources.size(); }
+    COMMIT { m_last_source = (last_source + 1) % m_sources.size(); }
 
     if (num_units_full > 0) {
-        m_active.Write(true);
+        if (m_active.Empty()) {
+            m_active.Write(true);
+        }
     } else {
         m_active.Clear();
     }
 
+    if (num_units_done == 0 && num_sources_active == 0 && next_done != INFINITE_CYCLES)
+    {
+        // We are only waiting for the pipelines to produce a result.
+        GetKernel()->WaitUntil(next_done);
+        COMMIT{ m_resume = now + 1; }
+    }
+
     return (num_units_failed == num_units_active && num_sources_failed == num_sources_active) ? FAILED : SUCCESS;
 }
 
@@ -326,6 +371,7 @@ FPU::FPU(const std::string& name, Object& parent, Clock& clock, size_t num_input
       m_sources(),
       m_units(),
       m_last_source(0),
+      m_resume(0),
       InitProcess(p_Pipeline, DoPipeline)
 {
     m_active.Sensitive(p_Pipeline);
@@ -102,6 +102,7 @@ private:
     std::vector<size_t>  m_mapping[FPU_NUM_OPS];  ///< List of units for each FPU op
 
     DefineStateVariable(size_t, last_source);
+    DefineStateVariable(CycleNo, resume);         ///< Cycle after the last wait for the pipelines (0 if none)
     Simulator::Result DoPipeline();
 
     void Cleanup();
@@ -6,6 +6,7 @@
 #include <sim/kernel.h>
 #include <sim/inspect.h>
 #include <sim/delegate.h>
+#include <sim/freelist.h>
 
 #include <vector>
 
@@ -88,14 +89,18 @@ namespace Simulator
 
         protected:
             friend class MessagePool<Payload>;
+            friend class FreeList<Message<Payload> >;
 
             Message(const Message&) = delete;
         };
 
         template<typename Payload>
         class MessagePool {
-            static Message<Payload>* g_FreeMessages;
-            static  std::vector<Message<Payload>*> g_Messages;
+            // The messages come from a pool shared by the systems of
+            // the process. It has no users, so the messages are only
+            // returned to the host at exit, but the free messages of a
+            // thread are reused by the other threads once it exits.
+            typedef FreeList<Message<Payload> > Pool;
         public:
             static void free(Message<Payload>* msg);
 
@@ -14,11 +14,6 @@ namespace Simulator
         template<typename Payload>
         IInterconnect<Payload>::~IInterconnect() {}
 
-        template<typename Payload>
-        Message<Payload>* MessagePool<Payload>::g_FreeMessages = 0;
-        template<typename Payload>
-        std::vector<Message<Payload>*> MessagePool<Payload>::g_Messages;
-
         template<typename Payload>
         inline void Message<Payload>::operator delete(void *p)
         {
@@ -43,8 +38,7 @@ namespace Simulator
 #ifndef NDEBUG
             memset(msg, 0xFE, sizeof(*msg));
 #endif
-            msg->next = g_FreeMessages;
-            g_FreeMessages = msg;
+            Pool::Free(msg);
         }
 
         template<typename Payload>
@@ -54,26 +48,9 @@ namespace Simulator
         }
 
         template<typename Payload>
-        Message<Payload>* MessagePool<Payload>::alloc()
+        inline Message<Payload>* MessagePool<Payload>::alloc()
         {
-            // We allocate this many messages at once
-            constexpr size_t ALLOCATE_SIZE = 1024;
-            if (g_FreeMessages == NULL)
-            {
-                // Allocate more messages
-                Message<Payload>* msg = new Message<Payload>[ALLOCATE_SIZE];
-                g_Messages.push_back(msg);
-
-                for (size_t i = 0; i < ALLOCATE_SIZE; ++i, ++msg)
-                {
-                    msg->next = g_FreeMessages;
-                    g_FreeMessages = msg;
-                }
-            }
-            Message<Payload>* msg = g_FreeMessages;
-            g_FreeMessages = msg->next;
-
-            return msg;
+            return Pool::Allocate();
         }
 
     }
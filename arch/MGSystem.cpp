@@ -23,6 +23,7 @@
 
 #include "arch/ic/Bus.h"
 #include "arch/ic/Crossbar.h"
+#include "arch/ic/Mesh.h"
 #include "arch/IOMessageInterface.h"
 #include "arch/dev/LCD.h"
 #include "arch/dev/RTC.h"
@@ -34,6 +35,7 @@
 #include "arch/dev/RPC.h"
 #include "arch/dev/RPC_unix.h"
 
+#include "sim/journal.h"
 #include "sim/rusage.h"
 #include "sim/getclassname.h"
 
@@ -43,13 +45,62 @@
 #include <iostream>
 #include <fstream>
 #include <cmath>
+#include <algorithm>
 #include <limits>
 #include <fnmatch.h>
 #include <cstring>
+#include <chrono>
+#ifdef ENABLE_PARALLEL_SETUP
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#endif
 
 using namespace Simulator;
 using namespace std;
 
+#ifdef ENABLE_PARALLEL_SETUP
+// Run body(0) ... body(n-1) using the given number of host threads.
+// The first exception thrown by any invocation is rethrown in the
+// caller once all threads have finished.
+template<typename F>
+static void ParallelFor(size_t n, size_t nthreads, const F& body)
+{
+    atomic<size_t> next(0);
+    exception_ptr  error;
+    mutex          error_lock;
+
+    auto worker = [&]()
+    {
+        for (size_t i; (i = next++) < n; )
+        {
+            try
+            {
+                body(i);
+            }
+            catch (...)
+            {
+                lock_guard<mutex> lock(error_lock);
+                if (!error)
+                    error = current_exception();
+                next = n;
+            }
+        }
+    };
+
+    vector<thread> threads;
+    for (size_t t = 1; t < nthreads; ++t)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads)
+        t.join();
+
+    if (error)
+        rethrow_exception(error);
+}
+#endif
+
 uint64_t MGSystem::GetOp() const
 {
     uint64_t op = 0;
@@ -136,15 +187,101 @@ static string StringReplace(string arg, string pat, string repl)
     return res;
 }
 
-void MGSystem::PrintProcesses(ostream& out, const string& pat) const
+void MGSystem::PrintProcesses(ostream& out, const string& pat, const string& sort) const
+{
+    const Kernel& kernel = *GetKernel();
+
+    vector<const Process*> procs;
+    for (const Process* p : kernel.GetAllProcesses())
+        if (FNM_NOMATCH != fnmatch(pat.c_str(), p->GetName().c_str(), 0))
+            procs.push_back(p);
+
+    if (sort == "time")
+        stable_sort(procs.begin(), procs.end(), [](const Process* a, const Process* b)
+                    { return a->GetProfile().GetHostTime() > b->GetProfile().GetHostTime(); });
+    else if (sort == "calls")
+        stable_sort(procs.begin(), procs.end(), [](const Process* a, const Process* b)
+                    { return a->GetProfile().GetCalls() > b->GetProfile().GetCalls(); });
+    else if (sort == "stalls")
+        stable_sort(procs.begin(), procs.end(), [](const Process* a, const Process* b)
+                    { return a->GetStalls() > b->GetStalls(); });
+    else if (sort != "name")
+        throw exceptf<>("Unknown sort key: %s (expected name, time, calls or stalls)", sort.c_str());
+
+    const KernelProfile& kp = kernel.GetProfile();
+    if (kp.cycles == 0)
+    {
+        // No profile: just list the names.
+        for (const Process* p : procs)
+            out << p->GetName() << endl;
+        return;
+    }
+
+    uint64_t total = kp.arbitratetime + kp.updatetime;
+    for (const Process* p : kernel.GetAllProcesses())
+        total += p->GetProfile().GetHostTime();
+
+    out << "Profile of " << kp.cycles << " cycles, "
+        << fixed << setprecision(3) << total / 1e6 << " ms of host time"
+        << (kernel.IsProfiling() ? "" : " (profiling is disabled)") << endl
+        << "  acquire      check     commit   host(us)      %     stalls  process" << endl;
+    for (const Process* p : procs)
+    {
+        const ProcessProfile& pp = p->GetProfile();
+        out << setw(9) << pp.calls[PHASE_ACQUIRE] << ' '
+            << setw(10) << pp.calls[PHASE_CHECK] << ' '
+            << setw(10) << pp.calls[PHASE_COMMIT] << ' '
+            << setw(10) << setprecision(0) << pp.GetHostTime() / 1e3 << ' '
+            << setw(6) << setprecision(2) << (total ? 100. * pp.GetHostTime() / total : 0.) << ' '
+            << setw(10) << p->GetStalls() << "  "
+            << p->GetName() << endl;
+    }
+    out << "Kernel: " << kp.arbitrations << " arbitrations in "
+        << setprecision(0) << kp.arbitratetime / 1e3 << " us, "
+        << kp.updates << " storage updates in "
+        << kp.updatetime / 1e3 << " us" << endl;
+    out.unsetf(ios::floatfield);
+}
+
+void MGSystem::DumpProfile(ostream& out, const string& format) const
 {
-    auto& allprocs = GetKernel()->GetAllProcesses();
-    for (const Process* p : allprocs)
+    const Kernel& kernel = *GetKernel();
+    const KernelProfile& kp = kernel.GetProfile();
+
+    if (format == "csv")
+    {
+        out << "process,acquire_calls,check_calls,commit_calls,acquire_ns,check_ns,commit_ns,stalls" << endl;
+        for (const Process* p : kernel.GetAllProcesses())
+        {
+            const ProcessProfile& pp = p->GetProfile();
+            out << p->GetName() << ','
+                << pp.calls[PHASE_ACQUIRE] << ',' << pp.calls[PHASE_CHECK] << ',' << pp.calls[PHASE_COMMIT] << ','
+                << pp.hosttime[PHASE_ACQUIRE] << ',' << pp.hosttime[PHASE_CHECK] << ',' << pp.hosttime[PHASE_COMMIT] << ','
+                << p->GetStalls() << endl;
+        }
+    }
+    else if (format == "folded")
     {
-        std::string name = p->GetName();
-        if (FNM_NOMATCH != fnmatch(pat.c_str(), name.c_str(), 0))
-            out << name << endl;
+        // Folded stacks for flame graphs: one line per process, with
+        // the component hierarchy as the stack, weighted by host time
+        // in nanoseconds.
+        for (const Process* p : kernel.GetAllProcesses())
+        {
+            uint64_t t = p->GetProfile().GetHostTime();
+            if (t == 0)
+                continue;
+            string stack = p->GetName();
+            replace(stack.begin(), stack.end(), '.', ';');
+            replace(stack.begin(), stack.end(), ':', ';');
+            out << stack << ' ' << t << endl;
+        }
+        if (kp.arbitratetime != 0)
+            out << "kernel;arbitrate " << kp.arbitratetime << endl;
+        if (kp.updatetime != 0)
+            out << "kernel;update " << kp.updatetime << endl;
     }
+    else
+        throw exceptf<>("Unknown profile format: %s (expected csv or folded)", format.c_str());
 }
 
 // Print all components that are a child of root
@@ -437,9 +574,10 @@ void MGSystem::PrintState(const vector<string>& /*unused*/) const
             if (clock->GetActiveStorages() != NULL)
             {
                 cout << "- the following storages need updating:" << endl;
-                for (const Storage* storage = clock->GetActiveStorages(); storage != NULL; storage = storage->GetNext())
+                for (const StorageBatch* batch = clock->GetActiveStorages(); batch != NULL; batch = batch->GetNext())
                 {
-                    cout << "  - " << storage->GetName() << endl;
+                    for (size_t i = 0; i < batch->GetSize(); ++i)
+                        cout << "  - " << batch->GetStorage(i).GetName() << endl;
                 }
             }
 
@@ -477,7 +615,7 @@ void MGSystem::PrintAllStatistics(ostream& os) const
 }
 
 // Steps the entire system this many cycles
-void MGSystem::Step(CycleNo nCycles)
+RunState MGSystem::Step(CycleNo nCycles)
 {
     m_breakpoints.Resume();
     RunState state = GetKernel()->Step(nCycles);
@@ -580,7 +718,7 @@ void MGSystem::Step(CycleNo nCycles)
     default:
         break;
     }
-
+    return state;
 }
 
 void MGSystem::Disassemble(MemAddr addr, size_t sz) const
@@ -612,13 +750,50 @@ MGSystem::MGSystem(Config& config, bool quiet)
       m_memory(0),
       m_objdump_cmd(),
       m_bootrom(0),
-      m_selector(0)
+      m_selector(0),
+      m_displaymgr(0),
+      m_journal(0)
 {
 #ifdef STATIC_KERNEL
     Kernel::InitGlobalKernel();
 #endif
     auto& kernel = *GetKernel();
     kernel.AttachConfig(config);
+    kernel.SetSkipIdle(GetTopConfOpt("SkipIdleCycles", bool, true));
+    kernel.GetArena().SetHugePages(GetTopConfOpt("HostHugePages", bool, true));
+
+    unsigned seed = GetTopConfOpt("RandomSeed", unsigned, 0);
+
+    // The journal of external inputs must exist before the components
+    // that register their sources in it.
+    string record = GetTopConfOpt("RecordInputs", string, "");
+    string replay = GetTopConfOpt("ReplayInputs", string, "");
+    if (!record.empty() && !replay.empty())
+    {
+        throw InvalidArgumentException("RecordInputs and ReplayInputs cannot be used together");
+    }
+    if (!record.empty() || !replay.empty())
+    {
+        m_journal = new InputJournal(replay.empty() ? record : replay,
+                                     replay.empty() ? InputJournal::RECORD : InputJournal::REPLAY);
+        kernel.SetInputJournal(m_journal);
+
+        // The random seed is also an input of the simulation.
+        InputJournal::SourceID src = m_journal->RegisterSource("RandomSeed");
+        if (m_journal->IsReplaying())
+        {
+            unsigned recorded = seed;
+            m_journal->Replay(src, 0, recorded);
+            if (recorded != seed)
+            {
+                clog << "### random seed (from " << replay << "): " << recorded << endl;
+                seed = recorded;
+            }
+        }
+        else
+            m_journal->Record(src, 0, seed);
+    }
+    kernel.SeedRandom(seed);
 
     auto default_core_freq = GetTopConf("CoreFreq", Clock::Frequency);
     m_root = new Object("", kernel);
@@ -631,6 +806,7 @@ MGSystem::MGSystem(Config& config, bool quiet)
     }
 
     ResourceUsage ru1(true); // mark resource usage so far
+    auto wall1 = chrono::steady_clock::now();
 
     PSize numProcessors = GetTopConf("NumProcessors", PSize);
 
@@ -732,6 +908,10 @@ MGSystem::MGSystem(Config& config, bool quiet)
             auto ic = new IC::BufferedBus<IOPayload>(icname, *m_root);
             RegisterModelObject(*ic, "bus");
             m_ics[b] = ic;
+        } else if (ic_type == "BUFFEREDMESH" || ic_type == "MESH") {
+            auto ic = new IC::BufferedMesh<IOPayload>(icname, *m_root);
+            RegisterModelObject(*ic, "mesh");
+            m_ics[b] = ic;
         } else {
             throw runtime_error("Unknown interconnect type for " + icname + ": " + ic_type);
         }
@@ -770,13 +950,64 @@ MGSystem::MGSystem(Config& config, bool quiet)
 
     // Create processor grid
     m_procs.resize(numProcessors);
+    vector<Clock*> coreclocks(numProcessors);
     for (size_t i = 0; i < numProcessors; ++i)
     {
         auto name = "cpu" + to_string(i);
-        Clock& coreclock = kernel.CreateClock(GetTopSubConfOpt(name, "Freq", Clock::Frequency, default_core_freq));
+        coreclocks[i] = &kernel.CreateClock(GetTopSubConfOpt(name, "Freq", Clock::Frequency, default_core_freq));
         if (m_clock == 0)
-            m_clock = &coreclock;
-        m_procs[i]   = new DRISC(name, *m_root, coreclock, i, m_procs, m_breakpoints);
+            m_clock = coreclocks[i];
+    }
+
+    auto create_core = [&](size_t i)
+    {
+        m_procs[i] = new DRISC("cpu" + to_string(i), *m_root, *coreclocks[i], i, m_procs, m_breakpoints);
+    };
+
+    // The cores are independent until they are connected to the rest of
+    // the system, so they can be constructed concurrently.
+    size_t numSetupThreads = GetTopConfOpt("NumSetupThreads", size_t, 1);
+#ifdef ENABLE_PARALLEL_SETUP
+    if (numSetupThreads == 0)
+        numSetupThreads = max(1u, thread::hardware_concurrency());
+    numSetupThreads = min(numSetupThreads, (size_t)numProcessors);
+    if (numSetupThreads > 1)
+    {
+        kernel.SetConcurrentSetup(true);
+        try
+        {
+            ParallelFor(numProcessors, numSetupThreads, create_core);
+        }
+        catch (...)
+        {
+            kernel.SetConcurrentSetup(false);
+            throw;
+        }
+        kernel.SetConcurrentSetup(false);
+
+        // Keep the component tree in creation order.
+        m_root->ReorderChildren(vector<Object*>(m_procs.begin(), m_procs.end()));
+
+        if (!quiet)
+        {
+            clog << "Cores constructed using " << numSetupThreads << " threads." << endl;
+        }
+    }
+    else
+#else
+    if (numSetupThreads != 1)
+    {
+        cerr << "Warning: parallel setup is not enabled in this build; NumSetupThreads is ignored." << endl;
+    }
+#endif
+    {
+        for (size_t i = 0; i < numProcessors; ++i)
+            create_core(i);
+    }
+
+    for (size_t i = 0; i < numProcessors; ++i)
+    {
+        auto name = "cpu" + to_string(i);
         m_procs[i]->ConnectMemory(m_memory, memadmin);
         m_procs[i]->ConnectFPU(m_fpus[i / numProcessorsPerFPU]);
 
@@ -850,7 +1081,14 @@ MGSystem::MGSystem(Config& config, bool quiet)
             RegisterModelObject(*rtc, "rtc");
         } else if (dev_type == "GFX") {
             size_t fbdevid = GetTopSubConfOpt(name, "GfxFrameBufferDeviceID", size_t, devid + 1);
-            Display *disp = new Display(name, *m_root, ic, devid, fbdevid);
+            DisplayManager *dm = NULL;
+            if (GetTopSubConf(name, "GfxEnableSDLOutput", bool))
+            {
+                if (m_displaymgr == NULL)
+                    m_displaymgr = new DisplayManager(kernel, GetTopConf("SDLRefreshDelay", unsigned));
+                dm = m_displaymgr;
+            }
+            Display *disp = new Display(name, *m_root, ic, devid, fbdevid, dm);
             m_devices[i] = disp;
             RegisterModelObject(*disp, "gfx");
         } else if (dev_type == "AROM") {
@@ -859,7 +1097,7 @@ MGSystem::MGSystem(Config& config, bool quiet)
             aroms.push_back(rom);
             RegisterModelObject(*rom, "arom");
         } else if (dev_type == "UART") {
-            UART *uart = new UART(name, *m_root, ic, devid);
+            UART *uart = new UART(name, *m_root, ic, devid, *m_selector);
             m_devices[i] = uart;
             RegisterModelObject(*uart, "uart");
         } else if (dev_type == "SMC") {
@@ -1012,6 +1250,7 @@ MGSystem::MGSystem(Config& config, bool quiet)
     {
 	ResourceUsage ru2(true);
 	ru2 = ru2 - ru1;
+        auto wall2 = chrono::steady_clock::now();
 
         clog << "Location of `objdump': " << m_objdump_cmd << endl;
 
@@ -1027,8 +1266,16 @@ MGSystem::MGSystem(Config& config, bool quiet)
              << GetKernel()->GetAllProcesses().size() << " processes, "
              << "simulation running at " << dec << masterfreq << " " << qual[q] << "Hz" << endl
              << "Instantiation costs: "
-             << ru2.GetUserTime() << " us, "
+             << chrono::duration_cast<chrono::microseconds>(wall2 - wall1).count() << " us wall, "
+             << ru2.GetUserTime() << " us user, "
              << ru2.GetMaxResidentSize() << " KiB (approx)" << endl;
+
+        const Arena& arena = GetKernel()->GetArena();
+        clog << "Component state arrays: "
+             << arena.GetAllocatedSize() / 1024 << " KiB in "
+             << arena.GetNumRegions() << " regions of "
+             << arena.GetReservedSize() / 1024 << " KiB, "
+             << arena.GetNumHugeRegions() << " with huge pages" << endl;
     }
 }
 
@@ -1044,7 +1291,9 @@ MGSystem::~MGSystem()
         delete proc;
     for (auto fpu : m_fpus)
         delete fpu;
+    delete m_displaymgr;
     delete m_selector;
     delete m_memory;
     delete m_root;
+    delete m_journal;
 }
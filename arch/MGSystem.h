@@ -15,12 +15,14 @@ namespace Simulator {
 
     class ActiveROM;
     class Selector;
+    class DisplayManager;
     class FPU;
     namespace IC { template<typename Payload> class IInterconnect; }
     struct IOPayload;
     class IOMessageInterface;
     class DRISC;
     class IMemory;
+    class InputJournal;
 
     class MGSystem
     {
@@ -41,6 +43,8 @@ namespace Simulator {
         std::string                 m_objdump_cmd;
         ActiveROM*                  m_bootrom;
         Selector*                   m_selector;
+        DisplayManager*             m_displaymgr; ///< SDL output of the displays, if any
+        InputJournal*               m_journal;  ///< Record/replay of external inputs, if enabled
 
         // Writes the current configuration into memory and returns its address
         MemAddr WriteConfiguration();
@@ -73,7 +77,8 @@ namespace Simulator {
         object_map_t GetComponents(const std::string& pat = "*");
 
         void PrintComponents(std::ostream& os, const std::string& pat = "*", size_t levels = 0) const;
-        void PrintProcesses(std::ostream& os, const std::string& pat = "*") const;
+        void PrintProcesses(std::ostream& os, const std::string& pat = "*", const std::string& sort = "name") const;
+        void DumpProfile(std::ostream& os, const std::string& format) const;
 
         void DumpArea(std::ostream& os, size_t tech) const;
 
@@ -92,11 +97,16 @@ namespace Simulator {
 	const Kernel* GetKernel() const { return &m_kernel; }
 #endif
 
+        Selector& GetSelector() { return *m_selector; }
+        DisplayManager* GetDisplayManager() { return m_displaymgr; }
+
         const SymbolTable& GetSymTable() const { return m_symtable; }
 	BreakPointManager& GetBreakPointManager() { return m_breakpoints; }
 
-        // Steps the entire system this many cycles
-        void Step(CycleNo nCycles);
+        // Steps the entire system this many cycles. Returns
+        // STATE_IDLE if the system has completed, STATE_RUNNING if
+        // the cycles ran out first.
+        RunState Step(CycleNo nCycles);
         void Abort() { GetKernel()->Abort(); }
 
         MGSystem(Config& config, bool quiet);
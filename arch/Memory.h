@@ -7,6 +7,9 @@
 #include <sim/ports.h>
 #include <sim/storage.h>
 #include <sim/inspect.h>
+#include <sim/ctz.h>
+
+#include <algorithm>
 
 namespace Simulator
 {
@@ -62,6 +65,59 @@ namespace line {
                 dst[i] = src;
     }
 
+    // Bitmap of the bytes of a cache line, with bit i for byte i.
+    // Lines are no larger than MAX_MEMORY_OPERATION_SIZE, so that a
+    // single word covers a line and coverage checks and merges are
+    // mask operations.
+    typedef uint64_t Mask;
+    static_assert(MAX_MEMORY_OPERATION_SIZE <= sizeof(Mask) * 8,
+                  "line::Mask cannot cover MAX_MEMORY_OPERATION_SIZE bytes");
+
+    // Mask of the sz bytes starting at offset.
+    inline Mask range(size_t offset, size_t sz)
+    {
+        return (sz >= sizeof(Mask) * 8 ? ~(Mask)0 : (((Mask)1 << sz) - 1)) << offset;
+    }
+
+    inline bool test(Mask mask, size_t i)
+    {
+        return (mask >> i) & 1;
+    }
+
+    // Mask of the first sz entries of a byte mask.
+    inline Mask pack(const bool* mask, size_t sz)
+    {
+        Mask m = 0;
+        for (size_t i = 0; i < sz; ++i)
+            m |= (Mask)mask[i] << i;
+        return m;
+    }
+
+    template<typename T>
+    void blit(T* dst, const T* src, Mask mask)
+    {
+        for (; mask != 0; mask &= mask - 1)
+        {
+            size_t i = ctzll(mask);
+            dst[i] = src[i];
+        }
+    }
+
+    template<typename T, typename S>
+    void blit(T* dst, const T* src, Mask mask, S sz)
+    {
+        if (mask == range(0, sz))
+            std::copy(src, src + sz, dst);
+        else
+            blit(dst, src, mask & range(0, sz));
+    }
+
+    template<typename T, typename S>
+    void blitnot(T* dst, const T* src, Mask mask, S sz)
+    {
+        blit(dst, src, ~mask, sz);
+    }
+
 }
 
 class IMemory;
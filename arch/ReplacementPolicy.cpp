@@ -0,0 +1,338 @@
+#include "ReplacementPolicy.h"
+
+#include <sim/log2.h>
+#include <sim/except.h>
+#include <sim/sampling.h>
+
+#include <functional>
+
+/*
+  Replacement policies for the set-associative caches.
+
+  The replacement policy of a cache is selected with its
+  "Replacement" configuration key. Each policy counts the hits, the
+  fills (i.e. misses that allocate a line) and the evictions that it
+  sees, as "<policy>.hits", "<policy>.fills" and "<policy>.evictions"
+  in the variables of the cache, so that the hit rates of different
+  policies can be compared over the same workloads.
+
+  LRU: true least-recently used, with a timestamp per line. The line
+  with the oldest access is replaced, the lowest way on ties.
+
+  PLRU: tree pseudo-LRU, with one bit per internal node of a binary
+  tree over the ways of a set (associativity - 1 bits per set). Each
+  access points the nodes on its path away from the accessed way; the
+  victim is found by following the bits from the root. Requires a
+  power-of-two associativity.
+
+  SRRIP, BRRIP: static and bimodal re-reference interval prediction,
+  with a 2-bit re-reference prediction value (RRPV) per line.
+
+  A. Jaleel, K. B. Theobald, S. C. Steely Jr. and J. Emer,
+  “High performance cache replacement using re-reference interval
+  prediction (RRIP),” in Proceedings of the 37th annual international
+  symposium on Computer architecture, ISCA ’10, pp. 60–71, 2010.
+
+  A hit predicts a near re-reference (RRPV 0). SRRIP inserts new lines
+  with a long re-reference interval (RRPV 2), so that lines that are
+  used once, as in a scan, leave before the lines that are reused.
+  BRRIP inserts most lines with a distant interval (RRPV 3) and only
+  one in 32 with a long one, to resist thrashing. The victim is the
+  first line with the largest RRPV; when it is replaced, the whole set
+  is aged so that the victim's RRPV reaches 3.
+
+  RANDOM: a pseudo-random replaceable line, from a generator that is
+  advanced at each eviction and seeded from the name of the cache, so
+  that runs are reproducible.
+*/
+
+namespace Simulator
+{
+    class PolicyBase : public IReplacementPolicy
+    {
+    protected:
+        std::string m_name;
+        size_t      m_assoc;
+        uint64_t    m_hits;       ///< Number of accesses that hit
+        uint64_t    m_fills;      ///< Number of lines allocated
+        uint64_t    m_evictions;  ///< Number of lines replaced
+
+        // Registers the statistics, and the state array of n elements
+        // of the policy, in the variables of the cache.
+        template<typename T>
+        void RegisterState(Object& parent, const std::string& key, const std::string& name, T* state, size_t n)
+        {
+            VariableRegistry& registry = parent.GetKernel()->GetVariableRegistry();
+            const std::string prefix = parent.GetName() + ":" + key + ".";
+            registry.RegisterVariable(m_hits,      prefix + "hits",      SVC_CUMULATIVE);
+            registry.RegisterVariable(m_fills,     prefix + "fills",     SVC_CUMULATIVE);
+            registry.RegisterVariable(m_evictions, prefix + "evictions", SVC_CUMULATIVE);
+            registry.RegisterVariable(state, prefix + name, SVC_STATE, n);
+        }
+
+    public:
+        PolicyBase(const std::string& name, size_t assoc)
+            : m_name(name),
+              m_assoc(assoc),
+              m_hits(0),
+              m_fills(0),
+              m_evictions(0)
+        {}
+        const std::string& GetName() const { return m_name; }
+    };
+
+    // LRU: oldest access time first
+    class LRUPolicy : public PolicyBase
+    {
+        Kernel&  m_kernel;
+        CycleNo* m_access;   ///< Last access time of each line
+
+    public:
+        LRUPolicy(Object& parent, size_t sets, size_t assoc)
+            : PolicyBase("LRU", assoc),
+              m_kernel(*parent.GetKernel()),
+              m_access(parent.GetKernel()->GetArena().Allocate<CycleNo>(sets * assoc))
+        {
+            RegisterState(parent, "lru", "access", m_access, sets * assoc);
+        }
+        LRUPolicy(const LRUPolicy&) = delete;
+        LRUPolicy& operator=(const LRUPolicy&) = delete;
+
+        void Access(size_t line)
+        {
+            m_access[line] = m_kernel.GetCycleNo();
+            ++m_hits;
+        }
+
+        void Fill(size_t line)
+        {
+            m_access[line] = m_kernel.GetCycleNo();
+            ++m_fills;
+        }
+
+        void Evict(size_t /*line*/)
+        {
+            ++m_evictions;
+        }
+
+        int FindVictim(size_t set, WayMask ways) const
+        {
+            const CycleNo* access = m_access + set * m_assoc;
+            int lru = -1;
+            for (; ways != 0; ways &= ways - 1)
+            {
+                const int way = (int)ctzll(ways);
+                if (lru < 0 || access[way] < access[lru])
+                {
+                    lru = way;
+                }
+            }
+            return lru;
+        }
+    };
+
+    // PLRU: follow the tree bits, away from recent accesses
+    class PLRUPolicy : public PolicyBase
+    {
+        WayMask* m_bits;     ///< Per set, the tree; bit n is set if the victim is right of node n
+
+        // The ways below node n of the tree, where node 1 is the root
+        // and nodes assoc to 2*assoc-1 are the ways.
+        WayMask GetWays(size_t n) const
+        {
+            size_t width = m_assoc;
+            for (size_t m = n; m > 1; m >>= 1)
+                width /= 2;
+            const WayMask mask = (width >= sizeof(WayMask) * 8) ? ~(WayMask)0 : (((WayMask)1 << width) - 1);
+            return mask << (n * width - m_assoc);
+        }
+
+        void Touch(size_t line)
+        {
+            WayMask& bits = m_bits[line / m_assoc];
+            for (size_t n = line % m_assoc + m_assoc; n > 1; n >>= 1)
+            {
+                // Point the parent at the sibling of n
+                if (n & 1)
+                    bits &= ~((WayMask)1 << (n / 2));
+                else
+                    bits |= (WayMask)1 << (n / 2);
+            }
+        }
+
+    public:
+        PLRUPolicy(Object& parent, size_t sets, size_t assoc)
+            : PolicyBase("tree PLRU", assoc),
+              m_bits(parent.GetKernel()->GetArena().Allocate<WayMask>(sets))
+        {
+            if (!IsPowerOfTwo(assoc))
+            {
+                throw exceptf<InvalidArgumentException>(parent, "Replacement = PLRU requires a power-of-two associativity, not %zd", assoc);
+            }
+            RegisterState(parent, "plru", "bits", m_bits, sets);
+        }
+        PLRUPolicy(const PLRUPolicy&) = delete;
+        PLRUPolicy& operator=(const PLRUPolicy&) = delete;
+
+        void Access(size_t line) { Touch(line); ++m_hits; }
+        void Fill(size_t line)   { Touch(line); ++m_fills; }
+        void Evict(size_t /*line*/) { ++m_evictions; }
+
+        int FindVictim(size_t set, WayMask ways) const
+        {
+            if (ways == 0)
+            {
+                return -1;
+            }
+
+            // Follow the bits, unless the subtree has no replaceable way
+            const WayMask bits = m_bits[set];
+            size_t n = 1;
+            while (n < m_assoc)
+            {
+                size_t next = 2 * n + ((bits >> n) & 1);
+                if ((GetWays(next) & ways) == 0)
+                {
+                    next ^= 1;
+                }
+                n = next;
+            }
+            return (int)(n - m_assoc);
+        }
+    };
+
+    // SRRIP and BRRIP: largest re-reference prediction value first
+    class RRIPPolicy : public PolicyBase
+    {
+        static const uint8_t RRPV_MAX  = 3;   ///< Distant re-reference
+        static const uint8_t RRPV_LONG = 2;   ///< Long re-reference
+        static const unsigned BIMODAL_THROTTLE = 32;
+
+        bool     m_bimodal;  ///< BRRIP instead of SRRIP
+        uint8_t* m_rrpv;     ///< The RRPV of each line
+        uint64_t m_inserts;  ///< Number of insertions, for the BRRIP throttle
+
+    public:
+        RRIPPolicy(Object& parent, size_t sets, size_t assoc, bool bimodal)
+            : PolicyBase(bimodal ? "BRRIP" : "SRRIP", assoc),
+              m_bimodal(bimodal),
+              m_rrpv(parent.GetKernel()->GetArena().Allocate<uint8_t>(sets * assoc)),
+              m_inserts(0)
+        {
+            for (size_t i = 0; i < sets * assoc; ++i)
+            {
+                m_rrpv[i] = RRPV_MAX;
+            }
+            RegisterState(parent, bimodal ? "brrip" : "srrip", "rrpv", m_rrpv, sets * assoc);
+            parent.GetKernel()->GetVariableRegistry().RegisterVariable(m_inserts, parent.GetName() + (bimodal ? ":brrip.inserts" : ":srrip.inserts"), SVC_STATE);
+        }
+        RRIPPolicy(const RRIPPolicy&) = delete;
+        RRIPPolicy& operator=(const RRIPPolicy&) = delete;
+
+        void Access(size_t line)
+        {
+            m_rrpv[line] = 0;
+            ++m_hits;
+        }
+
+        void Fill(size_t line)
+        {
+            uint8_t rrpv = RRPV_LONG;
+            if (m_bimodal && m_inserts % BIMODAL_THROTTLE != 0)
+            {
+                rrpv = RRPV_MAX;
+            }
+            m_rrpv[line] = rrpv;
+            ++m_inserts;
+            ++m_fills;
+        }
+
+        void Evict(size_t line)
+        {
+            // Age the set until the victim has a distant re-reference
+            uint8_t* rrpv = m_rrpv + line / m_assoc * m_assoc;
+            const uint8_t age = RRPV_MAX - m_rrpv[line];
+            if (age > 0)
+            {
+                for (size_t i = 0; i < m_assoc; ++i)
+                {
+                    rrpv[i] = (rrpv[i] + age < RRPV_MAX) ? rrpv[i] + age : RRPV_MAX;
+                }
+            }
+            ++m_evictions;
+        }
+
+        int FindVictim(size_t set, WayMask ways) const
+        {
+            const uint8_t* rrpv = m_rrpv + set * m_assoc;
+            int victim = -1;
+            for (; ways != 0; ways &= ways - 1)
+            {
+                const int way = (int)ctzll(ways);
+                if (victim < 0 || rrpv[way] > rrpv[victim])
+                {
+                    victim = way;
+                }
+            }
+            return victim;
+        }
+    };
+
+    // RANDOM: any replaceable line
+    class RandomPolicy : public PolicyBase
+    {
+        uint64_t m_state;    ///< State of the xorshift generator, never zero
+
+    public:
+        RandomPolicy(Object& parent, size_t /*sets*/, size_t assoc)
+            : PolicyBase("random", assoc),
+              m_state(std::hash<std::string>()(parent.GetName()) | 1)
+        {
+            RegisterState(parent, "random", "state", &m_state, 1);
+        }
+
+        void Access(size_t /*line*/) { ++m_hits; }
+        void Fill(size_t /*line*/)   { ++m_fills; }
+
+        void Evict(size_t /*line*/)
+        {
+            m_state ^= m_state << 13;
+            m_state ^= m_state >> 7;
+            m_state ^= m_state << 17;
+            ++m_evictions;
+        }
+
+        int FindVictim(size_t set, WayMask ways) const
+        {
+            size_t count = 0;
+            for (WayMask m = ways; m != 0; m &= m - 1)
+            {
+                ++count;
+            }
+            if (count == 0)
+            {
+                return -1;
+            }
+
+            // Skip a pseudo-random number of the replaceable ways
+            for (size_t skip = (m_state ^ (set * 0x9E3779B97F4A7C15ULL)) % count; skip > 0; --skip)
+            {
+                ways &= ways - 1;
+            }
+            return (int)ctzll(ways);
+        }
+    };
+
+    IReplacementPolicy* IReplacementPolicy::makePolicy(Object& parent, const std::string& name, size_t sets, size_t assoc)
+    {
+        if      (name == "LRU")    { return new LRUPolicy(parent, sets, assoc); }
+        else if (name == "PLRU")   { return new PLRUPolicy(parent, sets, assoc); }
+        else if (name == "SRRIP")  { return new RRIPPolicy(parent, sets, assoc, false); }
+        else if (name == "BRRIP")  { return new RRIPPolicy(parent, sets, assoc, true); }
+        else if (name == "RANDOM") { return new RandomPolicy(parent, sets, assoc); }
+        else
+        {
+            throw exceptf<InvalidArgumentException>(parent, "Unknown replacement policy: %s", name.c_str());
+        }
+    }
+}
@@ -0,0 +1,37 @@
+// -*- c++ -*-
+#ifndef REPLACEMENTPOLICY_H
+#define REPLACEMENTPOLICY_H
+
+#include <sim/kernel.h>
+#include <arch/TagArray.h>
+
+namespace Simulator
+{
+    /// The choice of the lines to replace in a set-associative cache.
+    //
+    // The cache reports the hits (Access), the lines that it places in
+    // a way (Fill) and the lines that it replaces (Evict), in the commit
+    // phase. Lines are numbered as in the line array of the cache, i.e.
+    // set * assoc + way. FindVictim chooses among the ways that the
+    // cache is able to replace; it is also called in the other phases,
+    // so it does not change the state of the policy.
+    class IReplacementPolicy
+    {
+    public:
+        typedef TagArray::WayMask WayMask;
+
+        virtual void Access(size_t line) = 0;
+        virtual void Fill(size_t line) = 0;
+        virtual void Evict(size_t line) = 0;
+
+        /// The way to replace among ways in the set, or -1 if ways is empty.
+        virtual int FindVictim(size_t set, WayMask ways) const = 0;
+
+        virtual const std::string& GetName() const = 0;
+        virtual ~IReplacementPolicy() {};
+
+        static IReplacementPolicy* makePolicy(Object& parent, const std::string& name, size_t sets, size_t assoc);
+    };
+}
+
+#endif
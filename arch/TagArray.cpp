@@ -0,0 +1,28 @@
+#include "TagArray.h"
+#include <sim/except.h>
+#include <sim/sampling.h>
+
+#include <algorithm>
+
+namespace Simulator
+{
+    void TagArray::Initialize(Object& owner, size_t sets, size_t assoc)
+    {
+        if (assoc == 0 || assoc > MAX_ASSOC)
+        {
+            throw exceptf<InvalidArgumentException>(owner, "Associativity = %zd must be between 1 and %zd", assoc, (size_t)MAX_ASSOC);
+        }
+
+        m_assoc  = assoc;
+        m_stride = (assoc + VECTOR_WIDTH - 1) / VECTOR_WIDTH * VECTOR_WIDTH;
+
+        Arena& arena = owner.GetKernel()->GetArena();
+        m_tags   = static_cast<uint64_t*>(arena.Allocate(sets * m_stride * sizeof(uint64_t), Arena::MAX_ALIGN));
+        m_used   = arena.Allocate<WayMask>(sets);
+        std::fill(m_tags, m_tags + sets * m_stride, 0);
+
+        VariableRegistry& registry = owner.GetKernel()->GetVariableRegistry();
+        registry.RegisterVariable(m_tags, owner.GetName() + ":tags", SVC_STATE, sets * m_stride);
+        registry.RegisterVariable(m_used, owner.GetName() + ":used", SVC_STATE, sets);
+    }
+}
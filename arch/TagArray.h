@@ -0,0 +1,126 @@
+// -*- c++ -*-
+#ifndef TAGARRAY_H
+#define TAGARRAY_H
+
+#include <sim/kernel.h>
+#include <sim/ctz.h>
+#include <arch/simtypes.h>
+
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace Simulator
+{
+    /// The tags of the lines of a set-associative cache, which the
+    /// cache uses to look up lines.
+    //
+    // The tags are kept in an array separate from the lines, with the
+    // ways of a set contiguous, aligned and padded to the vector width,
+    // so that a lookup compares the tag against all the ways of a set
+    // with a few AVX2 or SSE2 compares and a movemask, depending on
+    // what the host compiler targets, or with a scalar loop otherwise.
+    // The occupancy of the ways is kept as a bitmap per set, so that
+    // empty lines never match. The choice of victims among the
+    // occupied ways is left to an IReplacementPolicy.
+    //
+    // Lines are numbered as in the line array of the cache, i.e.
+    // set * assoc + way.
+    class TagArray
+    {
+    public:
+        /// Bitmap of ways, with bit i for way i.
+        typedef uint64_t WayMask;
+
+        static const size_t MAX_ASSOC = sizeof(WayMask) * 8;
+
+    private:
+        // Entries compared by one vector instruction; sets are padded
+        // to a multiple of this.
+        static const size_t VECTOR_WIDTH = 4;
+
+        size_t    m_assoc;
+        size_t    m_stride;   ///< Entries per set, the associativity padded to the vector width
+        uint64_t* m_tags;     ///< The tags of the lines
+        WayMask*  m_used;     ///< Per set, the ways that hold a line
+
+        size_t GetEntry(size_t line) const { return line / m_assoc * m_stride + line % m_assoc; }
+
+    public:
+        /// Allocate the arrays in the arena of the owner's kernel for
+        /// sets sets of assoc ways, with all lines empty, and register
+        /// them as state of the owner.
+        void Initialize(Object& owner, size_t sets, size_t assoc);
+
+        /// The ways of the set that hold a line with the tag.
+        WayMask Match(size_t set, MemAddr tag) const
+        {
+            const uint64_t* tags  = m_tags + set * m_stride;
+            WayMask         match = 0;
+#if defined(__AVX2__)
+            const __m256i key = _mm256_set1_epi64x((long long)tag);
+            for (size_t i = 0; i < m_stride; i += 4)
+            {
+                __m256i eq = _mm256_cmpeq_epi64(_mm256_load_si256((const __m256i*)(tags + i)), key);
+                match |= (WayMask)_mm256_movemask_pd(_mm256_castsi256_pd(eq)) << i;
+            }
+#elif defined(__SSE2__)
+            // SSE2 has no 64-bit compare: both halves must be equal.
+            const __m128i key = _mm_set1_epi64x((long long)tag);
+            for (size_t i = 0; i < m_stride; i += 2)
+            {
+                __m128i eq = _mm_cmpeq_epi32(_mm_load_si128((const __m128i*)(tags + i)), key);
+                eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+                match |= (WayMask)_mm_movemask_pd(_mm_castsi128_pd(eq)) << i;
+            }
+#else
+            for (size_t i = 0; i < m_assoc; ++i)
+                match |= (WayMask)(tags[i] == tag) << i;
+#endif
+            return match & m_used[set];
+        }
+
+        /// The way of the set that holds a line with the tag, or -1.
+        int Find(size_t set, MemAddr tag) const
+        {
+            WayMask match = Match(set, tag);
+            return (match != 0) ? (int)ctzll(match) : -1;
+        }
+
+        /// The ways of the set that hold no line.
+        WayMask GetEmpty(size_t set) const { return ~m_used[set] & (~(WayMask)0 >> (MAX_ASSOC - m_assoc)); }
+
+        /// The ways of the set that hold a line.
+        WayMask GetUsed(size_t set) const { return m_used[set]; }
+
+        /// The last empty way of the set, or -1 if the set is full.
+        int FindEmpty(size_t set) const
+        {
+            WayMask empty = GetEmpty(set);
+            return (empty != 0) ? (int)(MAX_ASSOC - 1 - clzll(empty)) : -1;
+        }
+
+        MemAddr GetTag(size_t line) const { return (MemAddr)m_tags[GetEntry(line)]; }
+        void    SetTag(size_t line, MemAddr tag) { m_tags[GetEntry(line)] = tag; }
+
+        /// Mark the line as holding a line or as empty. This must
+        /// follow the transitions of the line from and to its empty
+        /// state.
+        void SetUsed(size_t line, bool used)
+        {
+            const WayMask way = (WayMask)1 << (line % m_assoc);
+            if (used)
+                m_used[line / m_assoc] |= way;
+            else
+                m_used[line / m_assoc] &= ~way;
+        }
+
+        TagArray() : m_assoc(0), m_stride(0), m_tags(NULL), m_used(NULL) {}
+        TagArray(const TagArray&) = delete;
+        TagArray& operator=(const TagArray&) = delete;
+    };
+}
+
+#endif
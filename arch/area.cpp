@@ -13,6 +13,13 @@
 #include <sim/log2.h>
 #include <cacti/cacti_interface.h>
 
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <map>
+#include <tuple>
+#include <mutex>
+
 // These values are taken from Gupta, et al.'s paper:
 // "Technology Independent Area and Delay Estimates for Microprocessor Building Blocks"
 // The values are expressed in lambda-squared, where lambda is half the technology size.
@@ -334,7 +341,7 @@ static const structure_desc thread_table = {
     }
 };
 
-static org_t get_info(
+static org_t run_cacti(
     int cache_size,
     int line_size,
     int associativity,
@@ -405,6 +412,111 @@ static org_t get_info(
     return org_t(o.cache_ht * o.cache_len, o.access_time, o.cycle_time);
 }
 
+// Each CACTI run takes seconds, and the same structures recur across
+// configurations and runs. The results are therefore memoized in a
+// small on-disk database: a text file with one entry per line, which
+// holds all the inputs of run_cacti() and the resulting area and
+// times. New entries are appended as they are computed, so that
+// concurrent runs can share the file. Lines from another format
+// version are ignored; the version must be bumped whenever the fixed
+// CACTI parameters above change.
+class cacti_cache
+{
+    static constexpr const char* VERSION = "v1";
+
+    typedef std::tuple<int, int, int, int, int, int, double, int, int, int> entry_key;
+
+    std::string             m_filename;
+    std::map<entry_key, org_t>  m_entries;
+    size_t                  m_hits;
+    size_t                  m_misses;
+
+public:
+    cacti_cache() : m_filename(), m_entries(), m_hits(0), m_misses(0) {}
+
+    void open(const std::string& filename)
+    {
+        m_filename = filename;
+        m_entries.clear();
+        m_hits = m_misses = 0;
+
+        std::ifstream f(filename.c_str());
+        std::string line;
+        while (std::getline(f, line))
+        {
+            std::istringstream is(line);
+            std::string version;
+            entry_key k;
+            double area, access_time, cycle_time;
+            is >> version
+               >> std::get<0>(k) >> std::get<1>(k) >> std::get<2>(k) >> std::get<3>(k) >> std::get<4>(k)
+               >> std::get<5>(k) >> std::get<6>(k) >> std::get<7>(k) >> std::get<8>(k) >> std::get<9>(k)
+               >> area >> access_time >> cycle_time;
+            if (!is.fail() && version == VERSION)
+                m_entries.insert(std::make_pair(k, org_t(area, access_time, cycle_time)));
+        }
+    }
+
+    org_t get(int cache_size, int line_size, int associativity,
+              int rw_ports, int excl_read_ports, int excl_write_ports,
+              double tech_node, int output_width, int tag_width, int cache)
+    {
+        entry_key k(cache_size, line_size, associativity, rw_ports, excl_read_ports, excl_write_ports,
+                tech_node, output_width, tag_width, cache);
+        auto i = m_entries.find(k);
+        if (i != m_entries.end())
+        {
+            ++m_hits;
+            return i->second;
+        }
+
+        ++m_misses;
+        org_t o = run_cacti(cache_size, line_size, associativity, rw_ports, excl_read_ports, excl_write_ports,
+                            tech_node, output_width, tag_width, cache);
+        m_entries.insert(std::make_pair(k, o));
+
+        if (!m_filename.empty())
+        {
+            std::ostringstream os;
+            os << std::setprecision(17) << VERSION << ' '
+               << cache_size << ' ' << line_size << ' ' << associativity << ' '
+               << rw_ports << ' ' << excl_read_ports << ' ' << excl_write_ports << ' '
+               << tech_node << ' ' << output_width << ' ' << tag_width << ' ' << cache << ' '
+               << o.area << ' ' << o.access_time << ' ' << o.cycle_time << '\n';
+            std::ofstream f(m_filename.c_str(), std::ios::app);
+            if (!(f << os.str() << std::flush))
+            {
+                std::cerr << "#warning: unable to write to the area cache " << m_filename
+                          << ", results will not be reused" << std::endl;
+                m_filename.clear();
+            }
+        }
+        return o;
+    }
+
+    const std::string& filename() const { return m_filename; }
+    size_t hits() const { return m_hits; }
+    size_t misses() const { return m_misses; }
+};
+
+static cacti_cache area_cache;
+
+static org_t get_info(
+    int cache_size,
+    int line_size,
+    int associativity,
+    int rw_ports,
+    int excl_read_ports,
+    int excl_write_ports,
+    double tech_node,
+    int output_width,
+    int tag_width,
+    int cache)
+{
+    return area_cache.get(cache_size, line_size, associativity, rw_ports, excl_read_ports, excl_write_ports,
+                          tech_node, output_width, tag_width, cache);
+}
+
 static org_t get_ram_info(int rows, int width, int rw_ports, int r_ports, int w_ports, double tech)
 {
     return get_info(rows * width, width, 1, rw_ports, r_ports, w_ports, tech, width, 0, 0);
@@ -515,6 +627,17 @@ void Simulator::MGSystem::DumpArea(std::ostream& os, size_t tech) const
     // Virtual register size (registers in ISA)
     static const size_t BITS_VREG = 5;
 
+    // CACTI and the cache of its results are not reentrant, so
+    // systems in other threads wait for their turn.
+    static std::mutex cacti_lock;
+    std::lock_guard<std::mutex> lock(cacti_lock);
+
+    // Reuse the CACTI results of previous runs, unless disabled with
+    // an empty AreaCacheFile.
+    const char* home = getenv("HOME");
+    area_cache.open(GetTopConfOpt("AreaCacheFile", std::string,
+                                  home != NULL ? std::string(home) + "/.mgsim_area_cache" : std::string()));
+
     config cfg;
 
     cfg.numDRISCs   = m_procs[0]->GetGridSize();
@@ -656,6 +779,12 @@ void Simulator::MGSystem::DumpArea(std::ostream& os, size_t tech) const
 #endif
 
     os << "microgrid\t(total,max)\t" << grid.area*1e-6 << "\t" << grid.access_time*1e9 << std::endl;
+
+    std::clog << "### CACTI results: " << area_cache.hits() << " reused, "
+              << area_cache.misses() << " computed";
+    if (!area_cache.filename().empty())
+        std::clog << " (cache: " << area_cache.filename() << ")";
+    std::clog << std::endl;
 }
 
 #else
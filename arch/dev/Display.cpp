@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <cstring>
 #include <cstdlib>
+#include <mutex>
 
 using namespace std;
 
@@ -81,6 +82,7 @@ namespace Simulator
         COMMIT {
             memcpy(&disp.m_video_memory[address], iodata.data, iodata.size);
             disp.m_video_memory_updated = true;
+            disp.m_capture_changed = true;
         }
 
         DebugIOWrite("FB write: %#016llx/%u", (unsigned long long)address, (unsigned)iodata.size);
@@ -182,6 +184,7 @@ namespace Simulator
             COMMIT {
                 disp.m_command_offset = value;
                 disp.m_video_memory_updated = true;
+                disp.m_capture_changed = true;
             }
         }
         else if (word == 5)
@@ -280,7 +283,8 @@ namespace Simulator
 
 
     Display::Display(const string& name, Object& parent,
-                     IOMessageInterface& ioif, IODeviceID ctldevid, IODeviceID fbdevid)
+                     IOMessageInterface& ioif, IODeviceID ctldevid, IODeviceID fbdevid,
+                     DisplayManager* manager)
         : Object(name, parent),
           m_ctlinterface("ctl", *this, ioif, ctldevid),
           m_fbinterface("fb", *this, ioif, fbdevid),
@@ -294,6 +298,11 @@ namespace Simulator
           m_logical_screen_pixels(),
           m_sdl_enabled(false),
           m_sdl_context(new SDLContext),
+          m_manager(manager),
+          m_capture(NULL),
+          m_capture_interval(0),
+          m_capture_changed(false),
+          m_capture_hook(0),
           InitStateVariable(logical_width, 640),
           InitStateVariable(logical_height, 400),
           InitStateVariable(command_offset, 0),
@@ -302,33 +311,42 @@ namespace Simulator
     {
         RegisterStateVariable(m_video_memory, "video_memory");
 
-        if (GetConf("GfxEnableSDLOutput", bool))
+        if (m_manager != NULL)
         {
-            DisplayManager::CreateManagerIfNotExists(*GetKernel()->GetConfig());
-            auto dm = DisplayManager::GetManager();
-            if (dm == NULL || !dm->IsSDLInitialized())
+            if (!m_manager->IsSDLInitialized())
                 cerr << "# " << GetName() << ": unable to use SDL, output to screen disabled" << endl;
             else
             {
                 m_sdl_enabled = true;
-                dm->RegisterDisplay(this);
-                dm->GetMaxWindowSize(m_max_screen_w, m_max_screen_h);
+                m_manager->RegisterDisplay(this);
+                m_manager->GetMaxWindowSize(m_max_screen_w, m_max_screen_h);
                 cerr << "# " << GetName()
                      << ": Maximum supported output size: "
                      << m_max_screen_w << 'x' << m_max_screen_h << endl;
             }
         }
 
+        const string capture = GetConfOpt("GfxCaptureFile", string, "");
+        if (!capture.empty())
+        {
+            m_capture_interval = max<CycleNo>(GetConfOpt("GfxCaptureInterval", CycleNo, 1000000), 1);
+            m_capture = new DisplayCapture(capture, DisplayCapture::ParseFormat(GetConfOpt("GfxCaptureFormat", string, "ppm")));
+            m_capture_hook = GetKernel()->AddCycleHook(m_capture_interval, CycleHook::create<Display, &Display::OnCapture>(*this));
+            cerr << "# " << GetName() << ": capturing frames to " << capture
+                 << " every " << m_capture_interval << " cycles" << endl;
+        }
     }
 
     Display::~Display()
     {
-        auto dm = DisplayManager::GetManager();
-        if (dm != NULL)
-            dm->UnregisterDisplay(this);
+        if (m_manager != NULL)
+            m_manager->UnregisterDisplay(this);
         CloseWindow();
         delete m_sdl_context;
         m_sdl_context = 0;
+        if (m_capture != NULL)
+            GetKernel()->RemoveCycleHook(m_capture_hook);
+        delete m_capture;
     }
 
 
@@ -343,6 +361,30 @@ namespace Simulator
             memset(&m_logical_screen_pixels[0], 0, w * h * sizeof(m_logical_screen_pixels[0]));
 
         m_logical_screen_resized = true;
+        m_capture_changed = true;
+    }
+
+    void Display::OnCapture(CycleNo cycle)
+    {
+        // The logical screen only exists after the first mode change.
+        if (m_logical_screen_pixels.size() != (size_t)m_logical_width * m_logical_height)
+            return;
+
+        if (m_capture->GetFrames() == 0)
+        {
+            // The master frequency is final once the simulation runs.
+            m_capture->SetFrameRate(GetKernel()->GetMasterFrequency() * 1000000, m_capture_interval);
+        }
+
+        // Only render the screen if the video memory or the mode
+        // changed since the last frame.
+        const bool changed = m_capture_changed;
+        if (changed)
+        {
+            PrepareLogicalScreen();
+            m_capture_changed = false;
+        }
+        m_capture->Capture(cycle, &m_logical_screen_pixels[0], m_logical_width, m_logical_height, changed);
     }
 
     void Display::DumpLogicalScreen(unsigned key, int stream, bool gen_ts)
@@ -511,12 +553,11 @@ namespace Simulator
     {
         if (m_sdl_context->window)
         {
-            auto dm = DisplayManager::GetManager();
-            assert(dm != NULL);
+            assert(m_manager != NULL);
 
             auto caption = "MGSim display: "
                 + to_string(m_logical_width) + "x" + to_string(m_logical_height) + ", "
-                + to_string(dm->GetRefreshDelay()) + " kernel cycles / frame";
+                + to_string(m_manager->GetRefreshDelay()) + " kernel cycles / frame";
             SDL_SetWindowTitle(m_sdl_context->window, caption.c_str());
         }
     }
@@ -561,7 +602,7 @@ namespace Simulator
 
     void DisplayManager::UnregisterDisplay(Display *disp)
     {
-        remove(m_displays.begin(), m_displays.end(), disp);
+        m_displays.erase(remove(m_displays.begin(), m_displays.end(), disp), m_displays.end());
     }
 
     void DisplayManager::GetMaxWindowSize(unsigned& w, unsigned& h)
@@ -588,19 +629,12 @@ namespace Simulator
             d->ResetDisplay();
     }
 
-    DisplayManager* DisplayManager::g_singleton = 0;
-
-    void DisplayManager::CreateManagerIfNotExists(Config& cfg)
-    {
-        if (g_singleton == 0)
-            g_singleton = new DisplayManager(cfg.getValue<unsigned>("SDLRefreshDelay"));
-    }
-
-    DisplayManager::DisplayManager(unsigned refreshDelay)
+    DisplayManager::DisplayManager(Kernel& kernel, unsigned refreshDelay)
         : m_sdl_initialized(false),
           m_refreshDelay_orig(refreshDelay),
           m_refreshDelay(refreshDelay),
-          m_lastUpdate(0),
+          m_kernel(kernel),
+          m_hook(0),
           m_displays()
     {
         if (SDL_Init(SDL_INIT_VIDEO) != 0)
@@ -610,7 +644,26 @@ namespace Simulator
         }
         m_sdl_initialized = true;
         if (SDL_HasQuit)
-            atexit(SDL_Quit);
+        {
+            static once_flag quit_registered;
+            call_once(quit_registered, [] { atexit(SDL_Quit); });
+        }
+
+        // Only poll for events when SDL is available.
+        m_hook = m_kernel.AddCycleHook(m_refreshDelay,
+                                       CycleHook::create<DisplayManager, &DisplayManager::OnCycle>(*this));
+    }
+
+    DisplayManager::~DisplayManager()
+    {
+        if (m_sdl_initialized)
+            m_kernel.RemoveCycleHook(m_hook);
+    }
+
+    void DisplayManager::SetRefreshDelay(unsigned delay)
+    {
+        m_refreshDelay = delay;
+        m_kernel.SetCycleHookPeriod(m_hook, m_refreshDelay);
     }
 
     void DisplayManager::CheckEvents()
@@ -664,18 +717,18 @@ namespace Simulator
                     selected->SetWindowScale(1.0, 1.0, true);
                     break;
                 case SDLK_DOWN:
-                    m_refreshDelay += currentDelayScale(m_refreshDelay);
+                    SetRefreshDelay(m_refreshDelay + currentDelayScale(m_refreshDelay));
                     for (auto d : m_displays)
                         d->ResetWindowCaption();
                     break;
                 case SDLK_UP:
                     if (m_refreshDelay)
-                        m_refreshDelay -= currentDelayScale(m_refreshDelay);
+                        SetRefreshDelay(m_refreshDelay - currentDelayScale(m_refreshDelay));
                     for (auto d : m_displays)
                         d->ResetWindowCaption();
                     break;
                 case SDLK_r:
-                    m_refreshDelay = m_refreshDelay_orig;
+                    SetRefreshDelay(m_refreshDelay_orig);
                     for (auto d : m_displays)
                         d->SetWindowScale(1.0, 1.0, true);
                     break;
@@ -7,10 +7,13 @@
 #include <sim/storage.h>
 #include <sim/config.h>
 #include <sim/sampling.h>
+#include <arch/dev/DisplayCapture.h>
 
 namespace Simulator
 {
     struct SDLContext;
+    class DisplayManager;
+
     class Display : public Object
     {
         class ControlInterface;
@@ -78,6 +81,12 @@ namespace Simulator
 
         bool                  m_sdl_enabled;
         SDLContext*           m_sdl_context;
+        DisplayManager*       m_manager;          ///< Manager of the SDL windows, NULL if SDL is not used
+
+        DisplayCapture*       m_capture;          ///< Headless frame capture, if enabled
+        CycleNo               m_capture_interval; ///< Master cycles between captured frames
+        bool                  m_capture_changed;  ///< Whether the screen may have changed since the last frame
+        size_t                m_capture_hook;     ///< Identifier of the OnCapture hook
 
         DefineStateVariable(unsigned int, logical_width);
         DefineStateVariable(unsigned int, logical_height);
@@ -89,9 +98,12 @@ namespace Simulator
         friend class FrameBufferInterface;
 
     public:
+        // manager is the DisplayManager of the system, or NULL if
+        // the output to screen is disabled.
         Display(const std::string& name, Object& parent,
                 IOMessageInterface& iobus,
-                IODeviceID ctldevid, IODeviceID fbdevid);
+                IODeviceID ctldevid, IODeviceID fbdevid,
+                DisplayManager* manager);
 
         Display(const Display&) = delete;
         Display& operator=(const Display&) = delete;
@@ -111,6 +123,10 @@ namespace Simulator
         // Perform the rendering pipeline to the screen
         void Show();
 
+        // Record a frame to the capture, called by the kernel every
+        // m_capture_interval cycles.
+        void OnCapture(CycleNo cycle);
+
         // Change/update the rendering scaling factor
         // set = true -> change m_scalex/m_scaley to specified factors;
         // set = false -> multiply m_scalex/m_scaly by specified factors.
@@ -132,9 +148,19 @@ namespace Simulator
     };
 
 
+    // DisplayManager: dispatches the SDL events to the displays of
+    // a simulated system. There is one per system that uses SDL
+    // output. SDL itself is process-wide and must be used from the
+    // main thread, so screen output is only suitable for a single
+    // interactive simulation per process.
     class DisplayManager
     {
     public:
+        DisplayManager(Kernel& kernel, unsigned refreshDelay);
+        DisplayManager(const DisplayManager&) = delete;
+        DisplayManager& operator=(const DisplayManager&) = delete;
+        ~DisplayManager();
+
         // RegisterDisplay/UnregisterDisplay: register/unregister a
         // display instance that may be connected to a SDL window and
         // thus receive key or window resize events.
@@ -145,15 +171,9 @@ namespace Simulator
         // for a window.
         void GetMaxWindowSize(unsigned& w, unsigned& h);
 
-        // OnCycle(): only call CheckEvents (which is expensive) every
-        // m_refreshDelay cycles.  Called by Kernel::Step().
-        void OnCycle(CycleNo cycle)
-        {
-            if (m_lastUpdate + m_refreshDelay > cycle)
-                return;
-            m_lastUpdate = cycle;
-            CheckEvents();
-        }
+        // OnCycle(): called by the kernel every m_refreshDelay cycles
+        // to call CheckEvents (which is expensive).
+        void OnCycle(CycleNo /*cycle*/) { CheckEvents(); }
 
         // CheckEvents: poll the SDL event queue and dispatch events
         // to the appropriate display. Used by OnCycle and CommandLineReader::ReadLineHook.
@@ -172,21 +192,16 @@ namespace Simulator
         // used after deserializing a simulation state.
         void ResetDisplays() const;
 
-        // Singleton methods
-        static void CreateManagerIfNotExists(Config& cfg);
-        static DisplayManager* GetManager() { return g_singleton; }
-
     protected:
         bool                   m_sdl_initialized;    ///< Whether SDL is available
         unsigned               m_refreshDelay_orig; ///< Initial refresh delay from config
         unsigned               m_refreshDelay;      ///< Current refresh delay as set by user
-        CycleNo                m_lastUpdate;        ///< Cycle number of last check
+        Kernel&                m_kernel;            ///< Kernel that calls OnCycle
+        size_t                 m_hook;              ///< Identifier of the OnCycle hook
         std::vector<Display*>  m_displays;          ///< Currently registered Display instances
-        static DisplayManager* g_singleton;         ///< Singleton instance
-
 
-        // Constructor, used by CreateManagerIfNotExists.
-        DisplayManager(unsigned refreshDelay);
+        // SetRefreshDelay: change the refresh delay and reschedule OnCycle.
+        void SetRefreshDelay(unsigned delay);
     };
 
 }
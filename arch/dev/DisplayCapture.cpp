@@ -0,0 +1,216 @@
+#include <arch/dev/DisplayCapture.h>
+#include <sim/except.h>
+
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <cassert>
+
+using namespace std;
+
+namespace Simulator
+{
+    static uint64_t gcd(uint64_t a, uint64_t b)
+    {
+        while (b != 0)
+        {
+            uint64_t t = a % b;
+            a = b;
+            b = t;
+        }
+        return a;
+    }
+
+    DisplayCapture::Format DisplayCapture::ParseFormat(const string& name)
+    {
+        if (name == "ppm")       return FMT_PPM;
+        if (name == "ppm-delta") return FMT_PPM_DELTA;
+        if (name == "y4m")       return FMT_Y4M;
+        throw exceptf<InvalidArgumentException>("Unknown display capture format: %s (expected ppm, ppm-delta or y4m)", name.c_str());
+    }
+
+    DisplayCapture::DisplayCapture(const string& prefix, Format format)
+        : m_prefix(prefix),
+          m_format(format),
+          m_stream(NULL),
+          m_rate_num(1),
+          m_rate_den(1),
+          m_stream_w(0),
+          m_stream_h(0),
+          m_width(0),
+          m_height(0),
+          m_previous(),
+          m_yuv(),
+          m_frames(0),
+          m_partial(0)
+    {
+        if (m_format == FMT_Y4M)
+        {
+            string fname = m_prefix + ".y4m";
+            m_stream = fopen(fname.c_str(), "wb");
+            if (m_stream == NULL)
+                throw exceptf<>("Unable to open %s for writing: %s", fname.c_str(), strerror(errno));
+        }
+    }
+
+    void DisplayCapture::SetFrameRate(uint64_t rate_num, uint64_t rate_den)
+    {
+        assert(m_frames == 0);
+        uint64_t d = gcd(rate_num, rate_den);
+        m_rate_num = rate_num / d;
+        m_rate_den = rate_den / d;
+    }
+
+    DisplayCapture::~DisplayCapture()
+    {
+        if (m_stream != NULL)
+            fclose(m_stream);
+    }
+
+    bool DisplayCapture::FindChanges(const uint32_t* pixels, unsigned w, unsigned h, Rect& r) const
+    {
+        unsigned x0 = w, x1 = 0, y0 = h, y1 = 0;
+        for (unsigned y = 0; y < h; ++y)
+        {
+            const uint32_t* a = pixels + y * w;
+            const uint32_t* b = &m_previous[y * w];
+            if (memcmp(a, b, w * sizeof(*a)) == 0)
+                continue;
+
+            unsigned left = 0, right = w;
+            while (a[left] == b[left])
+                ++left;
+            while (a[right - 1] == b[right - 1])
+                --right;
+
+            x0 = min(x0, left);
+            x1 = max(x1, right);
+            if (y0 == h)
+                y0 = y;
+            y1 = y + 1;
+        }
+        if (y0 == h)
+            return false;
+
+        r.x = x0; r.y = y0;
+        r.w = x1 - x0; r.h = y1 - y0;
+        return true;
+    }
+
+    void DisplayCapture::WritePPM(CycleNo cycle, const uint32_t* pixels, unsigned w, const Rect& r, bool partial)
+    {
+        string fname = m_prefix + '.' + to_string(cycle) + ".ppm";
+        FILE* f = fopen(fname.c_str(), "wb");
+        if (f == NULL)
+            throw exceptf<>("Unable to open %s for writing: %s", fname.c_str(), strerror(errno));
+
+        fprintf(f, "P6\n#cycle: %llu\n", (unsigned long long)cycle);
+        if (partial)
+            fprintf(f, "#rect: %u %u %u %u\n", r.x, r.y, r.w, r.h);
+        fprintf(f, "%u %u 255\n", r.w, r.h);
+
+        vector<uint8_t> row(r.w * 3);
+        for (unsigned y = r.y; y < r.y + r.h; ++y)
+        {
+            const uint32_t* src = pixels + y * w + r.x;
+            for (unsigned x = 0; x < r.w; ++x)
+            {
+                row[x * 3]     = (src[x] >> 16) & 0xff;
+                row[x * 3 + 1] = (src[x] >>  8) & 0xff;
+                row[x * 3 + 2] = (src[x] >>  0) & 0xff;
+            }
+            fwrite(&row[0], 1, row.size(), f);
+        }
+        fclose(f);
+    }
+
+    void DisplayCapture::WriteY4MFrame(const uint32_t* pixels, unsigned w, unsigned h, const Rect& r)
+    {
+        // The size of the stream is the size of its first frame.
+        if (m_yuv.empty())
+        {
+            m_stream_w = w;
+            m_stream_h = h;
+            m_yuv.resize(3 * w * h);
+            fprintf(m_stream, "YUV4MPEG2 W%u H%u F%llu:%llu Ip A1:1 C444\n",
+                    w, h, (unsigned long long)m_rate_num, (unsigned long long)m_rate_den);
+        }
+        const unsigned sw = m_stream_w, sh = m_stream_h;
+        uint8_t* planes = &m_yuv[0];
+
+        // Convert the pixels that changed (ITU-R BT.601, limited range).
+        // Pixels outside of the frame are black.
+        unsigned xe = min(r.x + r.w, sw), ye = min(r.y + r.h, sh);
+        for (unsigned y = r.y; y < ye; ++y)
+        {
+            for (unsigned x = r.x; x < xe; ++x)
+            {
+                uint32_t p = (x < w && y < h) ? pixels[y * w + x] : 0;
+                int R = (p >> 16) & 0xff, G = (p >> 8) & 0xff, B = p & 0xff;
+                size_t i = (size_t)y * sw + x;
+                planes[i]               = (( 66 * R + 129 * G +  25 * B + 128) >> 8) + 16;
+                planes[i + sw * sh]     = ((-38 * R -  74 * G + 112 * B + 128) >> 8) + 128;
+                planes[i + 2 * sw * sh] = ((112 * R -  94 * G -  18 * B + 128) >> 8) + 128;
+            }
+        }
+
+        fputs("FRAME\n", m_stream);
+        fwrite(planes, 1, 3 * sw * sh, m_stream);
+    }
+
+    void DisplayCapture::Capture(CycleNo cycle, const uint32_t* pixels, unsigned w, unsigned h, bool changed)
+    {
+        if (w == 0 || h == 0)
+            return;
+
+        // After a resolution change, the whole frame is new.
+        const bool resized = (w != m_width || h != m_height);
+        Rect r = { 0, 0, w, h };
+        bool any = true;
+        if (!resized)
+            any = changed && FindChanges(pixels, w, h, r);
+
+        switch (m_format)
+        {
+        case FMT_PPM:
+            if (any)
+            {
+                WritePPM(cycle, pixels, w, Rect{ 0, 0, w, h }, false);
+                ++m_frames;
+            }
+            break;
+        case FMT_PPM_DELTA:
+            if (any)
+            {
+                WritePPM(cycle, pixels, w, r, !resized);
+                ++m_frames;
+                if (!resized)
+                    ++m_partial;
+            }
+            break;
+        case FMT_Y4M:
+            if (resized)
+                // Also clear the part of the stream outside of the frame.
+                r = Rect{ 0, 0, max(w, m_stream_w), max(h, m_stream_h) };
+            else if (!any)
+                r.w = r.h = 0;
+            WriteY4MFrame(pixels, w, h, r);
+            ++m_frames;
+            if (!resized)
+                ++m_partial;
+            break;
+        }
+
+        if (resized)
+        {
+            m_previous.assign(pixels, pixels + w * h);
+            m_width = w;
+            m_height = h;
+        }
+        else if (any)
+        {
+            for (unsigned y = r.y; y < r.y + r.h; ++y)
+                copy(pixels + y * w + r.x, pixels + y * w + r.x + r.w, &m_previous[y * w + r.x]);
+        }
+    }
+}
@@ -0,0 +1,81 @@
+// -*- c++ -*-
+#ifndef DISPLAYCAPTURE_H
+#define DISPLAYCAPTURE_H
+
+#include <sim/kernel.h>
+#include <string>
+#include <vector>
+#include <cstdio>
+
+namespace Simulator
+{
+    // DisplayCapture: records the logical screen of a display to
+    // files, independently from SDL.
+    //
+    // Each captured frame is compared to the previous one and only
+    // the rectangle that changed is encoded. The formats are:
+    //
+    // - "ppm": every frame that changed is written to
+    //   PREFIX.CYCLE.ppm;
+    // - "ppm-delta": as "ppm", but only the first frame and the
+    //   frames after a resolution change are complete. The other
+    //   images only contain the rectangle that changed, whose
+    //   position in the screen is given in a "#rect: X Y W H"
+    //   comment in the PPM header;
+    // - "y4m": a single YUV4MPEG2 (4:4:4) stream is written to
+    //   PREFIX.y4m, with one frame per capture. The frame size is
+    //   fixed by the first frame; later frames are cropped or
+    //   padded.
+    class DisplayCapture
+    {
+    public:
+        enum Format { FMT_PPM, FMT_PPM_DELTA, FMT_Y4M };
+
+        struct Rect { unsigned x, y, w, h; };
+
+    private:
+        std::string           m_prefix;   ///< Output file name prefix
+        Format                m_format;   ///< Output format
+        FILE*                 m_stream;   ///< Y4M output stream
+        uint64_t              m_rate_num; ///< Y4M frame rate numerator
+        uint64_t              m_rate_den; ///< Y4M frame rate denominator
+        unsigned              m_stream_w; ///< Y4M frame width
+        unsigned              m_stream_h; ///< Y4M frame height
+        unsigned              m_width;    ///< Width of the previous frame
+        unsigned              m_height;   ///< Height of the previous frame
+        std::vector<uint32_t> m_previous; ///< Pixels of the previous frame
+        std::vector<uint8_t>  m_yuv;      ///< Current Y4M frame, one plane per component
+        uint64_t              m_frames;   ///< Number of frames written
+        uint64_t              m_partial;  ///< Number of frames with only the changed rectangle
+
+        // Compare a frame with the previous one; returns false if
+        // nothing changed, otherwise the rectangle that changed.
+        bool FindChanges(const uint32_t* pixels, unsigned w, unsigned h, Rect& r) const;
+
+        void WritePPM(CycleNo cycle, const uint32_t* pixels, unsigned w, const Rect& r, bool partial);
+        void WriteY4MFrame(const uint32_t* pixels, unsigned w, unsigned h, const Rect& r);
+
+    public:
+        // Parse a format name; throws on unknown names.
+        static Format ParseFormat(const std::string& name);
+
+        // Open a capture.
+        DisplayCapture(const std::string& prefix, Format format);
+        ~DisplayCapture();
+        DisplayCapture(const DisplayCapture&) = delete;
+        DisplayCapture& operator=(const DisplayCapture&) = delete;
+
+        // Set the frame rate of a Y4M stream to rate_num / rate_den
+        // frames per second. This must be done before the first frame.
+        void SetFrameRate(uint64_t rate_num, uint64_t rate_den);
+
+        // Record a frame of w x h XRGB pixels. If changed is false,
+        // the frame is known to be the same as the previous one.
+        void Capture(CycleNo cycle, const uint32_t* pixels, unsigned w, unsigned h, bool changed);
+
+        uint64_t GetFrames() const { return m_frames; }
+        uint64_t GetPartialFrames() const { return m_partial; }
+    };
+}
+
+#endif
@@ -117,14 +117,25 @@ namespace Simulator
           InitStorage(m_queueEnabled, m_clock, false),
           InitBuffer(m_incoming, m_clock, "RPCIncomingQueueSize"),
           InitBuffer(m_ready, m_clock, "RPCReadyQueueSize"),
+          InitBuffer(m_pending, m_clock, "RPCPendingQueueSize"),
           InitBuffer(m_completed, m_clock, "RPCCompletedQueueSize"),
           InitBuffer(m_notifications, m_clock, "RPCNotificationQueueSize"),
 
           m_provider(provider),
 
+          m_pool(NULL),
+          m_latency(GetConfOpt("RPCLatency", CycleNo, 0)),
+          m_hostDone(false),
+          m_journal(GetKernel()->GetInputJournal()),
+          m_journalResults(0),
+
+          InitSampleVariable(nasync, SVC_CUMULATIVE),
+          InitSampleVariable(hostwaits, SVC_CUMULATIVE),
+
           InitProcess(p_queueRequest, DoQueue),
           InitProcess(p_argumentFetch, DoArgumentFetch),
           InitProcess(p_processRequests, DoProcessRequests),
+          InitProcess(p_completeRequests, DoCompleteRequests),
           InitProcess(p_writeResponse, DoWriteResponse),
           InitProcess(p_sendCompletionNotifications, DoSendCompletionNotifications)
     {
@@ -144,6 +155,7 @@ namespace Simulator
         m_queueEnabled.Sensitive(p_queueRequest);
         m_incoming.Sensitive(p_argumentFetch);
         m_ready.Sensitive(p_processRequests);
+        m_pending.Sensitive(p_completeRequests);
         m_completed.Sensitive(p_writeResponse);
         m_notifications.Sensitive(p_sendCompletionNotifications);
 
@@ -154,9 +166,52 @@ namespace Simulator
 
         p_queueRequest.SetStorageTraces(m_incoming * m_queueEnabled);
         p_argumentFetch.SetStorageTraces(opt(m_ioif.GetRequestTraces(m_devid)) ^ m_ready);
-        p_processRequests.SetStorageTraces(m_completed);
+        p_processRequests.SetStorageTraces(m_completed ^ m_pending);
+        p_completeRequests.SetStorageTraces(opt(m_completed));
         p_writeResponse.SetStorageTraces(m_ioif.GetRequestTraces(m_devid) ^ m_notifications);
         p_sendCompletionNotifications.SetStorageTraces(m_ioif.GetRequestTraces(m_devid));
+
+        // Requests are serviced asynchronously when a host thread or a
+        // minimum latency is configured.
+        size_t nthreads = GetConfOpt("RPCWorkerThreads", size_t, 0);
+        if (nthreads > 0 || m_latency > 0)
+        {
+            m_pool = new RPCWorkerPool(m_provider, nthreads);
+        }
+
+        if (m_journal != NULL)
+            m_journalResults = m_journal->RegisterSource(GetName() + ".results");
+    }
+
+    RPCInterface::~RPCInterface()
+    {
+        delete m_pool;
+    }
+
+    // The results of a request are journaled as the size of the 1st
+    // result, followed by the two results.
+    void RPCInterface::RecordResults(const std::vector<char>& res1, const std::vector<char>& res2)
+    {
+        std::vector<char> data(sizeof(uint32_t));
+        uint32_t size1 = res1.size();
+        memcpy(&data[0], &size1, sizeof(size1));
+        data.insert(data.end(), res1.begin(), res1.end());
+        data.insert(data.end(), res2.begin(), res2.end());
+        m_journal->Record(m_journalResults, m_clock.GetCycleNo(), data);
+    }
+
+    void RPCInterface::ReplayResults(std::vector<char>& res1, std::vector<char>& res2)
+    {
+        std::vector<char> data;
+        m_journal->Replay(m_journalResults, m_clock.GetCycleNo(), data);
+        uint32_t size1;
+        if (data.size() < sizeof(size1))
+            throw exceptf<SimulationException>(*this, "Invalid journal entry for the results of a request");
+        memcpy(&size1, &data[0], sizeof(size1));
+        if (size1 > data.size() - sizeof(size1))
+            throw exceptf<SimulationException>(*this, "Invalid journal entry for the results of a request");
+        res1.assign(data.begin() + sizeof(size1), data.begin() + sizeof(size1) + size1);
+        res2.assign(data.begin() + sizeof(size1) + size1, data.end());
     }
 
     Result RPCInterface::DoQueue()
@@ -279,6 +334,46 @@ namespace Simulator
         DebugIOWrite("Processing RPC request from client %u for procedure %u, completion tag %#016llx",
                      (unsigned)req.dca_device_id, (unsigned)req.procedure_id, (unsigned long long)req.completion_tag);
 
+        if (m_pool != NULL)
+        {
+            // Hand the request over to the worker pool; the response
+            // is picked up by p_completeRequests.
+            PendingRequest preq;
+            preq.due = m_clock.GetCycleNo() + std::max<CycleNo>(m_latency, 1);
+            preq.dca_device_id = req.dca_device_id;
+            preq.res1_base_address = req.res1_base_address;
+            preq.res2_base_address = req.res2_base_address;
+            preq.notification_channel_id = req.notification_channel_id;
+            preq.completion_tag = req.completion_tag;
+
+            // When replaying, the host is not involved at all.
+            if (!IsReplaying())
+            {
+                COMMIT {
+                    std::unique_ptr<RPCWorkerPool::Job> job(new RPCWorkerPool::Job);
+                    job->procedure_id = req.procedure_id;
+                    job->arg1 = req.data1;
+                    job->arg2 = req.data2;
+                    job->arg3 = req.extra_arg1;
+                    job->arg4 = req.extra_arg2;
+                    job->res1_maxsize = m_maxRes1Size;
+                    job->res2_maxsize = m_maxRes2Size;
+                    job->context = m_provider.Prepare(req.procedure_id, req.extra_arg1, req.extra_arg2,
+                                                      GetKernel()->GetCycleNo());
+                    preq.seqno = m_pool->Submit(std::move(job));
+                    ++m_nasync;
+                }
+            }
+
+            if (!m_pending.Push(std::move(preq)))
+            {
+                DeadlockWrite("Unable to push pending request");
+                return FAILED;
+            }
+            m_ready.Pop();
+            return SUCCESS;
+        }
+
         ProcessResponse res(
             req.dca_device_id,
             req.res1_base_address,
@@ -288,13 +383,24 @@ namespace Simulator
             );
 
         COMMIT {
-            m_provider.Service(req.procedure_id,
-                               res.data1, m_maxRes1Size,
-                               res.data2, m_maxRes2Size,
-                               req.data1,
-                               req.data2,
-                               req.extra_arg1,
-                               req.extra_arg2);
+            if (IsReplaying())
+                ReplayResults(res.data1, res.data2);
+            else
+            {
+                const uint64_t context = m_provider.Prepare(req.procedure_id, req.extra_arg1, req.extra_arg2,
+                                                            GetKernel()->GetCycleNo());
+                m_provider.Service(req.procedure_id,
+                                   res.data1, m_maxRes1Size,
+                                   res.data2, m_maxRes2Size,
+                                   req.data1,
+                                   req.data2,
+                                   req.extra_arg1,
+                                   req.extra_arg2,
+                                   context);
+                m_provider.Complete(req.procedure_id, res.data1, context);
+                if (m_journal != NULL)
+                    RecordResults(res.data1, res.data2);
+            }
         }
 
         if (!m_completed.Push(std::move(res)))
@@ -306,6 +412,71 @@ namespace Simulator
         return SUCCESS;
     }
 
+    Result RPCInterface::DoCompleteRequests()
+    {
+        assert(!m_pending.Empty());
+
+        const PendingRequest& req = m_pending.Front();
+        const CycleNo now = m_clock.GetCycleNo();
+
+        // The request completes when both the host call has returned
+        // and the minimum latency has elapsed, unless its results are
+        // replayed from the input journal.
+        const bool replay = IsReplaying();
+        const CycleNo due = replay ? m_journal->GetNextCycle(m_journalResults) : req.due;
+        if (now < due && due != INFINITE_CYCLES)
+        {
+            GetKernel()->WaitUntil(due);
+            return SUCCESS;
+        }
+        // The host worker may finish at any time; sample its completion
+        // once per cycle, so that the check and commit phases agree.
+        if (!replay && GetKernel()->GetCyclePhase() == PHASE_ACQUIRE)
+        {
+            m_hostDone = m_pool->IsDone(req.seqno);
+        }
+        if (!replay && !m_hostDone)
+        {
+            // Poll again at the next cycle.
+            COMMIT { ++m_hostwaits; }
+            return SUCCESS;
+        }
+
+        DebugIOWrite("Completing RPC request %llu, completion tag %#016llx",
+                     (unsigned long long)req.seqno, (unsigned long long)req.completion_tag);
+
+        ProcessResponse res(
+            req.dca_device_id,
+            req.res1_base_address,
+            req.res2_base_address,
+            req.notification_channel_id,
+            req.completion_tag
+            );
+
+        COMMIT {
+            if (replay)
+                // Throws if the simulation diverged from the journal.
+                ReplayResults(res.data1, res.data2);
+            else
+            {
+                std::unique_ptr<RPCWorkerPool::Job> job = m_pool->Collect(req.seqno);
+                m_provider.Complete(job->procedure_id, job->res1, job->context);
+                res.data1.swap(job->res1);
+                res.data2.swap(job->res2);
+                if (m_journal != NULL)
+                    RecordResults(res.data1, res.data2);
+            }
+        }
+
+        if (!m_completed.Push(std::move(res)))
+        {
+            DeadlockWrite("Unable to push request completion");
+            return FAILED;
+        }
+        m_pending.Pop();
+        return SUCCESS;
+    }
+
     Result RPCInterface::DoWriteResponse()
     {
         assert(!m_completed.Empty());
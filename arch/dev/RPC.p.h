@@ -8,19 +8,36 @@
 #include <sim/kernel.h>
 #include <sim/flag.h>
 #include <sim/buffer.h>
+#include <sim/journal.h>
 #include <arch/IOMessageInterface.h>
+#include <arch/dev/RPCWorkerPool.h>
 
 namespace Simulator
 {
     class IRPCServiceProvider
     {
     public:
+        // Prepare and Complete are called on the simulation thread, in
+        // the order of the requests, before and after Service, which
+        // may run on a worker thread. The provider updates the state
+        // that the guest can observe there, so that it does not depend
+        // on the timing of the host. The value returned by Prepare is
+        // passed on to Service and Complete.
+        virtual uint64_t Prepare(uint32_t procedure_id,
+                                 uint32_t arg3, uint32_t arg4,
+                                 CycleNo cycle) = 0;
+
         virtual void Service(uint32_t procedure_id,
                              std::vector<char>& res1, size_t res1_maxsize,
                              std::vector<char>& res2, size_t res2_maxsize,
                              const std::vector<char>& arg1,
                              const std::vector<char>& arg2,
-                             uint32_t arg3, uint32_t arg4) = 0;
+                             uint32_t arg3, uint32_t arg4,
+                             uint64_t context) = 0;
+
+        virtual void Complete(uint32_t procedure_id,
+                              const std::vector<char>& res1,
+                              uint64_t context) = 0;
 
         virtual const std::string& GetName() const = 0;
         virtual ~IRPCServiceProvider() {};
@@ -76,6 +93,18 @@ namespace Simulator
             ))
         // {% endcall %}
 
+        // {% call gen_struct() %}
+        ((name PendingRequest)
+        (state
+         (uint64_t                seqno (init 0))
+         (CycleNo                 due (init 0))
+         (IODeviceID              dca_device_id (init 0))
+         (MemAddr                 res1_base_address (init 0))
+         (MemAddr                 res2_base_address (init 0))
+         (IONotificationChannelID notification_channel_id (init 0))
+         (Integer                 completion_tag (init 0))))
+        // {% endcall %}
+
         // {% call gen_struct() %}
         ((name CompletionNotificationRequest)
         (state
@@ -125,16 +154,38 @@ namespace Simulator
         Flag                    m_queueEnabled;
         Buffer<IncomingRequest> m_incoming;
         Buffer<ProcessRequest>  m_ready;
+        Buffer<PendingRequest>  m_pending;
         Buffer<ProcessResponse> m_completed;
         Buffer<CompletionNotificationRequest> m_notifications;
 
         IRPCServiceProvider&    m_provider;
 
+        // Asynchronous processing. When m_pool is NULL, requests are
+        // serviced synchronously by p_processRequests.
+        RPCWorkerPool*          m_pool;
+        CycleNo                 m_latency;     ///< Minimum latency of a request, in cycles
+        bool                    m_hostDone;    ///< Whether the front pending request was done at the start of the cycle
+
+        // The results of the requests are journaled, if enabled.
+        InputJournal*           m_journal;
+        InputJournal::SourceID  m_journalResults;
+
+        // statistics
+        DefineSampleVariable(uint64_t, nasync);      ///< Requests serviced through m_pool
+        DefineSampleVariable(uint64_t, hostwaits);   ///< Cycles spent waiting for the host to complete a request
+
+        bool IsReplaying() const { return m_journal != NULL && m_journal->IsReplaying(); }
+        void RecordResults(const std::vector<char>& res1, const std::vector<char>& res2);
+        void ReplayResults(std::vector<char>& res1, std::vector<char>& res2);
+
     public:
 
         RPCInterface(const std::string& name, Object& parent,
                      IOMessageInterface& ioif, IODeviceID devid,
                      IRPCServiceProvider& provider);
+        ~RPCInterface();
+        RPCInterface(const RPCInterface&) = delete;
+        RPCInterface& operator=(const RPCInterface&) = delete;
 
         Process p_queueRequest;
         Result  DoQueue();
@@ -145,6 +196,9 @@ namespace Simulator
         Process p_processRequests;
         Result  DoProcessRequests();
 
+        Process p_completeRequests;
+        Result  DoCompleteRequests();
+
         Process p_writeResponse;
         Result  DoWriteResponse();
 
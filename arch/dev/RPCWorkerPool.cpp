@@ -0,0 +1,145 @@
+#include <arch/dev/RPCWorkerPool.h>
+#include <arch/dev/RPC.h>
+
+#include <cassert>
+
+#ifdef CAN_USE_SIGMASK_ON_STD_THREAD
+#include <csignal>
+#include <pthread.h>
+#define pthread(Function, ...) do { if (pthread_ ## Function(__VA_ARGS__)) perror("pthread_" #Function); } while(0)
+#endif
+
+using namespace std;
+
+namespace Simulator
+{
+    static void* runrpcworker(void *arg)
+    {
+#ifdef CAN_USE_SIGMASK_ON_STD_THREAD
+        // Leave the signals to the simulation thread.
+        sigset_t sigset;
+        sigemptyset(&sigset);
+        sigaddset(&sigset, SIGINT);
+        sigaddset(&sigset, SIGQUIT);
+        sigaddset(&sigset, SIGHUP);
+        sigaddset(&sigset, SIGTERM);
+        pthread(sigmask, SIG_BLOCK, &sigset, 0);
+#endif
+
+        RPCWorkerPool *p = (RPCWorkerPool*) arg;
+        p->Run();
+        return 0;
+    }
+
+    RPCWorkerPool::RPCWorkerPool(IRPCServiceProvider& provider, size_t nthreads)
+        : m_provider(provider),
+          m_threads(),
+          m_lock(),
+          m_queued(),
+          m_finished(),
+          m_jobs(),
+          m_first(0),
+          m_next(0),
+          m_stop(false)
+    {
+        for (size_t i = 0; i < nthreads; ++i)
+            m_threads.emplace_back(runrpcworker, this);
+    }
+
+    RPCWorkerPool::~RPCWorkerPool()
+    {
+        {
+            unique_lock<mutex> lock(m_lock);
+            m_stop = true;
+            m_queued.notify_all();
+        }
+        for (auto& t : m_threads)
+            t.join();
+    }
+
+    void RPCWorkerPool::Execute(Job& job)
+    {
+        try
+        {
+            m_provider.Service(job.procedure_id,
+                               job.res1, job.res1_maxsize,
+                               job.res2, job.res2_maxsize,
+                               job.arg1, job.arg2,
+                               job.arg3, job.arg4,
+                               job.context);
+        }
+        catch (...)
+        {
+            job.error = current_exception();
+        }
+    }
+
+    void RPCWorkerPool::Run()
+    {
+        unique_lock<mutex> lock(m_lock);
+        for (;;)
+        {
+            while (!m_stop && m_next == m_first + m_jobs.size())
+                m_queued.wait(lock);
+
+            // Jobs that were not started are abandoned on exit.
+            if (m_stop)
+                break;
+
+            Job& job = *m_jobs[m_next - m_first];
+            ++m_next;
+
+            lock.unlock();
+            Execute(job);
+            lock.lock();
+
+            job.done = true;
+            m_finished.notify_all();
+        }
+    }
+
+    uint64_t RPCWorkerPool::Submit(unique_ptr<Job>&& job)
+    {
+        job->done = false;
+        job->error = nullptr;
+
+        if (m_threads.empty())
+        {
+            Execute(*job);
+            job->done = true;
+            m_jobs.push_back(std::move(job));
+            ++m_next;
+            return m_first + m_jobs.size() - 1;
+        }
+
+        unique_lock<mutex> lock(m_lock);
+        m_jobs.push_back(std::move(job));
+        m_queued.notify_one();
+        return m_first + m_jobs.size() - 1;
+    }
+
+    bool RPCWorkerPool::IsDone(uint64_t seqno)
+    {
+        unique_lock<mutex> lock(m_lock);
+        assert(seqno >= m_first && seqno < m_first + m_jobs.size());
+        return m_jobs[seqno - m_first]->done;
+    }
+
+    unique_ptr<RPCWorkerPool::Job> RPCWorkerPool::Collect(uint64_t seqno)
+    {
+        unique_ptr<Job> job;
+        {
+            unique_lock<mutex> lock(m_lock);
+            assert(seqno == m_first && !m_jobs.empty());
+            while (!m_jobs.front()->done)
+                m_finished.wait(lock);
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            ++m_first;
+        }
+        if (job->error)
+            rethrow_exception(job->error);
+        return job;
+    }
+}
@@ -0,0 +1,90 @@
+// -*- c++ -*-
+#ifndef RPCWORKERPOOL_H
+#define RPCWORKERPOOL_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Simulator
+{
+    class IRPCServiceProvider;
+
+    // RPCWorkerPool: runs the procedures of an RPC service provider
+    // on host threads, so that the simulation does not wait for
+    // the host system calls.
+    //
+    // Jobs are started in submission order and collected in the same
+    // order. With a single thread the provider also sees the calls
+    // in that order; with more threads calls that are in flight at
+    // the same time may execute concurrently. With no threads, jobs
+    // are run synchronously by Submit().
+    class RPCWorkerPool
+    {
+    public:
+        struct Job
+        {
+            uint32_t           procedure_id;
+            uint32_t           arg3;
+            uint32_t           arg4;
+            std::vector<char>  arg1;
+            std::vector<char>  arg2;
+            std::vector<char>  res1;
+            std::vector<char>  res2;
+            size_t             res1_maxsize;
+            size_t             res2_maxsize;
+            uint64_t           context; ///< Returned by the provider's Prepare()
+
+            bool               done;   ///< Set when the procedure has returned
+            std::exception_ptr error;  ///< Exception thrown by the procedure, if any
+
+            Job() : procedure_id(0), arg3(0), arg4(0), arg1(), arg2(), res1(), res2(),
+                    res1_maxsize(0), res2_maxsize(0), context(0), done(false), error() {}
+        };
+
+    private:
+        IRPCServiceProvider&             m_provider;
+        std::vector<std::thread>         m_threads;
+
+        // State shared with the worker threads.
+        std::mutex                       m_lock;
+        std::condition_variable          m_queued;   ///< Signalled when a job is submitted
+        std::condition_variable          m_finished; ///< Signalled when a job is done
+        std::deque<std::unique_ptr<Job>> m_jobs;     ///< Jobs submitted but not collected yet
+        uint64_t                         m_first;    ///< Sequence number of m_jobs.front()
+        uint64_t                         m_next;     ///< Sequence number of the next job to start
+        bool                             m_stop;
+
+        void Execute(Job& job);
+
+    public:
+        RPCWorkerPool(IRPCServiceProvider& provider, size_t nthreads);
+        ~RPCWorkerPool();
+        RPCWorkerPool(const RPCWorkerPool&) = delete;
+        RPCWorkerPool& operator=(const RPCWorkerPool&) = delete;
+
+        // Queue a job; returns its sequence number.
+        uint64_t Submit(std::unique_ptr<Job>&& job);
+
+        // Check whether a job has completed, without blocking.
+        bool IsDone(uint64_t seqno);
+
+        // Retrieve the oldest job, waiting for it to complete if
+        // needed. seqno must be the sequence number of that job. If
+        // the procedure threw an exception, it is rethrown here.
+        std::unique_ptr<Job> Collect(uint64_t seqno);
+
+        size_t GetNumThreads() const { return m_threads.size(); }
+
+        // Thread entry point.
+        void Run();
+    };
+}
+
+#endif
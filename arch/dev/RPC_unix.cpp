@@ -18,6 +18,7 @@ namespace Simulator
     UnixInterface::UnixInterface(const string& name, Object& parent)
         : Object(name, parent),
           m_vfds(17),
+          m_lock(),
           InitSampleVariable(nrequests, SVC_CUMULATIVE),
           InitSampleVariable(nfailures, SVC_CUMULATIVE),
           InitSampleVariable(nstats, SVC_CUMULATIVE),
@@ -28,11 +29,13 @@ namespace Simulator
     {
     }
 
-    UnixInterface::VirtualDescriptor* UnixInterface::GetEntry(UnixInterface::VirtualFD vfd)
+    bool UnixInterface::LookupVFD(UnixInterface::VirtualFD vfd, UnixInterface::VirtualDescriptor& vd) const
     {
+        lock_guard<mutex> lock(m_lock);
         if (vfd >= m_vfds.size() || !m_vfds[vfd].active)
-            return NULL;
-        return &m_vfds[vfd];
+            return false;
+        vd = m_vfds[vfd];
+        return true;
     }
 
     const string& UnixInterface::GetName() const
@@ -40,40 +43,120 @@ namespace Simulator
         return Object::GetName();
     }
 
-    UnixInterface::VirtualFD UnixInterface::GetNewVFD(UnixInterface::HostFD hfd)
+    UnixInterface::VirtualFD UnixInterface::AllocateVFD(CycleNo cycle)
     {
+        lock_guard<mutex> lock(m_lock);
         size_t i;
         for (i = 0; i < m_vfds.size() && m_vfds[i].active; ++i)
             /* loop */;
         if (i == m_vfds.size())
             m_vfds.resize(m_vfds.size() + m_vfds.size() / 2 + 1);
+        m_vfds[i] = VirtualDescriptor();
         m_vfds[i].active = true;
-        m_vfds[i].hfd = hfd;
-        m_vfds[i].dir = 0;
-        m_vfds[i].cycle_open = GetKernel()->GetCycleNo();
-        m_vfds[i].cycle_use = m_vfds[i].cycle_open;
+        m_vfds[i].cycle_open = cycle;
+        m_vfds[i].cycle_use = cycle;
         return i;
     }
 
-    UnixInterface::VirtualFD UnixInterface::DuplicateVFD(UnixInterface::VirtualFD original, UnixInterface::HostFD new_hfd)
+    bool UnixInterface::ReserveVFD(UnixInterface::VirtualFD vfd, CycleNo cycle)
     {
-        VirtualDescriptor *vd = GetEntry(original);
-        assert(vd != NULL);
-        return GetNewVFD(new_hfd);
+        lock_guard<mutex> lock(m_lock);
+        if (vfd >= m_vfds.size())
+            m_vfds.resize(vfd + 1);
+        if (m_vfds[vfd].active)
+            return false;
+        m_vfds[vfd] = VirtualDescriptor();
+        m_vfds[vfd].active = true;
+        m_vfds[vfd].cycle_open = cycle;
+        m_vfds[vfd].cycle_use = cycle;
+        return true;
     }
 
-    UnixInterface::VirtualDescriptor* UnixInterface::DuplicateVFD2(UnixInterface::VirtualFD original, UnixInterface::VirtualFD target)
+    void UnixInterface::SetHostFD(UnixInterface::VirtualFD vfd, UnixInterface::HostFD hfd, DIR* dir)
     {
-        VirtualDescriptor *vd = GetEntry(original);
-        assert(vd != NULL);
+        lock_guard<mutex> lock(m_lock);
+        assert(vfd < m_vfds.size() && m_vfds[vfd].active);
+        m_vfds[vfd].hfd = hfd;
+        m_vfds[vfd].dir = dir;
+    }
+
+    void UnixInterface::SetVFD(UnixInterface::VirtualFD vfd, const UnixInterface::VirtualDescriptor& vd)
+    {
+        lock_guard<mutex> lock(m_lock);
+        if (vfd >= m_vfds.size())
+            m_vfds.resize(vfd + 1);
+        m_vfds[vfd] = vd;
+    }
+
+    void UnixInterface::SetDir(UnixInterface::VirtualFD vfd, DIR* dir)
+    {
+        lock_guard<mutex> lock(m_lock);
+        if (vfd < m_vfds.size())
+            m_vfds[vfd].dir = dir;
+    }
+
+    void UnixInterface::ReleaseVFD(UnixInterface::VirtualFD vfd)
+    {
+        lock_guard<mutex> lock(m_lock);
+        if (vfd < m_vfds.size())
+            m_vfds[vfd].active = false;
+    }
+
+    // Context of the requests that did not allocate a descriptor
+    static const uint64_t NO_VFD = (uint64_t)-1;
+
+    uint64_t UnixInterface::Prepare(uint32_t procedure_id,
+                                    uint32_t arg3, uint32_t arg4,
+                                    CycleNo cycle)
+    {
+        switch(procedure_id)
+        {
+        case RPC_open:
+        case RPC_dup:
+        case RPC_opendir:
+            // The descriptor is allocated before the host call; it is
+            // released again by Complete() if the call fails.
+            return AllocateVFD(cycle);
+
+        case RPC_dup2:
+            // Reserve the target if it is not open yet
+            return ReserveVFD(arg4, cycle) ? arg4 : NO_VFD;
+
+        case RPC_close:
+        case RPC_closedir:
+            return arg3;
+
+        default:
+            return NO_VFD;
+        }
+    }
 
-        if (target >= m_vfds.size())
-            m_vfds.resize(target + 1);
+    void UnixInterface::Complete(uint32_t procedure_id,
+                                 const vector<char>& res1,
+                                 uint64_t context)
+    {
+        const uint64_t rval = UnserializeRegister(RT_INTEGER, &res1[0], 4) |
+            (uint64_t)UnserializeRegister(RT_INTEGER, &res1[4], 4) << 32;
 
-        if (target != original)
-            m_vfds[target].dir = 0;
+        switch(procedure_id)
+        {
+        case RPC_open:
+        case RPC_dup:
+        case RPC_dup2:
+        case RPC_opendir:
+            if (rval == (uint64_t)-1 && context != NO_VFD)
+                ReleaseVFD(context);
+            break;
+
+        case RPC_close:
+        case RPC_closedir:
+            if (rval == 0)
+                ReleaseVFD(context);
+            break;
 
-        return &m_vfds[target];
+        default:
+            break;
+        }
     }
 
 #define RequireArgs(Arg1Size, Arg2Size)                                 \
@@ -96,14 +179,19 @@ namespace Simulator
                                 const vector<char>& arg1,
                                 const vector<char>& arg2,
                                 uint32_t arg3,
-                                uint32_t arg4)
+                                uint32_t arg4,
+                                uint64_t context)
     {
         if (res1_maxsize < 12)
         {
             throw exceptf<>("Procedure %u requires at least 12 bytes available in 1st result area", (unsigned)procedure_id);
         }
 
+        // The host calls are made without holding the lock, so that the
+        // calls of different workers overlap; only the accesses to the
+        // descriptor table and the statistics are serialized.
         uint64_t rval = 0;
+        uint64_t nreads = 0, nread_bytes = 0, nwrites = 0, nwrite_bytes = 0, nstats = 0;
         errno = 0;
 
         switch(procedure_id)
@@ -114,8 +202,8 @@ namespace Simulator
 
         case RPC_read:
         {
-            VirtualDescriptor *vd = GetEntry(arg3);
-            if (vd == NULL)
+            VirtualDescriptor vd;
+            if (!LookupVFD(arg3, vd))
             {
                 errno = EBADF;
                 rval = -1;
@@ -128,13 +216,13 @@ namespace Simulator
                 sz = res2_maxsize;
             res2.resize(sz);
 
-            ssize_t s = read(vd->hfd, &res2[0], sz);
+            ssize_t s = read(vd.hfd, &res2[0], sz);
             if (s >= 0)
             {
                 res2.resize(s);
 
-                ++m_nreads;
-                m_nread_bytes += s;
+                ++nreads;
+                nread_bytes += s;
             }
 
             rval = s;
@@ -147,8 +235,8 @@ namespace Simulator
             RequireArgs(8, 0);
             assert(res2_maxsize >= 8);
 
-            VirtualDescriptor *vd = GetEntry(arg3);
-            if (vd == NULL)
+            VirtualDescriptor vd;
+            if (!LookupVFD(arg3, vd))
             {
                 errno = EBADF;
                 rval = -1;
@@ -159,7 +247,7 @@ namespace Simulator
             off_t offset_in = ((off_t)UnserializeRegister(RT_INTEGER, &arg1[4], 4) << 32) |
                 UnserializeRegister(RT_INTEGER, &arg1[0], 4);
 
-            off_t offset_out = lseek(vd->hfd, offset_in, wh);
+            off_t offset_out = lseek(vd.hfd, offset_in, wh);
 
             res2.resize(8);
             SerializeRegister(RT_INTEGER, offset_out & 0xffffffffUL, &(res2[0]), 4);
@@ -171,8 +259,8 @@ namespace Simulator
 
         case RPC_write:
         {
-            VirtualDescriptor *vd = GetEntry(arg3);
-            if (vd == NULL)
+            VirtualDescriptor vd;
+            if (!LookupVFD(arg3, vd))
             {
                 errno = EBADF;
                 rval = -1;
@@ -184,12 +272,12 @@ namespace Simulator
             if (sz > arg1.size())
                 sz = arg1.size();
 
-            ssize_t s = write(vd->hfd, &arg1[0], sz);
+            ssize_t s = write(vd.hfd, &arg1[0], sz);
 
             if (s >= 0)
             {
-                ++m_nwrites;
-                m_nwrite_bytes += s;
+                ++nwrites;
+                nwrite_bytes += s;
             }
 
             rval = s;
@@ -235,26 +323,26 @@ namespace Simulator
             if (hfd == -1)
                 rval = -1;
             else
-                rval = GetNewVFD(hfd);
+            {
+                SetHostFD(context, hfd);
+                rval = context;
+            }
         }
         break;
 
         case RPC_close:
         {
-            VirtualDescriptor *vd = GetEntry(arg3);
-            if (vd == NULL)
+            VirtualDescriptor vd;
+            if (!LookupVFD(arg3, vd))
             {
                 errno = EBADF;
                 rval = -1;
                 break;
             }
-            if (vd->dir)
-                rval = closedir(vd->dir);
+            if (vd.dir)
+                rval = closedir(vd.dir);
             else
-                rval = close(vd->hfd);
-
-            if (rval == 0)
-                vd->active = false;
+                rval = close(vd.hfd);
         }
         break;
 
@@ -303,48 +391,50 @@ namespace Simulator
 
         case RPC_dup:
         {
-            VirtualDescriptor *vd = GetEntry(arg3);
-            if (vd == NULL)
+            VirtualDescriptor vd;
+            if (!LookupVFD(arg3, vd))
             {
                 errno = EBADF;
                 rval = -1;
                 break;
             }
-            int new_hfd = dup(vd->hfd);
+            int new_hfd = dup(vd.hfd);
             if (new_hfd == -1)
                 rval = -1;
             else
-                rval = DuplicateVFD(arg3, new_hfd);
+            {
+                SetHostFD(context, new_hfd);
+                rval = context;
+            }
         }
         break;
 
         case RPC_dup2:
         {
-            VirtualDescriptor *vd = GetEntry(arg3);
-            if (vd == NULL)
+            VirtualDescriptor vd;
+            if (!LookupVFD(arg3, vd))
             {
                 errno = EBADF;
                 rval = -1;
                 break;
             }
-            VirtualDescriptor *vd2 = DuplicateVFD2(arg3, arg4);
+            // The target was reserved by Prepare(); it has no host
+            // descriptor yet if it was not open.
+            VirtualDescriptor vd2;
             int new_hfd;
-            if (vd2->active)
-                new_hfd = dup2(vd->hfd, vd2->hfd);
+            if (LookupVFD(arg4, vd2) && vd2.hfd != -1)
+                new_hfd = dup2(vd.hfd, vd2.hfd);
             else
-                new_hfd = dup(vd->hfd);
+                new_hfd = dup(vd.hfd);
 
             if (new_hfd != -1)
             {
                 rval = arg4;
-                *vd2 = *vd;
-                vd2->hfd = new_hfd;
+                vd.hfd = new_hfd;
+                SetVFD(arg4, vd);
             }
             else
-            {
                 rval = -1;
-                vd2->active = false;
-            }
         }
         break;
 
@@ -359,15 +449,15 @@ namespace Simulator
 
         case RPC_fsync:
         {
-            VirtualDescriptor *vd = GetEntry(arg3);
-            if (vd == NULL)
+            VirtualDescriptor vd;
+            if (!LookupVFD(arg3, vd))
             {
                 errno = EBADF;
                 rval = -1;
                 break;
             }
 #ifdef HAVE_FSYNC
-            rval = fsync(vd->hfd);
+            rval = fsync(vd.hfd);
 #else
             sync();
             rval = 0;
@@ -432,8 +522,8 @@ namespace Simulator
         case RPC_pread:
         {
             RequireArgs(8, 0);
-            VirtualDescriptor *vd = GetEntry(arg3);
-            if (vd == NULL)
+            VirtualDescriptor vd;
+            if (!LookupVFD(arg3, vd))
             {
                 errno = EBADF;
                 rval = -1;
@@ -448,13 +538,13 @@ namespace Simulator
                 sz = res2_maxsize;
             res2.resize(sz);
 
-            ssize_t s = pread(vd->hfd, &res2[0], sz, offset);
+            ssize_t s = pread(vd.hfd, &res2[0], sz, offset);
             if (s >= 0)
             {
                 res2.resize(s);
 
-                ++m_nreads;
-                m_nread_bytes += s;
+                ++nreads;
+                nread_bytes += s;
             }
 
 
@@ -465,8 +555,8 @@ namespace Simulator
         case RPC_pwrite:
         {
             RequireArgs(8, 0);
-            VirtualDescriptor *vd = GetEntry(arg3);
-            if (vd == NULL)
+            VirtualDescriptor vd;
+            if (!LookupVFD(arg3, vd))
             {
                 errno = EBADF;
                 rval = -1;
@@ -480,12 +570,12 @@ namespace Simulator
             if (sz > arg2.size())
                 sz = arg2.size();
 
-            ssize_t s = pwrite(vd->hfd, &arg2[0], sz, offset);
+            ssize_t s = pwrite(vd.hfd, &arg2[0], sz, offset);
 
             if (s >= 0)
             {
-                ++m_nwrites;
-                m_nwrite_bytes += s;
+                ++nwrites;
+                nwrite_bytes += s;
             }
 
             rval = s;
@@ -501,14 +591,14 @@ namespace Simulator
             {
             case RPC_fstat:
             {
-                VirtualDescriptor *vd = GetEntry(arg3);
-                if (vd == NULL)
+                VirtualDescriptor vd;
+                if (!LookupVFD(arg3, vd))
                 {
                     errno = EBADF;
                     rval = -1;
                     break;
                 }
-                rval = fstat(vd->hfd, &st);
+                rval = fstat(vd.hfd, &st);
             }
             break;
             case RPC_stat:
@@ -584,7 +674,7 @@ namespace Simulator
                 SerializeRegister(RT_INTEGER, 0, &vst->vst_blksize, 4);
 #endif
 
-                ++m_nstats;
+                ++nstats;
 
             }
         }
@@ -614,11 +704,8 @@ namespace Simulator
 #else
 # error Unable to retrieve file descriptor from DIR pointer.
 #endif
-                VirtualFD vfd = GetNewVFD(dfd);
-                VirtualDescriptor *vd = GetEntry(vfd);
-                assert(vd != NULL);
-                vd->dir = dir;
-                rval = vfd;
+                SetHostFD(context, dfd, dir);
+                rval = context;
             }
             else
             {
@@ -629,15 +716,15 @@ namespace Simulator
 
         case RPC_fdopendir:
         {
-            VirtualDescriptor *vd = GetEntry(arg3);
-            if (vd == NULL)
+            VirtualDescriptor vd;
+            if (!LookupVFD(arg3, vd))
             {
                 errno = EBADF;
                 rval = -1;
                 break;
             }
 
-            if (vd->dir != NULL)
+            if (vd.dir != NULL)
             {
                 rval = 0;
                 errno = EBUSY;
@@ -645,13 +732,13 @@ namespace Simulator
             }
 
 #ifdef HAVE_FDOPENDIR
-            DIR *dir = fdopendir(vd->hfd);
+            DIR *dir = fdopendir(vd.hfd);
 #else
-            DIR *dir = opendir(vd->fname.c_str());
+            DIR *dir = opendir(vd.fname.c_str());
 #endif
             if (dir != NULL)
             {
-                vd->dir = dir;
+                SetDir(arg3, dir);
                 rval = arg3;
             }
             else
@@ -661,70 +748,68 @@ namespace Simulator
 
         case RPC_rewinddir:
         {
-            VirtualDescriptor *vd = GetEntry(arg3);
-            if (vd == NULL || vd->dir == NULL)
+            VirtualDescriptor vd;
+            if (!LookupVFD(arg3, vd) || vd.dir == NULL)
             {
                 errno = EBADF;
                 rval = -1;
                 break;
             }
-            rewinddir(vd->dir);
+            rewinddir(vd.dir);
             rval = 0;
         }
         break;
 
         case RPC_telldir:
         {
-            VirtualDescriptor *vd = GetEntry(arg3);
-            if (vd == NULL || vd->dir == NULL)
+            VirtualDescriptor vd;
+            if (!LookupVFD(arg3, vd) || vd.dir == NULL)
             {
                 errno = EBADF;
                 rval = -1;
                 break;
             }
-            rval = telldir(vd->dir);
+            rval = telldir(vd.dir);
         }
         break;
 
         case RPC_seekdir:
         {
-            VirtualDescriptor *vd = GetEntry(arg3);
-            if (vd == NULL || vd->dir == NULL)
+            VirtualDescriptor vd;
+            if (!LookupVFD(arg3, vd) || vd.dir == NULL)
             {
                 errno = EBADF;
                 rval = -1;
                 break;
             }
-            seekdir(vd->dir, arg4);
+            seekdir(vd.dir, arg4);
             rval = 0;
         }
         break;
 
         case RPC_closedir:
         {
-            VirtualDescriptor *vd = GetEntry(arg3);
-            if (vd == NULL || vd->dir == NULL)
+            VirtualDescriptor vd;
+            if (!LookupVFD(arg3, vd) || vd.dir == NULL)
             {
                 errno = EBADF;
                 rval = -1;
                 break;
             }
-            rval = closedir(vd->dir);
-            if (rval == 0)
-                vd->active = false;
+            rval = closedir(vd.dir);
         }
         break;
 
         case RPC_readdir:
         {
-            VirtualDescriptor *vd = GetEntry(arg3);
-            if (vd == NULL || vd->dir == NULL)
+            VirtualDescriptor vd;
+            if (!LookupVFD(arg3, vd) || vd.dir == NULL)
             {
                 errno = EBADF;
                 rval = -1;
                 break;
             }
-            struct dirent *de = readdir(vd->dir);
+            struct dirent *de = readdir(vd.dir);
             if (de != NULL)
             {
                 size_t namlen = strlen(de->d_name) & 0xffff;
@@ -776,14 +861,21 @@ namespace Simulator
 
         // all unix calls returns a 64-bit value in little-endian format,
         // followed by 32-bit errno.
+        const int err = errno;
         res1.resize(12);
         SerializeRegister(RT_INTEGER, rval & 0xffffffffUL, &res1[0], 4);
         SerializeRegister(RT_INTEGER, (rval >> 32) & 0xffffffffUL, &res1[4], 4);
-        SerializeRegister(RT_INTEGER, errno, &res1[8], 4);
+        SerializeRegister(RT_INTEGER, err, &res1[8], 4);
 
+        lock_guard<mutex> lock(m_lock);
         ++m_nrequests;
-        if (errno != 0)
+        if (err != 0)
             ++m_nfailures;
+        m_nreads       += nreads;
+        m_nread_bytes  += nread_bytes;
+        m_nwrites      += nwrites;
+        m_nwrite_bytes += nwrite_bytes;
+        m_nstats       += nstats;
     }
 
 #undef RequireArgs
@@ -792,6 +884,7 @@ namespace Simulator
     {
         out << "The Unix interface provides a reduced POSIX interface to the host system." << endl
             << endl;
+        lock_guard<mutex> lock(m_lock);
         bool some = false;
         for (size_t i = 0; i < m_vfds.size(); ++i)
             if (m_vfds[i].active)
@@ -6,6 +6,7 @@
 #include <sim/inspect.h>
 
 #include <vector>
+#include <mutex>
 #include <dirent.h>
 
 namespace Simulator
@@ -31,10 +32,23 @@ namespace Simulator
 
         std::vector<VirtualDescriptor> m_vfds;
 
-        VirtualDescriptor* GetEntry(VirtualFD vfd);
-        VirtualFD GetNewVFD(HostFD new_hfd);
-        VirtualFD DuplicateVFD(VirtualFD original, HostFD new_hfd);
-        VirtualDescriptor* DuplicateVFD2(VirtualFD original, VirtualFD target);
+        // Service() can be called from the RPC worker threads of
+        // several RPC interfaces. This lock protects the descriptor
+        // table and the statistics; the host calls run without it.
+        mutable std::mutex m_lock;
+
+        // Accessors of the descriptor table, which take the lock.
+        // Lookups return a copy of the entry, as the table may grow.
+        // Descriptors are only allocated and released by Prepare() and
+        // Complete(), on the simulation thread; Service() fills in the
+        // host side of the descriptors allocated for it.
+        bool      LookupVFD(VirtualFD vfd, VirtualDescriptor& vd) const;
+        VirtualFD AllocateVFD(CycleNo cycle);
+        bool      ReserveVFD(VirtualFD vfd, CycleNo cycle);
+        void      SetHostFD(VirtualFD vfd, HostFD hfd, DIR* dir = NULL);
+        void      SetVFD(VirtualFD vfd, const VirtualDescriptor& vd);
+        void      SetDir(VirtualFD vfd, DIR* dir);
+        void      ReleaseVFD(VirtualFD vfd);
 
         // statistics
         DefineSampleVariable(uint64_t, nrequests);
@@ -49,12 +63,21 @@ namespace Simulator
 
         UnixInterface(const std::string& name, Object& parent);
 
+        uint64_t Prepare(uint32_t procedure_id,
+                         uint32_t arg3, uint32_t arg4,
+                         CycleNo cycle) override;
+
         void Service(uint32_t procedure_id,
                      std::vector<char>& res1, size_t res1_maxsize,
                      std::vector<char>& res2, size_t res2_maxsize,
                      const std::vector<char>& arg1,
                      const std::vector<char>& arg2,
-                     uint32_t arg3, uint32_t arg4) override;
+                     uint32_t arg3, uint32_t arg4,
+                     uint64_t context) override;
+
+        void Complete(uint32_t procedure_id,
+                      const std::vector<char>& res1,
+                      uint64_t context) override;
 
         const std::string& GetName() const override;
 
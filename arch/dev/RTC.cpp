@@ -5,30 +5,34 @@
 #include <csignal>
 #include <cerrno>
 #include <cstring>
+#include <atomic>
+#include <mutex>
 
 using namespace std;
 
 namespace Simulator
 {
 
-    /* the following implements a very crude semaphore.
+    /* The host clock is shared by all RTC clocks in the process.
 
        We want that several RTC clocks can update their time
        when a tick event is received. They could update more
        often but we want to limit syscall usage.
 
-       To do this we maintain a count of the RTC clocks
-       that have acknowledged the tickevent in "timerTicked".
-       The count is reset to the number of RTC clocks
-       every time SIGALRM ticks; each RTC clock's event
-       handler then decreases it.
+       To do this SIGALRM increments a tick counter, and each
+       RTC clock remembers the last tick it has acknowledged
+       in "lastTick". The counter and the time are atomic so
+       that RTC clocks of systems simulated in other threads
+       can read them.
+
+       The timer is set up once for the process, by the first
+       RTC clock, with its RTCMeatSpaceUpdateInterval.
     */
 
-    static volatile unsigned g_clockSemaphore = 0;
-    static unsigned g_clockListeners = 0;
+    static atomic<unsigned long> g_clockTicks(0);
 
     static clock_delay_t g_clockResolution = 0;
-    static volatile precise_time_t g_currentTime = 0;
+    static atomic<precise_time_t> g_currentTime(0);
 
     static void set_time(void)
     {
@@ -41,14 +45,14 @@ namespace Simulator
 
     static void alarm_handler(int)
     {
-        g_clockSemaphore = g_clockListeners;
         set_time();
+        ++g_clockTicks;
     }
 
     static void setup_clocks(clock_delay_t d)
     {
-        static bool initialized = false;
-        if (!initialized)
+        static once_flag initialized;
+        call_once(initialized, [d]()
         {
             g_clockResolution = d;
 
@@ -68,9 +72,7 @@ namespace Simulator
             {
                 throw exceptf<>("Cannot set timer: %s", strerror(errno));
             };
-
-            initialized = true;
-        }
+        });
     }
 
     const std::string& RTC::RTCInterface::GetIODeviceName() const
@@ -99,17 +101,27 @@ namespace Simulator
              IOMessageInterface& ioif, IODeviceID devid)
         : Object(name, parent),
           m_timerTicked(false),
+          m_lastTick(0),
           InitStateVariable(timeOfLastInterrupt, 0),
           InitStateVariable(triggerDelay, 0),
           InitStateVariable(deliverAllEvents, true),
           InitStorage(m_enableCheck, rtcclock, false),
+          m_journal(GetKernel()->GetInputJournal()),
+          m_journalTime(0),
+          m_journalTicks(0),
           m_businterface("if", *this, ioif, devid),
           InitProcess(p_checkTime, DoCheckTime)
     {
 
+        if (m_journal != NULL)
+        {
+            m_journalTime = m_journal->RegisterSource(GetName() + ".time");
+            m_journalTicks = m_journal->RegisterSource(GetName() + ".ticks");
+        }
+
         setup_clocks(GetTopConf("RTCMeatSpaceUpdateInterval", clock_delay_t));
-        m_timeOfLastInterrupt = g_currentTime;
-        ++g_clockListeners;
+        m_timeOfLastInterrupt = JournalTime(g_currentTime);
+        m_lastTick = g_clockTicks;
         m_enableCheck.Sensitive(p_checkTime);
 
         p_checkTime.SetStorageTraces(opt(m_businterface.m_doNotify));
@@ -126,19 +138,48 @@ namespace Simulator
         return SUCCESS;
     }
 
+    uint64_t RTC::JournalTime(uint64_t host_value)
+    {
+        if (m_journal == NULL)
+            return host_value;
+
+        CycleNo cycle = m_enableCheck.GetClock().GetCycleNo();
+        if (m_journal->IsReplaying())
+        {
+            uint64_t value;
+            m_journal->Replay(m_journalTime, cycle, value);
+            return value;
+        }
+        m_journal->Record(m_journalTime, cycle, host_value);
+        return host_value;
+    }
+
     Result RTC::DoCheckTime()
     {
-        if (!m_timerTicked && (g_clockSemaphore != 0))
+        const bool replay = (m_journal != NULL && m_journal->IsReplaying());
+        const CycleNo cycle = m_enableCheck.GetClock().GetCycleNo();
+        precise_time_t now = g_currentTime;
+
+        if (replay)
         {
-            m_timerTicked = true;
-            --g_clockSemaphore;
+            // The ticks come from the journal, not from SIGALRM.
+            m_timerTicked = m_journal->Peek(m_journalTicks, cycle, now);
+        }
+        else if (!m_timerTicked)
+        {
+            unsigned long ticks = g_clockTicks;
+            if (ticks != m_lastTick)
+            {
+                m_timerTicked = true;
+                m_lastTick = ticks;
+            }
         }
 
         if (m_timerTicked)
         {
             // The clock is configured to deliver interrupts. Check
             // for this.
-            if (m_timeOfLastInterrupt + m_triggerDelay <= g_currentTime)
+            if (m_timeOfLastInterrupt + m_triggerDelay <= now)
             {
                 // Time for an interrupt.
                 m_businterface.m_doNotify.Set();
@@ -150,12 +191,16 @@ namespace Simulator
                     }
                     else
                     {
-                        m_timeOfLastInterrupt = g_currentTime;
+                        m_timeOfLastInterrupt = now;
                     }
                 }
             }
             COMMIT {
                 m_timerTicked = false;
+                if (replay)
+                    m_journal->Replay(m_journalTicks, cycle, now);
+                else if (m_journal != NULL)
+                    m_journal->Record(m_journalTicks, cycle, now);
             }
         }
         return SUCCESS;
@@ -226,7 +271,7 @@ namespace Simulator
             {
                 if (value != 0)
                 {
-                    rtc.m_timeOfLastInterrupt = g_currentTime;
+                    rtc.m_timeOfLastInterrupt = rtc.JournalTime(g_currentTime);
                     rtc.m_enableCheck.Set();
                 }
                 else
@@ -288,20 +333,20 @@ namespace Simulator
             case 1:   value = rtc.m_triggerDelay; break;
             case 2:   value = m_interruptNumber; break;
             case 3:   value = (int)rtc.m_deliverAllEvents; break;
-            case 4:   value = g_currentTime % 1000000; break;
-            case 5:   value = g_currentTime / 1000000; break;
+            case 4:   value = rtc.JournalTime(g_currentTime % 1000000); break;
+            case 5:   value = rtc.JournalTime(g_currentTime / 1000000); break;
             case 6: case 7:
             {
                 time_t c = time(0);
                 struct tm * tm = gmtime(&c);
-                value = pack_time(tm, word - 6);
+                value = rtc.JournalTime(pack_time(tm, word - 6));
                 break;
             }
             case 8: case 9:
             {
                 time_t c = time(0);
                 struct tm * tm = localtime(&c);
-                value = pack_time(tm, word - 8);
+                value = rtc.JournalTime(pack_time(tm, word - 8));
                 break;
             }
             }
@@ -6,6 +6,7 @@
 #include "sim/kernel.h"
 #include "sim/config.h"
 #include "sim/flag.h"
+#include "sim/journal.h"
 
 #include <ctime>
 #include <sys/time.h>
@@ -19,6 +20,7 @@ namespace Simulator
     class RTC : public Object
     {
         bool            m_timerTicked;
+        unsigned long   m_lastTick;     ///< Last tick of the host clock acknowledged
 
         DefineStateVariable(precise_time_t, timeOfLastInterrupt);
         DefineStateVariable(clock_delay_t, triggerDelay);
@@ -26,6 +28,13 @@ namespace Simulator
 
         Flag            m_enableCheck;
 
+        // The host time and the timer ticks are journaled, if enabled.
+        InputJournal*          m_journal;
+        InputJournal::SourceID m_journalTime;   ///< Values of the host time
+        InputJournal::SourceID m_journalTicks;  ///< Timer ticks, with the host time
+
+        // Journal a value derived from the host time, or replay it.
+        uint64_t JournalTime(uint64_t host_value);
 
         class RTCInterface : public IIOMessageClient, public Object
         {
@@ -64,6 +73,8 @@ namespace Simulator
 
         RTC(const std::string& name, Object& parent, Clock& clock,
             IOMessageInterface& ioif, IODeviceID devid);
+        RTC(const RTC&) = delete;
+        RTC& operator=(const RTC&) = delete;
 
         Process p_checkTime;
 
@@ -2,6 +2,8 @@
 #include <sim/except.h>
 
 #include <map>
+#include <algorithm>
+#include <set>
 #include <iomanip>
 #include <cstring>
 #include <cerrno>
@@ -26,51 +28,92 @@ using namespace std;
 
 namespace Simulator
 {
-    namespace Event
+    static
+    void selector_delegate_callback(ev::io& io, int revents)
     {
+        // cerr << "I/O ready on fd " << fd << ", mode " << mode << endl;
+        int st = 0;
+        if (revents & ev::READ) st |= Selector::READABLE;
+        if (revents & ev::WRITE) st |= Selector::WRITABLE;
+        if (st != 0)
+            ((Selector*)io.data)->OnEvent(io.fd, (Selector::StreamState)st);
+    }
 
-        static
-        struct ev_loop *evbase;
-
-        static
-        map<int, ev::io*>  handlers;
-
-        static
-        bool current_result = true;
+    // A stream event in the input journal. The streams are
+    // identified by their order of registration, since the host file
+    // descriptors may differ between runs.
+    struct JournalEvent
+    {
+        uint32_t stream;
+        int32_t  state;
+    };
 
-        static
-        size_t handler_count;
+    void Selector::OnEvent(int fd, StreamState state)
+    {
+        auto i = m_streams.find(fd);
+        assert(i != m_streams.end());
+        if (m_journal != NULL)
+        {
+            JournalEvent ev = { i->second.id, (int32_t)state };
+            m_journal->Record(m_journalEvents, m_doCheckStreams.GetClock().GetCycleNo(), ev);
+        }
+        m_ready[fd] |= state;
+    }
 
-        static
-        void selector_delegate_callback(ev::io& io, int revents)
+    void Selector::ReplayEvents()
+    {
+        const CycleNo cycle = m_doCheckStreams.GetClock().GetCycleNo();
+        JournalEvent ev;
+        while (m_journal->Peek(m_journalEvents, cycle, ev))
         {
-            // cerr << "I/O ready on fd " << fd << ", mode " << mode << endl;
-            ISelectorClient* client = (ISelectorClient*)io.data;
+            m_journal->Replay(m_journalEvents, cycle, ev);
 
-            int st = 0;
-            if (revents & ev::READ) st |= Selector::READABLE;
-            if (revents & ev::WRITE) st |= Selector::WRITABLE;
-            if (st != 0)
+            auto i = find_if(m_streams.begin(), m_streams.end(),
+                             [&](const pair<const int, Stream>& s) { return s.second.id == ev.stream; });
+            if (i == m_streams.end())
             {
-                current_result &= client->OnStreamReady(io.fd, (Selector::StreamState)st);
-                ++handler_count;
+                throw exceptf<SimulationException>(*this, "Replayed event for unregistered stream %u", (unsigned)ev.stream);
             }
+            m_ready[i->first] |= ev.state;
         }
     }
 
-    static map<int, int> fd_flags;
+    void Selector::SetPending(int fd)
+    {
+        m_pending.insert(fd);
+    }
+
+    void Selector::DispatchEvents()
+    {
+        // Each client is called at most once per stream and check,
+        // with the host events and its pending request merged.
+        map<int, int> ready;
+        ready.swap(m_ready);
+        for (int fd : m_pending)
+            ready[fd] |= BUFFERED;
+        m_pending.clear();
+
+        for (auto& e : ready)
+        {
+            auto i = m_streams.find(e.first);
+            if (i == m_streams.end())
+                continue;
+            m_currentResult &= i->second.client->OnStreamReady(e.first, (StreamState)e.second);
+            ++m_handlerCount;
+        }
+    }
 
     void Selector::Enable()
     {
-        for (auto& i : Event::handlers)
+        for (auto& i : m_streams)
         {
-            int fd = i.second->fd;
+            int fd = i.first;
             int r = fcntl(fd, F_GETFL, 0);
             if (r == -1)
             {
                 cerr << "Unable to get fd flags for " << fd << ": " << strerror(errno) << endl;
             }
-            fd_flags[fd] = r;
+            i.second.flags = r;
             r = fcntl(fd, F_SETFL, r | O_NONBLOCK);
             if (r == -1)
             {
@@ -81,12 +124,12 @@ namespace Simulator
 
     void Selector::Disable()
     {
-        for (auto& i : Event::handlers)
+        for (auto& i : m_streams)
         {
-            int fd = i.second->fd;
-            if (fd_flags.find(fd) == fd_flags.end())
+            int fd = i.first;
+            if (i.second.flags == -1)
                 continue;
-            int r = fcntl(fd, F_SETFL, fd_flags[fd] & ~O_NONBLOCK);
+            int r = fcntl(fd, F_SETFL, i.second.flags & ~O_NONBLOCK);
             if (r == -1)
             {
                 cerr << "Unable to reset non-blocking flags for " << fd << ": " << strerror(errno) << endl;
@@ -94,26 +137,19 @@ namespace Simulator
         }
     }
 
-    Selector& Selector::GetSelector()
-    {
-        assert(m_singleton != NULL);
-        return *m_singleton;
-    }
-
     bool Selector::RegisterStream(int fd, ISelectorClient& callback)
     {
-        if (Event::handlers.find(fd) != Event::handlers.end())
+        if (m_streams.find(fd) != m_streams.end())
         {
             throw exceptf<InvalidArgumentException>(*this, "Handler already registered for fd %d", fd);
         }
 
-        ev::io * &ev = Event::handlers[fd];
-
-        assert(Event::evbase != NULL);
+        assert(m_evloop != NULL);
 
-        ev = new ev::io(Event::evbase);
-        ev->set<Event::selector_delegate_callback>(&callback);
+        ev::io *ev = new ev::io(m_evloop);
+        ev->set<selector_delegate_callback>(this);
         ev->start(fd, EV_READ|EV_WRITE);
+        m_streams[fd] = Stream{ev, &callback, m_nextStreamId++, -1};
 
         if (!m_doCheckStreams.IsSet())
             m_doCheckStreams.Set();
@@ -122,17 +158,19 @@ namespace Simulator
 
     bool Selector::UnregisterStream(int fd)
     {
-        auto i = Event::handlers.find(fd);
-        if (i == Event::handlers.end())
+        auto i = m_streams.find(fd);
+        if (i == m_streams.end())
         {
             throw exceptf<InvalidArgumentException>(*this, "No handler registered for fd %d", fd);
         }
 
         // the following stops the event handler automatically
-        delete i->second;
-        Event::handlers.erase(i);
+        delete i->second.watcher;
+        m_streams.erase(i);
+        m_ready.erase(fd);
+        m_pending.erase(fd);
 
-        if (Event::handlers.empty())
+        if (m_streams.empty())
             m_doCheckStreams.Clear();
 
         return true;
@@ -140,16 +178,16 @@ namespace Simulator
 
     Result Selector::DoCheckStreams()
     {
-        assert(Event::evbase != NULL);
+        assert(m_evloop != NULL);
 
         // we catch up I/O stalls only at the next cycle because we
         // cannot really check for I/O events 3 times per cycle, and
         // we cannot report failure at the commit phase if it was not
         // also reported at the check phase.
-        if (Event::current_result == false)
+        if (m_currentResult == false)
         {
             DeadlockWrite("Some stream handler could not process their I/O event");
-            Event::current_result = true;
+            m_currentResult = true;
             return FAILED;
         }
 
@@ -161,11 +199,16 @@ namespace Simulator
             // Unfortunately, libev/kqueue only reports writability once
             // in a while, so we end up losing opportunities to send/write by calling
             // the loop too often.
-            Event::current_result = true;
-            Event::handler_count = 0;
-            ev_loop(Event::evbase, EVLOOP_NONBLOCK);
-
-            if (Event::handler_count == 0)
+            m_currentResult = true;
+            m_handlerCount = 0;
+            if (m_journal != NULL && m_journal->IsReplaying())
+                // The events come from the journal, not from the host.
+                ReplayEvents();
+            else
+                ev_loop(m_evloop, EVLOOP_NONBLOCK);
+            DispatchEvents();
+
+            if (m_handlerCount == 0)
             {
                 DebugIONetWrite("No I/O streams are ready.");
             }
@@ -174,40 +217,44 @@ namespace Simulator
         return SUCCESS;
     }
 
-    Selector* Selector::m_singleton = NULL;
-
     Selector::Selector(const std::string& name, Object& parent, Clock& clock)
         : Object(name, parent),
+          m_evloop(NULL),
+          m_streams(),
+          m_nextStreamId(0),
+          m_ready(),
+          m_pending(),
+          m_currentResult(true),
+          m_handlerCount(0),
           InitStorage(m_doCheckStreams, clock, false),
+          m_journal(GetKernel()->GetInputJournal()),
+          m_journalEvents(0),
           InitProcess(p_checkStreams, DoCheckStreams)
     {
-        if (m_singleton != NULL)
-        {
-            throw InvalidArgumentException(*this, "More than one selector defined, previous at " + m_singleton->GetName());
-        }
-        m_singleton = this;
-
         // debug
         // event_enable_debug_mode();
 
-        assert(Event::evbase == NULL);
-        Event::evbase = ev_default_loop(0);
-        if (Event::evbase == NULL)
+        // Not the default loop: each selector has its own, so that
+        // several systems can be simulated in the same process.
+        m_evloop = ev_loop_new(EVFLAG_AUTO);
+        if (m_evloop == NULL)
         {
             throw InvalidArgumentException(*this, "Unable to initialize libev, bad LIBEV_FLAGS in environment?");
         }
 
         m_doCheckStreams.Sensitive(p_checkStreams);
+
+        if (m_journal != NULL)
+            m_journalEvents = m_journal->RegisterSource(GetName() + ".events");
     }
 
     Selector::~Selector()
     {
-        for (auto& i : Event::handlers)
-            delete i.second;
-
-        Event::handlers.clear();
+        for (auto& i : m_streams)
+            delete i.second.watcher;
+        m_streams.clear();
 
-        m_singleton = NULL;
+        ev_loop_destroy(m_evloop);
     }
 
 
@@ -219,7 +266,7 @@ namespace Simulator
             << "Currently checking: " << (m_doCheckStreams.IsSet() ? "yes" : "no") << endl
             << "Checking method: ";
 
-        unsigned backend = ev_backend(Event::evbase);
+        unsigned backend = ev_backend(m_evloop);
         switch(backend)
         {
         case ev::SELECT: cout << "select"; break;
@@ -233,7 +280,7 @@ namespace Simulator
 
         out << endl;
 
-        if (Event::handlers.empty())
+        if (m_streams.empty())
         {
             out << "No file descriptors registered." << endl;
         }
@@ -242,13 +289,11 @@ namespace Simulator
             out << endl
                 << "FD  | Client" << endl
                 << "----+------------------" << endl;
-            for (auto& i : Event::handlers)
+            for (auto& i : m_streams)
             {
-                auto callback = (ISelectorClient*)i.second->data;
-                assert(callback != NULL);
                 out << setw(3) << setfill(' ') << i.first
                     << " | "
-                    << callback->GetSelectorClientName()
+                    << i.second.client->GetSelectorClientName()
                     << endl;
             }
         }
@@ -6,30 +6,64 @@
 #include "sim/kernel.h"
 #include "sim/flag.h"
 #include "sim/inspect.h"
+#include "sim/journal.h"
+
+#include <map>
+#include <set>
 
 class Config;
 
+struct ev_loop;
+namespace ev { struct io; }
+
 namespace Simulator
 {
 
     class ISelectorClient;
 
+    // Selector: monitors the host streams of the I/O devices.
+    //
+    // Each selector uses its own event loop, so that several
+    // simulated systems can run side by side in the same process.
     class Selector : public Object, public Inspect::Interface<Inspect::Info>
     {
-        static Selector*     m_singleton;
+        struct Stream
+        {
+            ev::io*          watcher;
+            ISelectorClient* client;
+            uint32_t         id;     ///< Journal identifier, in order of registration
+            int              flags;  ///< Host fd flags saved by Enable(), or -1
+        };
+
+        struct ev_loop*      m_evloop;
+        std::map<int, Stream> m_streams;
+        uint32_t             m_nextStreamId;
+        std::map<int, int>   m_ready;         ///< Events collected during a check, as fd -> state
+        std::set<int>        m_pending;       ///< Streams with buffered input, see SetPending()
+        bool                 m_currentResult;
+        size_t               m_handlerCount;
 
         Flag       m_doCheckStreams;
 
+        InputJournal*           m_journal;
+        InputJournal::SourceID  m_journalEvents;  ///< Stream events, as (fd, state)
+
+        void ReplayEvents();
+        void DispatchEvents();
+
     public:
 
         enum StreamState
         {
             READABLE = 1,
             WRITABLE = 2,
+            BUFFERED = 4,  ///< The client has buffered input left, see SetPending()
         };
 
         Selector(const std::string& name, Object& parent, Clock& clock);
         ~Selector();
+        Selector(const Selector&) = delete;
+        Selector& operator=(const Selector&) = delete;
 
         Process p_checkStreams;
 
@@ -38,7 +72,15 @@ namespace Simulator
         bool RegisterStream(int fd, ISelectorClient& callback);
         bool UnregisterStream(int fd);
 
-        static Selector& GetSelector();
+        // Request that the client of a stream be called at the next
+        // check with BUFFERED set, even if the stream itself is not
+        // ready. This lets clients that read the host streams in
+        // batches deliver the data they buffered at the rate of the
+        // checks.
+        void SetPending(int fd);
+
+        // Called by the event loop when a stream is ready.
+        void OnEvent(int fd, StreamState state);
 
         // Admin
         void Enable();
@@ -1,6 +1,7 @@
 #include "UART.h"
 #include "sim/config.h"
 #include <iomanip>
+#include <algorithm>
 #include <cstring>
 #include <cstdlib>
 #include <cstdio>
@@ -39,11 +40,12 @@ namespace Simulator
     // - transmit speed / divisor latch is not supported
 
     UART::UART(const string& name, Object& parent,
-               IOMessageInterface& ioif, IODeviceID devid)
+               IOMessageInterface& ioif, IODeviceID devid, Selector& selector)
         : Object(name, parent),
 
           m_ioif(ioif),
           m_devid(devid),
+          m_selector(selector),
           m_clock(m_ioif.RegisterClient(devid, *this)),
 
           InitStateVariable(hwbuf_in_full, false),
@@ -89,11 +91,23 @@ namespace Simulator
           m_fd_out(-1),
           InitStateVariable(enabled, false),
 
+          m_host_in(GetConf("UARTHostBufferSize", size_t)),
+          m_host_out(GetConf("UARTHostBufferSize", size_t)),
+
+          m_journal(GetKernel()->GetInputJournal()),
+          m_journalRead(0),
+          m_journalWrite(0),
+
           InitProcess(p_dummy, DoNothing)
     {
         int ein, eout;
         string fin, fout;
 
+        if (m_host_in.capacity() == 0)
+        {
+            throw exceptf<InvalidArgumentException>(*this, "UARTHostBufferSize must be at least 1");
+        }
+
         string connectMode = GetConf("UARTConnectMode", string);
 
         errno = 0;
@@ -185,9 +199,37 @@ namespace Simulator
         m_writeInterrupt.Sensitive(p_WriteInterrupt);
         m_fifo_in.Sensitive(p_dummy);
 
+        p_Receive.SetStorageTraces(opt(m_fifo_in * opt(m_readInterrupt) * m_receiveEnable));
+        p_Transmit.SetStorageTraces(opt(opt(m_fifo_in * opt(m_readInterrupt)) * opt(m_writeInterrupt) * m_fifo_out));
+        p_Send.SetStorageTraces(opt(m_fifo_out * opt(m_writeInterrupt) * m_sendEnable));
+        p_ReadInterrupt.SetStorageTraces(m_ioif.GetRequestTraces(m_devid));
+        p_WriteInterrupt.SetStorageTraces(m_ioif.GetRequestTraces(m_devid));
+
+        if (m_journal != NULL)
+        {
+            m_journalRead = m_journal->RegisterSource(GetName() + ".read");
+            m_journalWrite = m_journal->RegisterSource(GetName() + ".write");
+        }
+
         RegisterModelObject(*this, "uart");
         RegisterModelProperty(*this, "inpfifosz", m_fifo_in.GetMaxSize());
         RegisterModelProperty(*this, "outfifosz", m_fifo_out.GetMaxSize());
+        RegisterModelProperty(*this, "hostbufsz", m_host_in.capacity());
+    }
+
+    UART::~UART()
+    {
+        // Send the output still staged. This is not journaled, and
+        // the host stream may still be non-blocking, so this is best
+        // effort.
+        while (!m_host_out.Empty())
+        {
+            struct iovec iov[2];
+            ssize_t res = writev(m_fd_out, iov, m_host_out.GetUsed(iov));
+            if (res <= 0)
+                break;
+            m_host_out.Consume(res);
+        }
     }
 
     Result UART::DoSendReadInterrupt()
@@ -303,7 +345,7 @@ namespace Simulator
 
     StorageTraceSet UART::GetReadRequestTraces() const
     {
-        return (opt(opt(m_readInterrupt) * m_fifo_in)
+        return (opt(m_readInterrupt)
                 ^ opt(m_writeInterrupt)) * m_ioif.GetRequestTraces(m_devid);
     }
 
@@ -402,9 +444,9 @@ namespace Simulator
                 m_writeInterrupt.Clear();
                 m_readInterrupt.Clear();
                 COMMIT {
-                    Selector::GetSelector().UnregisterStream(m_fd_in);
+                    m_selector.UnregisterStream(m_fd_in);
                     if (m_fd_in != m_fd_out)
-                        Selector::GetSelector().UnregisterStream(m_fd_out);
+                        m_selector.UnregisterStream(m_fd_out);
                     m_enabled = false;
                 }
             }
@@ -412,9 +454,9 @@ namespace Simulator
             {
                 DebugIOWrite("Activating the UART");
                 COMMIT {
-                    Selector::GetSelector().RegisterStream(m_fd_in, *this);
+                    m_selector.RegisterStream(m_fd_in, *this);
                     if (m_fd_in != m_fd_out)
-                        Selector::GetSelector().RegisterStream(m_fd_out, *this);
+                        m_selector.RegisterStream(m_fd_out, *this);
                     m_enabled = true;
                 }
             }
@@ -574,20 +616,149 @@ namespace Simulator
     }
 
 
-    bool UART::OnStreamReady(int fd, Selector::StreamState state)
+    int UART::HostBuffer::GetUsed(struct iovec iov[2])
     {
-        // fprintf(stderr, "External fd %d is ready for I/O (state %d) in %d out %d\n", fd, (int)state, m_fd_in, m_fd_out);
+        size_t first = std::min(m_count, m_data.size() - m_head);
+        iov[0].iov_base = &m_data[m_head];
+        iov[0].iov_len = first;
+        iov[1].iov_base = &m_data[0];
+        iov[1].iov_len = m_count - first;
+        return (m_count > first) ? 2 : 1;
+    }
+
+    int UART::HostBuffer::GetFree(struct iovec iov[2])
+    {
+        size_t tail = (m_head + m_count) % m_data.size();
+        size_t avail = m_data.size() - m_count;
+        size_t first = std::min(avail, m_data.size() - tail);
+        iov[0].iov_base = &m_data[tail];
+        iov[0].iov_len = first;
+        iov[1].iov_base = &m_data[0];
+        iov[1].iov_len = avail - first;
+        return (avail > first) ? 2 : 1;
+    }
+
+    // The outcome of a host transfer, as journaled. For reads, the
+    // data read follows.
+    struct TransferOutcome
+    {
+        int32_t res;
+        int32_t err;
+    };
+
+    ssize_t UART::ReadHost(int fd)
+    {
+        struct iovec iov[2];
+        int n = m_host_in.GetFree(iov);
+        TransferOutcome t;
 
-        if (fd == m_fd_in && (state & Selector::READABLE))
+        if (m_journal != NULL && m_journal->IsReplaying())
         {
-            // fprintf(stderr, "External fd %d is readable\n", fd);
-            if (m_hwbuf_in_full)
+            // The input comes from the journal.
+            vector<char> entry;
+            m_journal->Replay(m_journalRead, m_clock.GetCycleNo(), entry);
+            if (entry.size() < sizeof(t))
             {
-                DeadlockWrite("Cannot acquire byte, input latch busy");
+                throw exceptf<SimulationException>(*this, "Invalid journal entry for host read");
             }
-            else
+            memcpy(&t, entry.data(), sizeof(t));
+            size_t size = entry.size() - sizeof(t);
+            if (size > m_host_in.capacity() - m_host_in.size())
+            {
+                throw exceptf<SimulationException>(*this, "Replayed host read does not fit in the staging buffer");
+            }
+            const char *data = entry.data() + sizeof(t);
+            for (int i = 0; i < n && size > 0; ++i)
             {
-                ssize_t res = read(fd, &m_hwbuf_in, 1);
+                size_t sz = std::min(size, (size_t)iov[i].iov_len);
+                memcpy(iov[i].iov_base, data, sz);
+                data += sz;
+                size -= sz;
+            }
+            if (t.res > 0)
+                m_host_in.Produce(t.res);
+            errno = t.err;
+            return t.res;
+        }
+
+        errno = 0;
+        ssize_t res = readv(fd, iov, n);
+        if (m_journal != NULL)
+        {
+            t.res = res;
+            t.err = errno;
+            vector<char> entry((const char*)&t, (const char*)(&t + 1));
+            size_t size = (res > 0) ? res : 0;
+            for (int i = 0; i < n && size > 0; ++i)
+            {
+                size_t sz = std::min(size, (size_t)iov[i].iov_len);
+                entry.insert(entry.end(), (const char*)iov[i].iov_base, (const char*)iov[i].iov_base + sz);
+                size -= sz;
+            }
+            m_journal->Record(m_journalRead, m_clock.GetCycleNo(), entry);
+        }
+        if (res > 0)
+            m_host_in.Produce(res);
+        return res;
+    }
+
+    ssize_t UART::WriteHost(int fd)
+    {
+        struct iovec iov[2];
+        int n = m_host_out.GetUsed(iov);
+
+        if (m_journal != NULL && m_journal->IsReplaying())
+        {
+            // The output is still written, but its outcome is the
+            // recorded one.
+            TransferOutcome t;
+            m_journal->Replay(m_journalWrite, m_clock.GetCycleNo(), t);
+            if (t.res > (ssize_t)m_host_out.size())
+            {
+                throw exceptf<SimulationException>(*this, "Replayed host write is larger than the staged output");
+            }
+            if (t.res > 0)
+            {
+                // Only write what the recorded write took, since the
+                // rest is written again by the next flush.
+                size_t size = t.res;
+                int    m    = 0;
+                for (; m < n && size > 0; ++m)
+                {
+                    iov[m].iov_len = std::min(size, (size_t)iov[m].iov_len);
+                    size -= iov[m].iov_len;
+                }
+                (void)writev(fd, iov, m);
+                m_host_out.Consume(t.res);
+            }
+            errno = t.err;
+            return t.res;
+        }
+
+        errno = 0;
+        ssize_t res = writev(fd, iov, n);
+        if (m_journal != NULL)
+        {
+            TransferOutcome t = { (int32_t)res, errno };
+            m_journal->Record(m_journalWrite, m_clock.GetCycleNo(), t);
+        }
+        if (res > 0)
+            m_host_out.Consume(res);
+        return res;
+    }
+
+    bool UART::OnStreamReady(int fd, Selector::StreamState state)
+    {
+        // fprintf(stderr, "External fd %d is ready for I/O (state %d) in %d out %d\n", fd, (int)state, m_fd_in, m_fd_out);
+
+        if (fd == m_fd_in && (state & (Selector::READABLE|Selector::BUFFERED)))
+        {
+            // Refill the staging buffer from the host stream once it
+            // is drained, then move one byte to the input latch.
+            if ((state & Selector::READABLE) && m_host_in.Empty())
+            {
+                // fprintf(stderr, "External fd %d is readable\n", fd);
+                ssize_t res = ReadHost(fd);
                 if (res == 0)
                 {
                     m_eof = true;
@@ -605,19 +776,47 @@ namespace Simulator
                 }
                 else
                 {
-                    assert(res == 1);
+                    DebugIOWrite("Staged %u bytes from fd %d", (unsigned)res, fd);
+                }
+            }
+
+            if (!m_host_in.Empty())
+            {
+                if (m_hwbuf_in_full)
+                {
+                    DeadlockWrite("Cannot acquire byte, input latch busy");
+                }
+                else
+                {
+                    m_hwbuf_in = m_host_in.Pop();
                     m_hwbuf_in_full = true;
                     m_receiveEnable.Set();
                     DebugIOWrite("Acquired one byte from fd %d to input latch: %#02x", fd, (unsigned)m_hwbuf_in);
                 }
+
+                // Deliver the rest at the next checks.
+                if (!m_host_in.Empty())
+                    m_selector.SetPending(fd);
             }
         }
 
         if (fd == m_fd_out && (state & Selector::WRITABLE))
         {
-            if (m_hwbuf_out_full)
+            bool staged = false;
+            if (m_hwbuf_out_full && !m_host_out.Full())
             {
-                ssize_t res = write(fd, &m_hwbuf_out, 1);
+                m_host_out.Push(m_hwbuf_out);
+                m_hwbuf_out_full = false;
+                staged = true;
+                DebugIOWrite("Staged one byte from output latch for fd %d: %#02x", fd, (unsigned)m_hwbuf_out);
+            }
+
+            // Write the staged bytes when the staging buffer is full,
+            // or when the output pauses, i.e. at the first check that
+            // brings no new byte.
+            if (!m_host_out.Empty() && (m_host_out.Full() || !staged))
+            {
+                ssize_t res = WriteHost(fd);
                 if (res < 0)
                 {
                     // we might get spurious availability events. Only
@@ -630,16 +829,9 @@ namespace Simulator
                 }
                 else
                 {
-                    assert(res == 1);
-                    DebugIOWrite("Sent one byte from output latch to fd %d: %#02x", fd, (unsigned)m_hwbuf_out);
-                    m_hwbuf_out_full = false;
+                    DebugIOWrite("Sent %u staged bytes to fd %d", (unsigned)res, fd);
                 }
             }
-            else
-            {
-                /* nothing to do */
-                /* DebugIOWrite("Output latch empty, nothing to send"); */
-            }
         }
         return true;
     }
@@ -669,6 +861,8 @@ namespace Simulator
             << endl
             << "Stream output latch: " << (m_hwbuf_out_full ? "full" : "empty") << endl
             << "Stream input latch: " << (m_hwbuf_in_full ? "full" : "empty") << endl
+            << "Host output buffer: " << m_host_out.size() << "/" << m_host_out.capacity() << " bytes" << endl
+            << "Host input buffer: " << m_host_in.size() << "/" << m_host_in.capacity() << " bytes" << endl
             << "Input error condition: " << (m_error_in ? strerror(m_error_in) : "(no error)") << endl
             << "Output error condition: " << (m_error_out ? strerror(m_error_out) : "(no error)")<< endl
             << "End-of-file reached: " << (m_eof ? "yes" : "no") << endl;
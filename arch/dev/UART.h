@@ -10,6 +10,8 @@
 #include "sim/buffer.h"
 #include "sim/inspect.h"
 
+#include <sys/uio.h>
+
 class Config;
 
 namespace Simulator
@@ -20,6 +22,7 @@ namespace Simulator
     {
         IOMessageInterface& m_ioif;
         IODeviceID m_devid;
+        Selector&  m_selector;
         Clock& m_clock;
 
         DefineStateVariable(bool, hwbuf_in_full);
@@ -71,12 +74,56 @@ namespace Simulator
         int m_fd_out;
         DefineStateVariable(bool, enabled);
 
+        // Host-side staging buffers between the latches and the
+        // host streams. The latches still move one byte per check
+        // of the selector, but the host streams are read and written
+        // in batches.
+        class HostBuffer
+        {
+            std::vector<unsigned char> m_data;
+            size_t                     m_head;   ///< Index of the first byte
+            size_t                     m_count;  ///< Number of bytes held
+
+        public:
+            HostBuffer(size_t size) : m_data(size), m_head(0), m_count(0) {}
+
+            size_t size() const { return m_count; }
+            size_t capacity() const { return m_data.size(); }
+            bool   Empty() const { return m_count == 0; }
+            bool   Full() const { return m_count == m_data.size(); }
+
+            // Describe the bytes held, or the free space, as at
+            // most two segments. Return the number of segments.
+            int GetUsed(struct iovec iov[2]);
+            int GetFree(struct iovec iov[2]);
+
+            void Produce(size_t n) { m_count += n; }
+            void Consume(size_t n) { m_head = (m_head + n) % m_data.size(); m_count -= n; }
+
+            void Push(unsigned char byte) { m_data[(m_head + m_count) % m_data.size()] = byte; ++m_count; }
+            unsigned char Pop() { unsigned char byte = m_data[m_head]; Consume(1); return byte; }
+        };
+
+        HostBuffer m_host_in;
+        HostBuffer m_host_out;
+
+        // Outcomes of the host reads and writes are journaled, if
+        // enabled.
+        InputJournal*          m_journal;
+        InputJournal::SourceID m_journalRead;
+        InputJournal::SourceID m_journalWrite;
+        ssize_t ReadHost(int fd);
+        ssize_t WriteHost(int fd);
+
         Process p_dummy;
         Result DoNothing() { COMMIT{ p_dummy.Deactivate(); }; return SUCCESS; }
 
     public:
         UART(const std::string& name, Object& parent,
-             IOMessageInterface& iobus, IODeviceID devid);
+             IOMessageInterface& iobus, IODeviceID devid, Selector& selector);
+        UART(const UART&) = delete;
+        UART& operator=(const UART&) = delete;
+        ~UART();
 
 
         // from IIOBusClient
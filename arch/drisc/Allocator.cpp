@@ -1472,7 +1472,7 @@ Result Allocator::DoBundle()
         }
 
         Result      result;
-        if ((result = m_dcache.Read(info.addr, &m_bundleData[0], sizeof(Integer) * 2 + sizeof(MemAddr), 0)) == FAILED)
+        if ((result = m_dcache.Read(info.addr, &m_bundleData[0], sizeof(Integer) * 2 + sizeof(MemAddr), 0, 0, INVALID_LFID)) == FAILED)
         {
             DeadlockWrite("Unable to fetch the D-Cache line for %#016llx for bundle creation", (unsigned long long)info.addr);
             return FAILED;
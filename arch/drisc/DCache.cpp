@@ -21,18 +21,29 @@ DCache::DCache(const std::string& name, DRISC& parent, Clock& clock)
     m_memory(NULL),
     m_mcid(0),
     m_lines(),
-    m_data(),
-    m_valid(0),
+    m_data(NULL),
+    m_tags(),
 
     m_assoc          (GetConf("Associativity", size_t)),
     m_sets           (GetConf("NumSets", size_t)),
     m_lineSize       (GetTopConf("CacheLineSize", size_t)),
     m_selector       (IBankSelector::makeSelector(*this, GetConf("BankSelector", string), m_sets)),
+    m_replacement    (NULL),
     InitBuffer(m_read_responses, clock, "ReadResponsesBufferSize"),
     InitBuffer(m_write_responses, clock, "WriteResponsesBufferSize"),
     InitBuffer(m_writebacks, clock, "ReadWritebacksBufferSize"),
     InitBuffer(m_outgoing, clock, "OutgoingBufferSize"),
     m_wbstate(),
+    m_prefetch        (false),
+    m_prefetchIndex   (PREFETCH_INDEX_PC),
+    m_prefetchDegree  (GetConfOpt("PrefetchDegree", unsigned, 1)),
+    m_prefetchDistance(GetConfOpt("PrefetchDistance", unsigned, 1)),
+    m_strides(),
+    InitStorage(m_prefetches, clock, GetConfOpt("PrefetchBufferSize", BufferSize, 2)),
+    m_prefetchOffset(0),
+    m_wcentries(GetConfOpt("WriteCombiningEntries", size_t, 0)),
+    m_wcTimeout(GetConfOpt("WriteCombiningTimeout", CycleNo, 32)),
+    InitStorage(m_wcactive, clock, false),
     InitSampleVariable(numRHits, SVC_CUMULATIVE),
     InitSampleVariable(numDelayedReads, SVC_CUMULATIVE),
     InitSampleVariable(numEmptyRMisses, SVC_CUMULATIVE),
@@ -47,11 +58,24 @@ DCache::DCache(const std::string& name, DRISC& parent, Clock& clock)
     InitSampleVariable(numStallingRMisses, SVC_CUMULATIVE),
     InitSampleVariable(numStallingWMisses, SVC_CUMULATIVE),
     InitSampleVariable(numSnoops, SVC_CUMULATIVE),
+    InitSampleVariable(numWCMerges, SVC_CUMULATIVE),
+    InitSampleVariable(numWCFullFlushes, SVC_CUMULATIVE),
+    InitSampleVariable(numWCEvictions, SVC_CUMULATIVE),
+    InitSampleVariable(numWCTimeoutFlushes, SVC_CUMULATIVE),
+    InitSampleVariable(numWCBarrierFlushes, SVC_CUMULATIVE),
+    InitSampleVariable(numPrefetchesQueued, SVC_CUMULATIVE),
+    InitSampleVariable(numPrefetchesIssued, SVC_CUMULATIVE),
+    InitSampleVariable(numPrefetchesDropped, SVC_CUMULATIVE),
+    InitSampleVariable(numPrefetchesUseful, SVC_CUMULATIVE),
+    InitSampleVariable(numPrefetchesLate, SVC_CUMULATIVE),
+    InitSampleVariable(numPrefetchesUseless, SVC_CUMULATIVE),
 
     InitProcess(p_ReadWritebacks, DoReadWritebacks),
     InitProcess(p_ReadResponses, DoReadResponses),
     InitProcess(p_WriteResponses, DoWriteResponses),
     InitProcess(p_Outgoing, DoOutgoingRequests),
+    InitProcess(p_Prefetches, DoPrefetches),
+    InitProcess(p_WriteCombining, DoWriteCombining),
 
     p_service       (clock, GetName() + ".p_service")
 {
@@ -60,6 +84,8 @@ DCache::DCache(const std::string& name, DRISC& parent, Clock& clock)
     m_read_responses.Sensitive(p_ReadResponses);
     m_write_responses.Sensitive(p_WriteResponses);
     m_outgoing.Sensitive(p_Outgoing);
+    m_prefetches.Sensitive(p_Prefetches);
+    m_wcactive.Sensitive(p_WriteCombining);
 
     // These things must be powers of two
     if (m_assoc == 0 || !IsPowerOfTwo(m_assoc))
@@ -83,20 +109,77 @@ DCache::DCache(const std::string& name, DRISC& parent, Clock& clock)
         throw exceptf<InvalidArgumentException>(*this, "CacheLineSize = %zd is less than 8.", (size_t)m_lineSize);
     }
 
+    // The stride prefetcher
+    string mode = GetConfOpt("Prefetcher", string, "none");
+    if (mode == "stride" || mode == "STRIDE")
+    {
+        m_prefetch = true;
+    }
+    else if (mode != "none" && mode != "NONE")
+    {
+        throw exceptf<InvalidArgumentException>(*this, "Unknown prefetcher: %s", mode.c_str());
+    }
+
+    string index = GetConfOpt("PrefetchIndex", string, "pc");
+    if (index == "pc" || index == "PC")
+    {
+        m_prefetchIndex = PREFETCH_INDEX_PC;
+    }
+    else if (index == "family" || index == "FAMILY")
+    {
+        m_prefetchIndex = PREFETCH_INDEX_FAMILY;
+    }
+    else
+    {
+        throw exceptf<InvalidArgumentException>(*this, "Unknown prefetch index: %s", index.c_str());
+    }
+
+    size_t tableSize = GetConfOpt("PrefetchTableSize", size_t, 16);
+    if (m_prefetch && (tableSize == 0 || !IsPowerOfTwo(tableSize)))
+    {
+        throw exceptf<InvalidArgumentException>(*this, "PrefetchTableSize = %zd is not a power of two", tableSize);
+    }
+
+    if (m_prefetch && m_prefetchDegree == 0)
+    {
+        throw exceptf<InvalidArgumentException>(*this, "PrefetchDegree cannot be zero");
+    }
+
+    if (m_prefetch)
+    {
+        m_strides.resize(tableSize);
+        for (size_t i = 0; i < m_strides.size(); ++i)
+        {
+            RegisterStateObject(m_strides[i], "stride" + to_string(i));
+        }
+    }
+    RegisterStateVariable(m_prefetchOffset, "prefetchOffset");
+
+    for (size_t i = 0; i < m_wcentries.size(); ++i)
+    {
+        auto& e = m_wcentries[i];
+        e.address  = 0;
+        e.wid      = 0;
+        e.deadline = 0;
+        e.used     = false;
+        RegisterStateObject(e, "wc" + to_string(i));
+    }
+
     m_lines.resize(m_sets * m_assoc);
-    m_data.resize(m_lines.size() * m_lineSize);
-    m_valid = new bool[m_lines.size() * m_lineSize];
+    m_data  = GetKernel()->GetArena().Allocate<char>(m_lines.size() * m_lineSize);
+    m_tags.Initialize(*this, m_sets, m_assoc);
+    m_replacement = IReplacementPolicy::makePolicy(*this, GetConfOpt("Replacement", string, "LRU"), m_sets, m_assoc);
 
-    RegisterStateArray(m_valid, m_lines.size() * m_lineSize, "valid");
-    RegisterStateVariable(m_data, "data");
+    RegisterStateArray(m_data, m_lines.size() * m_lineSize, "data");
 
     for (size_t i = 0; i < m_lines.size(); ++i)
     {
         auto &line = m_lines[i];
         line.state  = LINE_EMPTY;
         line.data   = &m_data[i * m_lineSize];
-        line.valid  = &m_valid[i * m_lineSize];
+        line.valid  = 0;
         line.create = false;
+        line.prefetched = false;
         RegisterStateObject(line, "line" + to_string(i));
     }
 
@@ -119,7 +202,7 @@ void DCache::ConnectMemory(IMemory* memory)
 
 DCache::~DCache()
 {
-    delete[] m_valid;
+    delete m_replacement;
     delete m_selector;
 }
 
@@ -131,34 +214,32 @@ Result DCache::FindLine(MemAddr address, Line* &line, bool check_only)
     const size_t  set  = setindex * m_assoc;
 
     // Find the line
-    Line* empty   = NULL;
-    Line* replace = NULL;
-    for (size_t i = 0; i < m_assoc; ++i)
+    int way = m_tags.Find(setindex, tag);
+    if (way >= 0)
     {
-        line = &m_lines[set + i];
+        // The wanted line was in the cache
+        line = &m_lines[set + way];
+        return SUCCESS;
+    }
 
-        // Invalid lines may not be touched or considered
-        if (line->state == LINE_EMPTY)
-        {
-            // Empty, unused line, remember this one
-            empty = line;
-        }
-        else if (line->tag == tag)
-        {
-            // The wanted line was in the cache
-            return SUCCESS;
-        }
-        else if (line->state == LINE_FULL && (replace == NULL || line->access < replace->access))
+    // The line could not be found, allocate the empty line or replace an existing line
+    way = m_tags.FindEmpty(setindex);
+    const bool evict = (way < 0);
+    if (evict)
+    {
+        // Only full lines can be replaced; let the policy choose
+        TagArray::WayMask full = 0;
+        for (size_t i = 0; i < m_assoc; ++i)
         {
-            // The line is available to be replaced and has a lower LRU rating,
-            // remember it for replacing
-            replace = line;
+            if (m_lines[set + i].state == LINE_FULL)
+            {
+                full |= (TagArray::WayMask)1 << i;
+            }
         }
+        way = m_replacement->FindVictim(setindex, full);
     }
 
-    // The line could not be found, allocate the empty line or replace an existing line
-    line = (empty != NULL) ? empty : replace;
-    if (line == NULL)
+    if (way < 0)
     {
         // No available line
         if (!check_only)
@@ -167,16 +248,28 @@ Result DCache::FindLine(MemAddr address, Line* &line, bool check_only)
         }
         return FAILED;
     }
+    line = &m_lines[set + way];
 
     if (!check_only)
     {
         // Reset the line
         COMMIT
         {
+            if (line->prefetched)
+            {
+                // A prefetched line is replaced before it was used
+                ++m_numPrefetchesUseless;
+                line->prefetched = false;
+            }
             line->processing = false;
-            line->tag        = tag;
             line->waiting    = INVALID_REG;
-            std::fill(line->valid, line->valid + m_lineSize, false);
+            line->valid      = 0;
+            m_tags.SetTag(set + way, tag);
+            if (evict)
+            {
+                m_replacement->Evict(set + way);
+            }
+            m_replacement->Fill(set + way);
         }
     }
 
@@ -185,7 +278,7 @@ Result DCache::FindLine(MemAddr address, Line* &line, bool check_only)
 
 
 
-Result DCache::Read(MemAddr address, void* data, MemSize size, RegAddr* reg)
+Result DCache::Read(MemAddr address, void* data, MemSize size, RegAddr* reg, MemAddr pc, LFID fid)
 {
     size_t offset = (size_t)(address % m_lineSize);
     if (offset + size > m_lineSize)
@@ -231,8 +324,25 @@ Result DCache::Read(MemAddr address, void* data, MemSize size, RegAddr* reg)
         return FAILED;
     }
 
-    // Update last line access
-    COMMIT{ line->access = cpu.GetCycleNo(); }
+    // Update the replacement information on hits
+    if (result == SUCCESS)
+    {
+        COMMIT{ m_replacement->Access(line - &m_lines[0]); }
+    }
+
+    if (result == SUCCESS && line->prefetched && line->state != LINE_INVALID)
+    {
+        // First use of a prefetched line
+        COMMIT
+        {
+            ++m_numPrefetchesUseful;
+            if (line->state == LINE_LOADING)
+            {
+                ++m_numPrefetchesLate;
+            }
+            line->prefetched = false;
+        }
+    }
 
     if (result == DELAYED)
     {
@@ -260,16 +370,8 @@ Result DCache::Read(MemAddr address, void* data, MemSize size, RegAddr* reg)
         // Check if the data that we want is valid in the line.
         // This happens when the line is FULL, or LOADING and has been
         // snooped to (written to from another core) in the mean time.
-        size_t i;
-        for (i = 0; i < size; ++i)
-        {
-            if (!line->valid[offset + i])
-            {
-                break;
-            }
-        }
-
-        if (i == size)
+        const line::Mask range = line::range(offset, size);
+        if ((line->valid & range) == range)
         {
             // Data is entirely in the cache, copy it
             COMMIT
@@ -277,6 +379,7 @@ Result DCache::Read(MemAddr address, void* data, MemSize size, RegAddr* reg)
                 memcpy(data, line->data + offset, (size_t)size);
                 ++m_numRHits;
             }
+            TrainPrefetcher(address, pc, fid);
             return SUCCESS;
         }
 
@@ -297,6 +400,7 @@ Result DCache::Read(MemAddr address, void* data, MemSize size, RegAddr* reg)
     COMMIT
     {
         line->state = LINE_LOADING;
+        m_tags.SetUsed(line - &m_lines[0], true);
         if (reg != NULL && reg->valid())
         {
             // We're loading to a valid register, queue it
@@ -312,9 +416,84 @@ Result DCache::Read(MemAddr address, void* data, MemSize size, RegAddr* reg)
         // Statistics:
         ++m_numDelayedReads;
     }
+    TrainPrefetcher(address, pc, fid);
     return DELAYED;
 }
 
+void DCache::TrainPrefetcher(MemAddr address, MemAddr pc, LFID fid)
+{
+    if (!m_prefetch || fid == INVALID_LFID)
+    {
+        return;
+    }
+
+    // Find the stream of this read in the stride table
+    const MemAddr key = (m_prefetchIndex == PREFETCH_INDEX_PC) ? pc : fid;
+    StrideEntry& entry = m_strides[(key ^ (key >> 8)) & (m_strides.size() - 1)];
+
+    if (!entry.valid || entry.key != key)
+    {
+        // New stream, replaces whatever was tracked here
+        COMMIT
+        {
+            entry.valid      = true;
+            entry.key        = key;
+            entry.last       = address;
+            entry.stride     = 0;
+            entry.issued     = 0;
+            entry.confidence = 0;
+        }
+        return;
+    }
+
+    // Two-bit saturating confidence in the stride; the stride is only
+    // replaced once the confidence has dropped to zero.
+    const int64_t stride = (int64_t)(address - entry.last);
+    StrideEntry next = entry;
+    next.last = address;
+    if (stride == entry.stride && stride != 0)
+    {
+        next.confidence = std::min(next.confidence + 1, 3u);
+    }
+    else if (next.confidence > 0)
+    {
+        next.confidence--;
+    }
+    else
+    {
+        next.stride = stride;
+    }
+
+    if (next.confidence >= 2)
+    {
+        // Prefetch the lines from Distance strides ahead, one line
+        // at least apart.
+        const MemAddr base = (address + next.stride * m_prefetchDistance) & ~(MemAddr)(m_lineSize - 1);
+        if (base != (address & ~(MemAddr)(m_lineSize - 1)) && base != entry.issued)
+        {
+            PrefetchRequest req;
+            req.address = base;
+            req.step    = (next.stride < 0)
+                ? -std::max<int64_t>(-next.stride & ~(int64_t)(m_lineSize - 1), m_lineSize)
+                :  std::max<int64_t>( next.stride & ~(int64_t)(m_lineSize - 1), m_lineSize);
+            req.count   = m_prefetchDegree;
+
+            if (m_prefetches.Push(std::move(req)))
+            {
+                next.issued = base;
+                COMMIT{ ++m_numPrefetchesQueued; }
+            }
+            else
+            {
+                // The prefetcher is best-effort, it never stalls reads
+                COMMIT{ ++m_numPrefetchesDropped; }
+            }
+        }
+    }
+
+    COMMIT{ entry = next; }
+}
+
 Result DCache::Write(MemAddr address, void* data, MemSize size, LFID fid, TID tid)
 {
     assert(fid != INVALID_LFID);
@@ -379,7 +558,7 @@ Result DCache::Write(MemAddr address, void* data, MemSize size, LFID fid, TID ti
             assert(line->state == LINE_FULL);
             COMMIT{
                 std::copy((char*)data, (char*)data + size, line->data + offset);
-                std::fill(line->valid + offset, line->valid + offset + size, true);
+                line->valid |= line::range(offset, size);
 
                 // Statistics
                 ++m_numWHits;
@@ -404,6 +583,11 @@ Result DCache::Write(MemAddr address, void* data, MemSize size, LFID fid, TID ti
     std::fill(request.data.mask+offset+size, request.data.mask+m_lineSize, false);
     }
 
+    if (!m_wcentries.empty())
+    {
+        return CombineWrite(request);
+    }
+
     if (!m_outgoing.Push(std::move(request)))
     {
         ++m_numStallingWMisses;
@@ -416,6 +600,85 @@ Result DCache::Write(MemAddr address, void* data, MemSize size, LFID fid, TID ti
     return DELAYED;
 }
 
+Result DCache::CombineWrite(Request& request)
+{
+    // Find the entry of this thread for this line, otherwise a free
+    // entry, otherwise the entry to flush first
+    WriteCombiningEntry* entry  = NULL;
+    WriteCombiningEntry* victim = NULL;
+    for (auto& e : m_wcentries)
+    {
+        if (e.used && e.address == request.address && e.wid == request.wid)
+        {
+            entry = &e;
+            break;
+        }
+
+        if (victim == NULL || (victim->used && (!e.used || e.deadline < victim->deadline)))
+        {
+            victim = &e;
+        }
+    }
+
+    if (entry != NULL)
+    {
+        // Merge the store into the pending write
+        COMMIT
+        {
+            line::blit(entry->data.data, request.data.data, request.data.mask, m_lineSize);
+            line::setif(entry->data.mask, true, request.data.mask, m_lineSize);
+            if (std::find(entry->data.mask, entry->data.mask + m_lineSize, false) == entry->data.mask + m_lineSize)
+            {
+                // The line is complete, flush it right away
+                entry->deadline = 0;
+            }
+            else if (entry->deadline != 0)
+            {
+                // Keep the entry open while the thread writes to it
+                entry->deadline = GetDRISC().GetCycleNo() + m_wcTimeout;
+            }
+
+            ++m_numWCMerges;
+            ++m_numWAccesses;
+        }
+        return SUCCESS;
+    }
+
+    if (victim->used)
+    {
+        // Make room by sending the oldest entry to memory
+        Request flush;
+        flush.write   = true;
+        flush.address = victim->address;
+        flush.wid     = victim->wid;
+        flush.data    = victim->data;
+        if (!m_outgoing.Push(std::move(flush)))
+        {
+            ++m_numStallingWMisses;
+            DeadlockWrite("Unable to push write-combining eviction to outgoing buffer");
+            return FAILED;
+        }
+        COMMIT{ ++m_numWCEvictions; }
+    }
+    else if (!m_wcactive.Set())
+    {
+        DeadlockWrite("Unable to activate the write-combining buffer");
+        return FAILED;
+    }
+
+    COMMIT
+    {
+        victim->used     = true;
+        victim->address  = request.address;
+        victim->wid      = request.wid;
+        victim->data     = request.data;
+        victim->deadline = GetDRISC().GetCycleNo() + m_wcTimeout;
+
+        ++m_numWAccesses;
+    }
+    return DELAYED;
+}
+
 bool DCache::OnMemoryReadCompleted(MemAddr addr, const char* data)
 {
     // Check if we have the line and if its loading.
@@ -449,10 +712,20 @@ bool DCache::OnMemoryReadCompleted(MemAddr addr, const char* data)
                 }
             }
 
+            // The write-combining buffer holds later writes than the
+            // outgoing buffer
+            for (auto& e : m_wcentries)
+            {
+                if (e.used && e.address == addr)
+                {
+                    line::blit(&mdata[0], e.data.data, e.data.mask, m_lineSize);
+                }
+            }
+
             // Copy the data into the cache line.
             // Mask by valid bytes (don't overwrite already written data).
             line::blitnot(line->data, mdata, line->valid, m_lineSize);
-            line::setifnot(line->valid, true, line->valid, m_lineSize);
+            line->valid = line::range(0, m_lineSize);
 
             line->processing = true;
         }
@@ -520,7 +793,7 @@ bool DCache::OnMemorySnooped(MemAddr address, const char* data, const bool* mask
             // because we don't have to guarantee sequential semantics from other cores.
             // This falls within the non-determinism behavior of the architecture.
             line::blit(line->data, data, mask, m_lineSize);
-            line::setif(line->valid, true, mask, m_lineSize);
+            line->valid |= line::pack(mask, m_lineSize);
 
             // Statistics
             ++m_numSnoops;
@@ -539,9 +812,15 @@ bool DCache::OnMemoryInvalidated(MemAddr address)
             DebugMemWrite("Received invalidation request for loaded line %#016llx", (unsigned long long)address);
 
             // We have the line, invalidate it
+            if (line->prefetched) {
+                ++m_numPrefetchesUseless;
+                line->prefetched = false;
+            }
+
             if (line->state == LINE_FULL) {
                 // Full lines are invalidated by clearing them. Simple.
                 line->state = LINE_EMPTY;
+                m_tags.SetUsed(line - &m_lines[0], false);
             } else if (line->state == LINE_LOADING) {
                 // The data is being loaded. Invalidate the line and it will get cleaned up
                 // when the data is read.
@@ -602,6 +881,7 @@ Result DCache::DoReadResponses()
     COMMIT {
         line.waiting = INVALID_REG;
         line.state = (line.state == LINE_INVALID) ? LINE_EMPTY : LINE_FULL;
+        m_tags.SetUsed(response.cid, line.state != LINE_EMPTY);
     }
     m_read_responses.Pop();
     return SUCCESS;
@@ -796,6 +1076,156 @@ Result DCache::DoOutgoingRequests()
     return SUCCESS;
 }
 
+Result DCache::DoWriteCombining()
+{
+    // Flush one entry per cycle: entries with a complete line or past
+    // their timeout, and entries of threads that wait for their writes
+    // (memory barrier or termination).
+    auto& threads = GetDRISC().GetThreadTable();
+    const CycleNo now = GetDRISC().GetCycleNo();
+
+    WriteCombiningEntry* entry = NULL;
+    size_t  used = 0;
+    CycleNo next = INFINITE_CYCLES;
+    bool    barrier = false;
+    for (auto& e : m_wcentries)
+    {
+        if (!e.used)
+        {
+            continue;
+        }
+        ++used;
+
+        if (entry == NULL)
+        {
+            auto& thread = threads[e.wid];
+            if (e.deadline <= now)
+            {
+                entry = &e;
+            }
+            else if (thread.waitingForWrites || thread.dependencies.killed)
+            {
+                entry   = &e;
+                barrier = true;
+            }
+            else
+            {
+                next = std::min(next, e.deadline);
+            }
+        }
+    }
+
+    if (entry == NULL)
+    {
+        // Nothing to do until the first timeout
+        assert(used > 0);
+        GetKernel()->WaitUntil(next);
+        return SUCCESS;
+    }
+
+    if (!p_service.Invoke())
+    {
+        DeadlockWrite("Unable to acquire port for D-Cache write-combining flush");
+        return FAILED;
+    }
+
+    Request request;
+    request.write   = true;
+    request.address = entry->address;
+    request.wid     = entry->wid;
+    request.data    = entry->data;
+    if (!m_outgoing.Push(std::move(request)))
+    {
+        DeadlockWrite("Unable to push write-combining flush to outgoing buffer");
+        return FAILED;
+    }
+
+    if (used == 1 && !m_wcactive.Clear())
+    {
+        DeadlockWrite("Unable to deactivate the write-combining buffer");
+        return FAILED;
+    }
+
+    COMMIT
+    {
+        if (barrier) {
+            ++m_numWCBarrierFlushes;
+        } else if (entry->deadline == 0) {
+            ++m_numWCFullFlushes;
+        } else {
+            ++m_numWCTimeoutFlushes;
+        }
+        entry->used = false;
+    }
+    return SUCCESS;
+}
+
+Result DCache::DoPrefetches()
+{
+    assert(!m_prefetches.Empty());
+    const PrefetchRequest& req = m_prefetches.Front();
+
+    // Prefetches only use the bus when there are no demand requests
+    if (!m_outgoing.Empty())
+    {
+        DeadlockWrite("Outgoing buffer busy, delaying prefetch");
+        return FAILED;
+    }
+
+    if (!p_service.Invoke())
+    {
+        DeadlockWrite("Unable to acquire port for D-Cache prefetch");
+        return FAILED;
+    }
+
+    const MemAddr address = req.address + req.step * m_prefetchOffset;
+
+    Line*  line;
+    Result result = SUCCESS;
+    if (!GetDRISC().CheckPermissions(address, m_lineSize, IMemory::PERM_READ) ||
+        (result = FindLine(address, line, true)) == FAILED)
+    {
+        // Not readable or no line to replace, don't bother
+        COMMIT{ ++m_numPrefetchesDropped; }
+    }
+    else if (result == DELAYED)
+    {
+        FindLine(address, line, false);
+
+        Request request;
+        request.write   = false;
+        request.address = address;
+        if (!m_outgoing.Push(std::move(request)))
+        {
+            DeadlockWrite("Unable to push prefetch request to outgoing buffer");
+            return FAILED;
+        }
+
+        DebugMemWrite("Prefetching %#016llx", (unsigned long long)address);
+
+        COMMIT
+        {
+            line->state      = LINE_LOADING;
+            line->create     = false;
+            line->prefetched = true;
+            m_tags.SetUsed(line - &m_lines[0], true);
+            ++m_numPrefetchesIssued;
+        }
+    }
+
+    // Move on to the next line of the request
+    if (m_prefetchOffset + 1 == req.count)
+    {
+        m_prefetches.Pop();
+        COMMIT{ m_prefetchOffset = 0; }
+    }
+    else
+    {
+        COMMIT{ m_prefetchOffset++; }
+    }
+    return SUCCESS;
+}
+
 void DCache::Cmd_Info(std::ostream& out, const std::vector<std::string>& /*arguments*/) const
 {
     out <<
@@ -808,7 +1238,8 @@ void DCache::Cmd_Info(std::ostream& out, const std::vector<std::string>& /*argum
     "- inspect <component> buffers\n"
     "  Reads and display the outgoing request buffer.\n"
     "- inspect <component> lines\n"
-    "  Reads and displays the cache-lines.\n";
+    "  Reads and displays the cache-lines.\n"
+    "  Prefetched lines that have not been used yet are marked with P.\n";
 }
 
 void DCache::Cmd_Read(std::ostream& out, const std::vector<std::string>& arguments) const
@@ -827,6 +1258,7 @@ void DCache::Cmd_Read(std::ostream& out, const std::vector<std::string>& argumen
         }
 
         out << "L1 bank mapping:     " << m_selector->GetName() << endl
+            << "Replacement policy:  " << m_replacement->GetName() << endl
             << "Cache size:          " << dec << (m_lineSize * m_lines.size()) << " bytes" << endl
             << "Cache line size:     " << dec << m_lineSize << " bytes" << endl
             << endl;
@@ -834,7 +1266,7 @@ void DCache::Cmd_Read(std::ostream& out, const std::vector<std::string>& argumen
         uint64_t numRAccesses = m_numRHits + m_numDelayedReads;
 
         uint64_t numRRqst = m_numEmptyRMisses + m_numResolvedConflicts;
-        uint64_t numWRqst = m_numWAccesses;
+        uint64_t numWRqst = m_numWAccesses - m_numWCMerges;
         uint64_t numRqst = numRRqst + numWRqst;
 
         uint64_t numRStalls = m_numHardConflicts + m_numInvalidRMisses + m_numStallingRMisses;
@@ -885,6 +1317,26 @@ void DCache::Cmd_Read(std::ostream& out, const std::vector<std::string>& argumen
                 << "(percentages relative to " << m_numWAccesses << " write requests)" << endl
                 << endl;
 
+            if (!m_wcentries.empty())
+            {
+                uint64_t numFlushes = m_numWCFullFlushes + m_numWCEvictions + m_numWCTimeoutFlushes + m_numWCBarrierFlushes;
+                float f_factor = 100.0f / numFlushes;
+                out << "***********************************************************" << endl
+                    << "                      Write combining                      " << endl
+                    << "***********************************************************" << endl
+                    << endl
+                    << "Number of entries:                    " << m_wcentries.size() << endl
+                    << "Writes merged into a pending write:   " << PRINTVAL(m_numWCMerges, w_factor) << endl
+                    << "(percentage relative to " << m_numWAccesses << " write requests)" << endl
+                    << "Flushed writes:                       " << numFlushes << endl
+                    << "- complete line:                      " << PRINTVAL(m_numWCFullFlushes, f_factor) << endl
+                    << "- evicted for another line:           " << PRINTVAL(m_numWCEvictions, f_factor) << endl
+                    << "- timeout:                            " << PRINTVAL(m_numWCTimeoutFlushes, f_factor) << endl
+                    << "- thread waiting for its writes:      " << PRINTVAL(m_numWCBarrierFlushes, f_factor) << endl
+                    << "(percentages relative to " << numFlushes << " flushed writes)" << endl
+                    << endl;
+            }
+
             float q_factor = 100.0f / numRqst;
             out << "***********************************************************" << endl
                 << "                      Requests to upstream                 " << endl
@@ -897,6 +1349,37 @@ void DCache::Cmd_Read(std::ostream& out, const std::vector<std::string>& argumen
                 << endl;
 
 
+            if (m_prefetch)
+            {
+                uint64_t numUseful = m_numPrefetchesUseful;
+                out << "***********************************************************" << endl
+                    << "                      Prefetches                           " << endl
+                    << "***********************************************************" << endl
+                    << endl
+                    << "Prefetch runs queued:                 " << m_numPrefetchesQueued << endl
+                    << "Prefetch requests to upstream:        " << m_numPrefetchesIssued << endl
+                    << "Prefetches dropped:                   " << m_numPrefetchesDropped << endl;
+                if (m_numPrefetchesIssued == 0)
+                    out << "No prefetches so far, cannot provide statistical data." << endl;
+                else
+                {
+                    float p_factor = 100.0f / m_numPrefetchesIssued;
+                    out << "Useful prefetches (accuracy):         " << PRINTVAL(numUseful, p_factor) << endl
+                        << "Useless prefetches:                   " << PRINTVAL(m_numPrefetchesUseless, p_factor) << endl
+                        << "(percentages relative to " << m_numPrefetchesIssued << " prefetch requests)" << endl;
+                }
+                if (numUseful != 0)
+                {
+                    float u_factor = 100.0f / numUseful;
+                    out << "Coverage of read misses:              " << PRINTVAL(numUseful, 100.0f / (numUseful + numRRqst)) << endl
+                        << "(percentage relative to " << (numUseful + numRRqst) << " read misses without prefetching)" << endl
+                        << "Timely prefetches:                    " << PRINTVAL(numUseful - m_numPrefetchesLate, u_factor) << endl
+                        << "Late prefetches:                      " << PRINTVAL(m_numPrefetchesLate, u_factor) << endl
+                        << "(percentages relative to " << numUseful << " useful prefetches)" << endl;
+                }
+                out << endl;
+            }
+
             if (numStalls != 0)
             {
                 float s_factor = 100.f / numStalls;
@@ -977,7 +1460,36 @@ void DCache::Cmd_Read(std::ostream& out, const std::vector<std::string>& argumen
             << " offset " << m_wbstate.offset
             << " fid " << m_wbstate.fid
             << endl
-            << endl << "Outgoing requests:" << endl
+            << endl;
+
+        if (!m_wcentries.empty())
+        {
+            out << "Write-combining buffer:" << endl
+                << "      Address      |  TID  | Deadline | Value" << endl
+                << "-------------------+-------+----------+-------------------------" << endl;
+            for (auto& e : m_wcentries)
+            {
+                if (!e.used)
+                {
+                    continue;
+                }
+                out << hex << "0x" << setw(16) << setfill('0') << e.address << " | "
+                    << dec << setw(5) << setfill(' ') << e.wid << " | "
+                    << setw(8) << e.deadline << " |";
+                out << hex << setfill('0');
+                for (size_t x = 0; x < m_lineSize; ++x)
+                {
+                    if (e.data.mask[x])
+                        out << " " << setw(2) << (unsigned)(unsigned char)e.data.data[x];
+                    else
+                        out << " --";
+                }
+                out << dec << endl;
+            }
+            out << endl;
+        }
+
+        out << "Outgoing requests:" << endl
             << "      Address      | Type  | Value (writes)" << endl
             << "-------------------+-------+-------------------------" << endl;
         for (auto &p : m_outgoing)
@@ -1017,13 +1529,13 @@ void DCache::Cmd_Read(std::ostream& out, const std::vector<std::string>& argumen
             out << " |                     |                                                 |";
         } else {
             out << " | "
-                << hex << "0x" << setw(16) << setfill('0') << m_selector->Unmap(line.tag, set) * m_lineSize;
+                << hex << "0x" << setw(16) << setfill('0') << m_selector->Unmap(m_tags.GetTag(i), set) * m_lineSize;
 
             switch (line.state)
             {
                 case LINE_LOADING: out << "L"; break;
                 case LINE_INVALID: out << "I"; break;
-                default: out << " ";
+                default: out << (line.prefetched ? "P" : " ");
             }
             out << " |";
 
@@ -1062,7 +1574,7 @@ void DCache::Cmd_Read(std::ostream& out, const std::vector<std::string>& argumen
             {
                 for (size_t x = y; x < y + BYTES_PER_LINE; ++x) {
                     out << " ";
-                    if (line.valid[x]) {
+                    if (line::test(line.valid, x)) {
                         out << setw(2) << (unsigned)(unsigned char)line.data[x];
                     } else {
                         out << "  ";
@@ -5,7 +5,10 @@
 #include <sim/kernel.h>
 #include <sim/inspect.h>
 #include <sim/buffer.h>
+#include <sim/flag.h>
 #include <arch/Memory.h>
+#include <arch/TagArray.h>
+#include <arch/ReplacementPolicy.h>
 #include <arch/drisc/forward.h>
 
 namespace Simulator
@@ -31,14 +34,13 @@ public:
     // {% call gen_struct() %}
     ((name Line)
      (state
-      (MemAddr     tag)               ///< The address tag.
       (char*       data noserialize)  ///< The data in this line.
-      (bool*       valid noserialize) ///< A bitmap of valid bytes in this line.
-      (CycleNo     access)            ///< Last access time of this line (for LRU).
+      (line::Mask  valid)             ///< A bitmap of valid bytes in this line.
       (RegAddr     waiting)           ///< First register waiting on this line.
       (LineState   state)             ///< The line state.
       (bool        processing)        ///< Has the line been added to m_returned yet?
-      (bool        create)))          ///< Is the line expected by the create process (bundle)?
+      (bool        create)            ///< Is the line expected by the create process (bundle)?
+      (bool        prefetched)))      ///< Was the line loaded by the prefetcher and not yet used?
     // {% endcall %}
 
 private:
@@ -68,6 +70,45 @@ private:
      (state (WClientID wid)))
     // {% endcall %}
 
+    // An entry in the write-combining buffer
+    // {% call gen_struct() %}
+    ((name WriteCombiningEntry)
+     (state
+      (MemData     data)      ///< The combined stores, with their byte mask.
+      (MemAddr     address)   ///< Address of the line.
+      (WClientID   wid)       ///< The thread that made the stores.
+      (CycleNo     deadline)  ///< Cycle at which the entry is flushed if no more stores come.
+      (bool        used)))    ///< Is the entry in use?
+    // {% endcall %}
+
+    /// The prefetcher's training key.
+    enum PrefetchIndex
+    {
+        PREFETCH_INDEX_PC,      ///< Streams are tracked per load instruction.
+        PREFETCH_INDEX_FAMILY,  ///< Streams are tracked per family.
+    };
+
+    // An entry in the prefetcher's stride table
+    // {% call gen_struct() %}
+    ((name StrideEntry)
+     (state
+      (MemAddr     key        (init 0))     ///< PC or FID that trained this entry.
+      (MemAddr     last       (init 0))     ///< Last address accessed by the stream.
+      (int64_t     stride     (init 0))     ///< Last observed stride.
+      (MemAddr     issued     (init 0))     ///< Last line address queued for prefetching.
+      (unsigned    confidence (init 0))     ///< Saturating confidence in the stride.
+      (bool        valid      (init false))))
+    // {% endcall %}
+
+    // A run of lines to prefetch
+    // {% call gen_struct() %}
+    ((name PrefetchRequest)
+     (state
+      (MemAddr     address)  ///< First line address to prefetch.
+      (int64_t     step)     ///< Distance between successive lines.
+      (unsigned    count)))  ///< Number of lines to prefetch.
+    // {% endcall %}
+
     // Information for multi-register writes
     // {% call gen_struct() %}
     ((name WritebackState)
@@ -82,22 +123,39 @@ private:
     // {% endcall %}
 
     Result FindLine(MemAddr address, Line* &line, bool check_only);
+    void   TrainPrefetcher(MemAddr address, MemAddr pc, LFID fid);
+    Result CombineWrite(Request& request);
 
     IMemory*             m_memory;          ///< Memory
     MCID                 m_mcid;            ///< Memory Client ID
     std::vector<Line>    m_lines;           ///< The cache-lines.
-    std::vector<char>    m_data;            ///< The data in the cache lines.
-    bool*                m_valid;           ///< The valid bits.
+    char*                m_data;            ///< The data in the cache lines, in the arena.
+    TagArray             m_tags;            ///< The tags of the cache lines.
     size_t               m_assoc;           ///< Config: Cache associativity.
     size_t               m_sets;            ///< Config: Number of sets in the cace.
     size_t               m_lineSize;        ///< Config: Size of a cache line, in bytes.
     IBankSelector*       m_selector;        ///< Mapping of cache line addresses to tags and set indices.
+    IReplacementPolicy*  m_replacement;     ///< Choice of the lines to replace.
     Buffer<ReadResponse>  m_read_responses; ///< Incoming buffer for read responses from memory bus.
     Buffer<WriteResponse> m_write_responses;///< Incoming buffer for write acknowledgements from memory bus.
     Buffer<WritebackRequest> m_writebacks; ///< Incoming buffer for register writebacks after load.
     Buffer<Request>      m_outgoing;        ///< Outgoing buffer to memory bus.
     WritebackState       m_wbstate;         ///< Writeback state
 
+    // Stride prefetcher
+    bool                 m_prefetch;        ///< Config: Is the prefetcher enabled?
+    PrefetchIndex        m_prefetchIndex;   ///< Config: Key to track the streams by.
+    unsigned             m_prefetchDegree;  ///< Config: Number of lines to prefetch per trigger.
+    unsigned             m_prefetchDistance;///< Config: Number of strides ahead to start prefetching.
+    std::vector<StrideEntry> m_strides;     ///< The stride table.
+    Buffer<PrefetchRequest> m_prefetches;   ///< Queue of lines to prefetch when the bus is idle.
+    unsigned             m_prefetchOffset;  ///< Number of lines issued for the front request.
+
+    // Write-combining buffer
+    std::vector<WriteCombiningEntry> m_wcentries; ///< The entries; empty if disabled.
+    CycleNo              m_wcTimeout;       ///< Config: Cycles after which an entry is flushed.
+    Flag                 m_wcactive;        ///< Set while entries are in use.
+
 
     // Statistics
 
@@ -119,11 +177,26 @@ private:
 
     DefineSampleVariable(uint64_t, numSnoops);
 
+    DefineSampleVariable(uint64_t, numWCMerges);          ///< Stores merged into a write-combining entry
+    DefineSampleVariable(uint64_t, numWCFullFlushes);     ///< Entries flushed because the line was complete
+    DefineSampleVariable(uint64_t, numWCEvictions);       ///< Entries flushed to make room for another line
+    DefineSampleVariable(uint64_t, numWCTimeoutFlushes);  ///< Entries flushed after the timeout
+    DefineSampleVariable(uint64_t, numWCBarrierFlushes);  ///< Entries flushed because the thread waits for its writes
+
+    DefineSampleVariable(uint64_t, numPrefetchesQueued);  ///< Prefetch runs queued by the stride table
+    DefineSampleVariable(uint64_t, numPrefetchesIssued);  ///< Prefetch reads sent to memory
+    DefineSampleVariable(uint64_t, numPrefetchesDropped); ///< Prefetches not issued: queue full, no free line or not readable
+    DefineSampleVariable(uint64_t, numPrefetchesUseful);  ///< Prefetched lines later used by a read
+    DefineSampleVariable(uint64_t, numPrefetchesLate);    ///< Useful prefetches still loading at the time of the read
+    DefineSampleVariable(uint64_t, numPrefetchesUseless); ///< Prefetched lines evicted or invalidated before use
+
 
     Result DoReadWritebacks();
     Result DoReadResponses();
     Result DoWriteResponses();
     Result DoOutgoingRequests();
+    Result DoPrefetches();
+    Result DoWriteCombining();
 
     Object& GetDRISCParent() const { return *GetParent(); }
 
@@ -139,11 +212,17 @@ public:
     Process p_ReadResponses;
     Process p_WriteResponses;
     Process p_Outgoing;
+    Process p_Prefetches;
+    Process p_WriteCombining;
 
     ArbitratedService<> p_service;
 
     // Public interface
-    Result Read (MemAddr address, void* data, MemSize size, RegAddr* reg);
+    // pc and fid identify the load for the prefetcher; fid is
+    // INVALID_LFID for reads that should not train it.
+    Result Read (MemAddr address, void* data, MemSize size, RegAddr* reg, MemAddr pc, LFID fid);
+    // Returns SUCCESS if the store was merged into a pending write of
+    // the same thread, DELAYED if it started a new write.
     Result Write(MemAddr address, void* data, MemSize size, LFID fid, TID tid);
 
     size_t GetLineSize() const { return m_lineSize; }
@@ -184,12 +184,15 @@ void DRISC::Initialize()
     m_icache.p_service.AddProcess(m_icache.p_Incoming);             // Cache-line returns
     m_icache.p_service.AddProcess(m_allocator.p_ThreadActivation);  // Thread activation
     m_icache.p_service.AddProcess(m_allocator.p_FamilyCreate);      // Create process
+    m_icache.p_service.AddProcess(m_icache.p_Prefetches);           // Prefetches
 
     // Unfortunately the D-Cache needs priority here because otherwise all cache-lines can
     // remain filled and we get deadlock because the pipeline keeps wanting to do a read.
     m_dcache.p_service.AddProcess(m_dcache.p_ReadResponses);     // Memory read returns
     m_dcache.p_service.AddProcess(m_pipeline.p_Pipeline);         // Memory read/write
     m_dcache.p_service.AddProcess(m_allocator.p_BundleCreate);    // Indirect create read
+    m_dcache.p_service.AddProcess(m_dcache.p_WriteCombining);     // Write-combining flushes
+    m_dcache.p_service.AddProcess(m_dcache.p_Prefetches);         // Prefetches
 
     m_allocator.p_allocation.AddProcess(m_pipeline.p_Pipeline);         // ALLOCATE instruction
     m_allocator.p_allocation.AddProcess(m_network.p_DelegationIn);      // Delegated non-exclusive create
@@ -321,13 +324,17 @@ void DRISC::Initialize()
         m_network.m_allocResponse.out ^ m_allocator.m_creates ^ m_network.m_link.out ^ DELEGATE * opt(DELEGATE) );
 
     m_allocator.p_FamilyCreate.SetStorageTraces(
-        /* CREATE_INITIAL */                opt(m_icache.m_outgoing) ^
+        /* CREATE_INITIAL */                opt(m_icache.m_outgoing) * opt(m_icache.m_prefetches) ^
         /* CREATE_BROADCASTING_CREATE */    opt(m_network.m_link.out) ^
         /* CREATE_ACTIVATING_FAMILY */      m_allocator.m_alloc ^
         /* CREATE_NOTIFY */                 opt(DELEGATE) );
 
     m_allocator.p_ThreadActivation.SetStorageTraces(
-        ( m_allocator.m_readyThreadsPipe ^ m_allocator.m_readyThreadsOther ) * opt(m_allocator.m_activeThreads ^ m_icache.m_outgoing) );
+        ( m_allocator.m_readyThreadsPipe ^ m_allocator.m_readyThreadsOther ) *
+        /* I-Cache fetch */ opt(m_icache.m_outgoing) * opt(m_icache.m_prefetches) *
+        /* I-Cache hit */   opt(m_allocator.m_activeThreads) );
+
+    m_icache.p_Prefetches.SetStorageTraces(opt(m_icache.m_outgoing));
 
     m_allocator.p_BundleCreate.SetStorageTraces( m_dcache.m_outgoing ^ DELEGATE );
 
@@ -345,6 +352,10 @@ void DRISC::Initialize()
         /* Thread wakeup */ opt(m_allocator.m_readyThreadsOther) *
         /* Family sync */   opt(m_network.m_link.out ^ m_network.m_syncs) );
 
+    m_dcache.p_Prefetches.SetStorageTraces(opt(m_dcache.m_outgoing));
+
+    m_dcache.p_WriteCombining.SetStorageTraces(opt(m_dcache.m_outgoing * opt(m_dcache.m_wcactive)));
+
     // m_dcache.p_Outgoing is set in the memory
 
     StorageTraceSet pls_writeback =
@@ -354,7 +365,9 @@ void DRISC::Initialize()
             m_allocator.m_cleanup ^
             m_allocator.m_readyThreadsPipe);
     StorageTraceSet pls_memory =
-        m_dcache.m_outgoing;
+        m_dcache.m_outgoing ^
+        /* Write combining */     m_dcache.m_wcactive ^
+        /* Prefetcher training */ (opt(m_dcache.m_outgoing) * m_dcache.m_prefetches);
     StorageTraceSet pls_fetch =
         m_allocator.m_activeThreads;
 
@@ -594,21 +607,15 @@ MemSize DRISC::GetTLSSize() const
     return static_cast<MemSize>(1) << (sizeof(MemSize) * 8 - (1 + m_bits.pid_bits + m_bits.tid_bits));
 }
 
-static Integer GenerateCapability(unsigned int bits)
-{
-    Integer capability = 0;
-    Integer step = (Integer)RAND_MAX + 1;
-    for (Integer limit = (1ULL << bits) + step - 1; limit > 0; limit /= step)
-    {
-        capability = capability * step + rand();
-    }
-    return capability & ((1ULL << bits) - 1);
-}
-
 FCapability DRISC::GenerateFamilyCapability() const
 {
     assert(sizeof(Integer) * 8 > m_bits.pid_bits + m_bits.fid_bits);
-    return GenerateCapability(sizeof(Integer) * 8 - m_bits.pid_bits - m_bits.fid_bits);
+    const unsigned int bits = sizeof(Integer) * 8 - m_bits.pid_bits - m_bits.fid_bits;
+
+    // Use the generator of the kernel, so that the capabilities only
+    // depend on the seed of this simulation.
+    std::uniform_int_distribution<Integer> dist(0, (Integer)((1ULL << bits) - 1));
+    return dist(GetKernel()->GetRandom());
 }
 
 Integer DRISC::PackPlace(const PlaceID& place) const
@@ -21,11 +21,20 @@ ICache::ICache(const std::string& name, DRISC& parent, Clock& clock)
     m_selector(IBankSelector::makeSelector(*this, GetConf("BankSelector", string), GetConf("NumSets", size_t))),
     m_mcid(0),
     m_lines(),
-    m_data(),
+    m_data(NULL),
+    m_tags(),
+    m_replacement(NULL),
     InitBuffer(m_outgoing, clock, "OutgoingBufferSize"),
     InitBuffer(m_incoming, clock, "IncomingBufferSize"),
     m_lineSize(GetTopConf("CacheLineSize", size_t)),
     m_assoc   (GetConf("Associativity", size_t)),
+    m_prefetch(false),
+    m_prefetchEntryPoints(GetConfOpt("PrefetchEntryPoints", bool, false)),
+    m_prefetchLines(GetConfOpt("PrefetchLines", unsigned, 1)),
+    m_plines(),
+    m_pdata(),
+    InitStorage(m_prefetches, clock, GetConfOpt("PrefetchQueueSize", BufferSize, 2)),
+    m_prefetchOffset(0),
 
     InitSampleVariable(numHits, SVC_CUMULATIVE),
     InitSampleVariable(numDelayedReads, SVC_CUMULATIVE),
@@ -35,9 +44,15 @@ ICache::ICache(const std::string& name, DRISC& parent, Clock& clock)
     InitSampleVariable(numHardConflicts, SVC_CUMULATIVE),
     InitSampleVariable(numResolvedConflicts, SVC_CUMULATIVE),
     InitSampleVariable(numStallingMisses, SVC_CUMULATIVE),
+    InitSampleVariable(numPrefetchesIssued, SVC_CUMULATIVE),
+    InitSampleVariable(numPrefetchesDropped, SVC_CUMULATIVE),
+    InitSampleVariable(numPrefetchesUseful, SVC_CUMULATIVE),
+    InitSampleVariable(numPrefetchesLate, SVC_CUMULATIVE),
+    InitSampleVariable(numPrefetchesUseless, SVC_CUMULATIVE),
 
     InitProcess(p_Outgoing, DoOutgoing),
     InitProcess(p_Incoming, DoIncoming),
+    InitProcess(p_Prefetches, DoPrefetches),
     p_service(clock, GetName() + ".p_service")
 {
 
@@ -45,6 +60,7 @@ ICache::ICache(const std::string& name, DRISC& parent, Clock& clock)
 
     m_outgoing.Sensitive( p_Outgoing );
     m_incoming.Sensitive( p_Incoming );
+    m_prefetches.Sensitive( p_Prefetches );
 
     // These things must be powers of two
     if (m_assoc == 0 || !IsPowerOfTwo(m_assoc))
@@ -71,9 +87,11 @@ ICache::ICache(const std::string& name, DRISC& parent, Clock& clock)
 
     // Initialize the cache lines
     m_lines.resize(sets * m_assoc);
-    m_data.resize(m_lineSize * m_lines.size());
+    m_data = GetKernel()->GetArena().Allocate<char>(m_lineSize * m_lines.size());
+    m_tags.Initialize(*this, sets, m_assoc);
+    m_replacement = IReplacementPolicy::makePolicy(*this, GetConfOpt("Replacement", string, "LRU"), sets, m_assoc);
 
-    RegisterStateVariable(m_data, "data");
+    RegisterStateArray(m_data, m_lineSize * m_lines.size(), "data");
 
     for (size_t i = 0; i < m_lines.size(); ++i)
     {
@@ -85,6 +103,47 @@ ICache::ICache(const std::string& name, DRISC& parent, Clock& clock)
         line.creation     = false;
         RegisterStateObject(line, "line" + to_string(i));
     }
+
+    // The prefetcher
+    string mode = GetConfOpt("Prefetcher", string, "none");
+    if (mode == "nextline" || mode == "NEXTLINE")
+    {
+        m_prefetch = true;
+    }
+    else if (mode != "none" && mode != "NONE")
+    {
+        throw exceptf<InvalidArgumentException>(*this, "Unknown prefetcher: %s", mode.c_str());
+    }
+
+    if (m_prefetch)
+    {
+        const size_t size = GetConfOpt("PrefetchBufferSize", size_t, 4);
+        if (size == 0)
+        {
+            throw exceptf<InvalidArgumentException>(*this, "PrefetchBufferSize cannot be zero");
+        }
+
+        if (m_prefetchLines == 0)
+        {
+            throw exceptf<InvalidArgumentException>(*this, "PrefetchLines cannot be zero");
+        }
+
+        m_plines.resize(size);
+        m_pdata.resize(m_lineSize * size);
+        RegisterStateVariable(m_pdata, "pdata");
+
+        for (size_t i = 0; i < m_plines.size(); ++i)
+        {
+            auto& pline = m_plines[i];
+            pline.address = 0;
+            pline.data    = &m_pdata[i * m_lineSize];
+            pline.access  = 0;
+            pline.state   = PREFETCH_EMPTY;
+            pline.cid     = INVALID_CID;
+            RegisterStateObject(pline, "pline" + to_string(i));
+        }
+    }
+    RegisterStateVariable(m_prefetchOffset, "prefetchOffset");
 }
 
 void ICache::ConnectMemory(IMemory* memory)
@@ -100,6 +159,7 @@ void ICache::ConnectMemory(IMemory* memory)
 
 ICache::~ICache()
 {
+    delete m_replacement;
     delete m_selector;
 }
 
@@ -129,51 +189,78 @@ Result ICache::FindLine(MemAddr address, Line* &line, bool check_only)
     const size_t  set  = setindex * m_assoc;
 
     // Find the line
-    Line* empty   = NULL;
-    Line* replace = NULL;
-    for (size_t i = 0; i < m_assoc; ++i)
+    int way = m_tags.Find(setindex, tag);
+    if (way >= 0)
     {
-        line = &m_lines[set + i];
+        // The wanted line was in the cache
+        line = &m_lines[set + way];
+        return SUCCESS;
+    }
 
-        if (line->state == LINE_EMPTY)
-        {
-            // Empty line, remember this one
-            empty = line;
-        }
-        else if (line->tag == tag)
-        {
-            // The wanted line was in the cache
-            return SUCCESS;
-        }
-        else if (line->references == 0 && (replace == NULL || line->access < replace->access))
+    // The line could not be found, allocate the empty line or replace an existing line
+    way = m_tags.FindEmpty(setindex);
+    const bool evict = (way < 0);
+    if (evict)
+    {
+        // Only lines without references can be replaced; let the policy choose
+        TagArray::WayMask unused = 0;
+        for (size_t i = 0; i < m_assoc; ++i)
         {
-            // The line is available to be replaced and has a lower LRU rating,
-            // remember it for replacing
-            replace = line;
+            if (m_lines[set + i].references == 0)
+            {
+                unused |= (TagArray::WayMask)1 << i;
+            }
         }
+        way = m_replacement->FindVictim(setindex, unused);
     }
 
-    // The line could not be found, allocate the empty line or replace an existing line
-    line = (empty != NULL) ? empty : replace;
-    if (line == NULL)
+    if (way < 0)
     {
         // No available line
         DeadlockWrite("Unable to allocate a cache-line for the request to %#016llx (set %u)",
             (unsigned long long)address, (unsigned)(set / m_assoc));
         return FAILED;
     }
+    line = &m_lines[set + way];
 
     if (!check_only)
     {
         COMMIT
         {
             // Reset the line
-            line->tag = tag;
+            m_tags.SetTag(set + way, tag);
+            if (evict)
+            {
+                m_replacement->Evict(set + way);
+            }
+            m_replacement->Fill(set + way);
         }
     }
     return DELAYED;
 }
 
+ICache::PrefetchLine* ICache::FindPrefetchLine(MemAddr address)
+{
+    for (auto& pline : m_plines)
+    {
+        if (pline.state != PREFETCH_EMPTY && pline.address == address)
+        {
+            return &pline;
+        }
+    }
+    return NULL;
+}
+
+void ICache::QueuePrefetch(MemAddr address)
+{
+    // The lines after the trigger are prefetched when the bus is idle.
+    // This is best-effort; it never stalls the fetch.
+    if (!m_prefetches.Push(address))
+    {
+        COMMIT{ ++m_numPrefetchesDropped; }
+    }
+}
+
 bool ICache::ReleaseCacheLine(CID cid)
 {
     if (cid != INVALID_CID)
@@ -186,6 +273,7 @@ bool ICache::ReleaseCacheLine(CID cid)
             if (--line.references == 0 && line.state == LINE_INVALID)
             {
                 line.state = LINE_EMPTY;
+                m_tags.SetUsed(cid, false);
             }
         }
     }
@@ -213,7 +301,7 @@ bool ICache::Read(CID cid, MemAddr address, void* data, MemSize size) const
     }
 #endif
 
-    if (m_lines[cid].state == LINE_EMPTY || m_lines[cid].tag != tag)
+    if (m_lines[cid].state == LINE_EMPTY || m_tags.GetTag(cid) != tag)
     {
         throw exceptf<InvalidArgumentException>(*this, "Read (%#016llx, %zd): Attempting to read from an invalid cache line",
                                                 (unsigned long long)address, (size_t)size);
@@ -285,8 +373,11 @@ Result ICache::Fetch(MemAddr address, MemSize size, TID* tid, CID* cid)
         return FAILED;
     }
 
-    // Update access time
-    COMMIT{ line->access = cpu.GetCycleNo(); }
+    // Update the replacement information on hits
+    if (result == SUCCESS)
+    {
+        COMMIT{ m_replacement->Access(line - &m_lines[0]); }
+    }
 
     // If the caller wants the line index, give it
     if (cid != NULL)
@@ -313,6 +404,12 @@ Result ICache::Fetch(MemAddr address, MemSize size, TID* tid, CID* cid)
             // The line was already fetched so we're done.
             // This is 'true' hit in that we don't have to wait.
             COMMIT{ ++m_numHits; }
+
+            if (m_prefetch && m_prefetchEntryPoints && tid == NULL)
+            {
+                // Family creation: prefetch the family's code
+                QueuePrefetch(address);
+            }
             return SUCCESS;
         }
 
@@ -343,9 +440,53 @@ Result ICache::Fetch(MemAddr address, MemSize size, TID* tid, CID* cid)
     }
     else
     {
-        // Cache miss; a line has been allocated, fetch the data
-        if (!m_outgoing.Push(address))
+        // Cache miss; a line has been allocated. The line may be in,
+        // or on its way to, the prefetch buffer.
+        PrefetchLine* pline = FindPrefetchLine(address);
+        if (pline != NULL && pline->state == PREFETCH_INVALID)
+        {
+            // The prefetched line has been invalidated, we have to wait
+            // until it's cleared so we can request a new one
+            ++m_numInvalidMisses;
+            return FAILED;
+        }
+
+        if (pline != NULL && pline->state == PREFETCH_FULL)
+        {
+            // Move the prefetched line into the cache
+            COMMIT
+            {
+                std::copy(pline->data, pline->data + m_lineSize, line->data);
+                pline->state     = PREFETCH_EMPTY;
+
+                line->creation   = false;
+                line->references = 1;
+                line->state      = LINE_FULL;
+                m_tags.SetUsed(line - &m_lines[0], true);
+
+                ++m_numHits;
+                ++m_numPrefetchesUseful;
+            }
+
+            // Keep prefetching ahead of the threads
+            QueuePrefetch(address);
+            return SUCCESS;
+        }
+
+        if (pline != NULL)
+        {
+            // The prefetch is still loading; it keeps the entry until
+            // its completion, which then fills the line.
+            COMMIT
+            {
+                pline->cid = line - &m_lines[0];
+                ++m_numPrefetchesUseful;
+                ++m_numPrefetchesLate;
+            }
+        }
+        else if (!m_outgoing.Push(address))
         {
+            // Fetch the data
             DeadlockWrite("Unable to put request for I-Cache line into outgoing buffer");
             ++m_numStallingMisses;
             return FAILED;
@@ -364,6 +505,7 @@ Result ICache::Fetch(MemAddr address, MemSize size, TID* tid, CID* cid)
             line->creation   = false;
             line->references = 1;
             line->state      = LINE_LOADING;
+            m_tags.SetUsed(line - &m_lines[0], true);
 
             if (tid != NULL)
             {
@@ -382,6 +524,13 @@ Result ICache::Fetch(MemAddr address, MemSize size, TID* tid, CID* cid)
 
     COMMIT{ ++m_numDelayedReads; }
 
+    if (m_prefetch && (result == DELAYED || (m_prefetchEntryPoints && tid == NULL)))
+    {
+        // Prefetch the next lines after a miss, or the family's code
+        // on its creation
+        QueuePrefetch(address);
+    }
+
     return DELAYED;
 }
 
@@ -389,6 +538,28 @@ bool ICache::OnMemoryReadCompleted(MemAddr addr, const char *data)
 {
     // Instruction cache line returned, store in cache and Buffer
 
+    PrefetchLine* pline = FindPrefetchLine(addr);
+    if (pline != NULL && pline->cid != INVALID_CID)
+    {
+        // A miss waits for this prefetch; the data goes into its line
+        assert(pline->state == PREFETCH_LOADING);
+
+        const CID cid = pline->cid;
+        COMMIT
+        {
+            std::copy(data, data + m_lineSize, m_lines[cid].data);
+            pline->state = PREFETCH_EMPTY;
+            pline->cid   = INVALID_CID;
+        }
+
+        if (!m_incoming.Push(cid))
+        {
+            DeadlockWrite("Unable to buffer I-Cache line read completion for line #%u", (unsigned)cid);
+            return false;
+        }
+        return true;
+    }
+
     // Find the line
     Line* line;
     if (FindLine(addr, line, true) == SUCCESS && line->state != LINE_FULL)
@@ -408,6 +579,19 @@ bool ICache::OnMemoryReadCompleted(MemAddr addr, const char *data)
             return false;
         }
     }
+
+    if (pline != NULL && pline->state != PREFETCH_FULL)
+    {
+        COMMIT
+        {
+            if (pline->state == PREFETCH_INVALID) {
+                pline->state = PREFETCH_EMPTY;
+            } else {
+                std::copy(data, data + m_lineSize, pline->data);
+                pline->state = PREFETCH_FULL;
+            }
+        }
+    }
     return true;
 }
 
@@ -428,6 +612,14 @@ bool ICache::OnMemorySnooped(MemAddr address, const char * data, const bool * ma
             line::blit(line->data, data, mask, m_lineSize);
         }
     }
+
+    PrefetchLine* pline = FindPrefetchLine(address);
+    if (pline != NULL)
+    {
+        COMMIT{
+            line::blit(pline->data, data, mask, m_lineSize);
+        }
+    }
     return true;
 }
 
@@ -442,12 +634,22 @@ bool ICache::OnMemoryInvalidated(MemAddr address)
                 // Valid lines without references are invalidated by clearing then. Simple.
                 // Otherwise, we invalidate them.
                 line->state = (line->references == 0) ? LINE_EMPTY : LINE_INVALID;
+                m_tags.SetUsed(line - &m_lines[0], line->state != LINE_EMPTY);
             } else if (line->state != LINE_INVALID) {
                 // Mark the line as invalidated. After it has been loaded and used it will be cleared
                 assert(line->state == LINE_LOADING);
                 line->state = LINE_INVALID;
             }
         }
+
+        PrefetchLine* pline = FindPrefetchLine(address);
+        if (pline != NULL && pline->state != PREFETCH_INVALID && pline->cid == INVALID_CID)
+        {
+            // Loading lines are cleared when their data arrives. Lines
+            // that a miss waits for are invalidated with the cache line.
+            pline->state = (pline->state == PREFETCH_FULL) ? PREFETCH_EMPTY : PREFETCH_INVALID;
+            ++m_numPrefetchesUseless;
+        }
     }
     return true;
 }
@@ -519,6 +721,91 @@ Result ICache::DoIncoming()
     return SUCCESS;
 }
 
+Result ICache::DoPrefetches()
+{
+    assert(!m_prefetches.Empty());
+
+    // Prefetches only use the bus when there are no demand requests
+    if (!m_outgoing.Empty())
+    {
+        DeadlockWrite("Outgoing buffer busy, delaying prefetch");
+        return FAILED;
+    }
+
+    if (!p_service.Invoke())
+    {
+        DeadlockWrite("Unable to acquire port for I-Cache prefetch");
+        return FAILED;
+    }
+
+    const MemAddr address = m_prefetches.Front() + (m_prefetchOffset + 1) * m_lineSize;
+
+    Line* line;
+    if (!GetDRISC().CheckPermissions(address, m_lineSize, IMemory::PERM_EXECUTE))
+    {
+        // Past the end of the code
+        COMMIT{ ++m_numPrefetchesDropped; }
+    }
+    else if (FindLine(address, line, true) != SUCCESS && FindPrefetchLine(address) == NULL)
+    {
+        // Use an empty entry, or replace the oldest unused prefetch
+        PrefetchLine* pline = NULL;
+        for (auto& p : m_plines)
+        {
+            if (p.state == PREFETCH_EMPTY)
+            {
+                pline = &p;
+                break;
+            }
+
+            if (p.state == PREFETCH_FULL && (pline == NULL || p.access < pline->access))
+            {
+                pline = &p;
+            }
+        }
+
+        if (pline == NULL)
+        {
+            // All entries are still loading
+            COMMIT{ ++m_numPrefetchesDropped; }
+        }
+        else
+        {
+            if (!m_outgoing.Push(address))
+            {
+                DeadlockWrite("Unable to put prefetch for I-Cache line into outgoing buffer");
+                return FAILED;
+            }
+
+            DebugMemWrite("Prefetching %#016llx", (unsigned long long)address);
+
+            COMMIT
+            {
+                if (pline->state == PREFETCH_FULL)
+                {
+                    ++m_numPrefetchesUseless;
+                }
+                pline->address = address;
+                pline->access  = GetDRISC().GetCycleNo();
+                pline->state   = PREFETCH_LOADING;
+                ++m_numPrefetchesIssued;
+            }
+        }
+    }
+
+    // Move on to the next line
+    if (m_prefetchOffset + 1 == m_prefetchLines)
+    {
+        m_prefetches.Pop();
+        COMMIT{ m_prefetchOffset = 0; }
+    }
+    else
+    {
+        COMMIT{ m_prefetchOffset++; }
+    }
+    return SUCCESS;
+}
+
 void ICache::Cmd_Info(std::ostream& out, const std::vector<std::string>& /*arguments*/) const
 {
     out <<
@@ -528,7 +815,10 @@ void ICache::Cmd_Info(std::ostream& out, const std::vector<std::string>& /*argum
     "Supported operations:\n"
     "- inspect <component>\n"
     "  Reads and displays the cache-lines, and global information such as hit-rate\n"
-    "  and cache configuration.\n";
+    "  and cache configuration.\n"
+    "- inspect <component> buffers\n"
+    "  Reads and displays the outgoing, incoming and prefetch buffers, then the\n"
+    "  cache-lines.\n";
 }
 
 void ICache::Cmd_Read(std::ostream& out, const std::vector<std::string>& arguments) const
@@ -545,6 +835,7 @@ void ICache::Cmd_Read(std::ostream& out, const std::vector<std::string>& argumen
         }
 
         out << "L1 bank mapping:     " << m_selector->GetName() << endl
+            << "Replacement policy:  " << m_replacement->GetName() << endl
             << "Cache size:          " << dec << (m_lineSize * m_lines.size()) << " bytes" << endl
             << "Cache line size:     " << dec << m_lineSize << " bytes" << endl
             << endl;
@@ -583,6 +874,28 @@ void ICache::Cmd_Read(std::ostream& out, const std::vector<std::string>& argumen
                 << "(percentages relative to " << numRAccesses << " read requests)" << endl
                 << endl;
 
+            if (m_prefetch)
+            {
+                uint64_t numUseful = m_numPrefetchesUseful;
+                out << "***********************************************************" << endl
+                    << "                      Prefetches                           " << endl
+                    << "***********************************************************" << endl
+                    << endl
+                    << "Prefetch requests to upstream:        " << m_numPrefetchesIssued << endl
+                    << "Prefetches dropped:                   " << m_numPrefetchesDropped << endl;
+                if (m_numPrefetchesIssued == 0)
+                    out << "No prefetches so far, cannot provide statistical data." << endl;
+                else
+                {
+                    float p_factor = 100.0f / m_numPrefetchesIssued;
+                    out << "Useful prefetches:                    " << PRINTVAL(numUseful, p_factor) << endl
+                        << "- still loading when used (late):     " << PRINTVAL(m_numPrefetchesLate, p_factor) << endl
+                        << "Useless prefetches:                   " << PRINTVAL(m_numPrefetchesUseless, p_factor) << endl
+                        << "(percentages relative to " << m_numPrefetchesIssued << " prefetch requests)" << endl;
+                }
+                out << endl;
+            }
+
             if (numStalls != 0)
             {
                 float s_factor = 100.f / numStalls;
@@ -626,6 +939,22 @@ void ICache::Cmd_Read(std::ostream& out, const std::vector<std::string>& argumen
                  out << " C" << dec << *p;
              }
         out << endl;
+
+        if (m_prefetch)
+        {
+            out << endl << "Prefetch buffer:";
+            for (auto& p : m_plines)
+            {
+                switch (p.state)
+                {
+                case PREFETCH_EMPTY:   out << " -"; break;
+                case PREFETCH_LOADING: out << " " << hex << "0x" << p.address << dec << "L"; break;
+                case PREFETCH_INVALID: out << " " << hex << "0x" << p.address << dec << "I"; break;
+                case PREFETCH_FULL:    out << " " << hex << "0x" << p.address << dec; break;
+                }
+            }
+            out << endl << endl;
+        }
     }
 
     out << "Set |       Address       |                       Data                      | Ref |" << endl;
@@ -651,7 +980,7 @@ void ICache::Cmd_Read(std::ostream& out, const std::vector<std::string>& argumen
             }
 
             out << " | "
-                << hex << "0x" << setw(16) << setfill('0') << m_selector->Unmap(line.tag, set) * m_lineSize
+                << hex << "0x" << setw(16) << setfill('0') << m_selector->Unmap(m_tags.GetTag(i), set) * m_lineSize
                 << state << " |";
 
             if (line.state == LINE_FULL)
@@ -6,6 +6,8 @@
 #include "sim/inspect.h"
 #include "sim/buffer.h"
 #include "arch/Memory.h"
+#include "arch/TagArray.h"
+#include "arch/ReplacementPolicy.h"
 #include "forward.h"
 
 namespace Simulator
@@ -28,35 +30,68 @@ class ICache : public Object, public IMemoryCallback, public Inspect::Interface<
     /// A Cache-line
     struct Line
     {
-        MemAddr       tag;          ///< Address tag
         char*         data;         ///< The line data
-        CycleNo       access;       ///< Last access time (for LRU replacement)
         ThreadQueue   waiting;      ///< Threads waiting on this line
         unsigned long references;   ///< Number of references to this line
         LineState     state;        ///< The state of the line
         bool          creation;             ///< Is the family creation process waiting on this line?
 
-        SERIALIZE(arch) { arch & "l" & tag & access & waiting & references & state & creation; }
+        SERIALIZE(arch) { arch & "l" & waiting & references & state & creation; }
+    };
+
+    enum PrefetchState
+    {
+        PREFETCH_EMPTY,     ///< Entry is not in use
+        PREFETCH_LOADING,   ///< Line is being prefetched
+        PREFETCH_INVALID,   ///< Line has been invalidated while being prefetched
+        PREFETCH_FULL,      ///< Line has been prefetched and not used yet
+    };
+
+    /// A line in the prefetch buffer. Prefetched lines are kept out of
+    /// the cache until a fetch uses them.
+    struct PrefetchLine
+    {
+        MemAddr       address;      ///< Address of the line
+        char*         data;         ///< The line data
+        CycleNo       access;       ///< Time of the prefetch (for replacement)
+        PrefetchState state;        ///< The state of the entry
+        CID           cid;          ///< Cache line that waits for the prefetch, if any
+
+        SERIALIZE(arch) { arch & "p" & address & access & state & cid; }
     };
 
     Result Fetch(MemAddr address, MemSize size, TID* tid, CID* cid);
     Result FindLine(MemAddr address, Line* &line, bool check_only = false);
+    PrefetchLine* FindPrefetchLine(MemAddr address);
+    void   QueuePrefetch(MemAddr address);
 
     // Processes
     Result DoOutgoing();
     Result DoIncoming();
+    Result DoPrefetches();
 
     IMemory*          m_memory;
     IBankSelector*    m_selector;
     MCID              m_mcid;
     std::vector<Line> m_lines;
-    std::vector<char> m_data;
+    char*             m_data;                ///< The data in the cache lines, in the arena
+    TagArray          m_tags;                ///< The tags of the cache lines
+    IReplacementPolicy* m_replacement;       ///< Choice of the lines to replace
     Buffer<MemAddr>   m_outgoing;
     Buffer<CID>       m_incoming;
 
     size_t            m_lineSize;
     size_t            m_assoc;
 
+    // Next-N-line prefetcher
+    bool              m_prefetch;            ///< Config: Is the prefetcher enabled?
+    bool              m_prefetchEntryPoints; ///< Config: Prefetch after family creation fetches?
+    unsigned          m_prefetchLines;       ///< Config: Number of lines to prefetch after a trigger
+    std::vector<PrefetchLine> m_plines;      ///< The prefetch buffer
+    std::vector<char> m_pdata;               ///< The data in the prefetch buffer
+    Buffer<MemAddr>   m_prefetches;          ///< Lines after which to prefetch
+    unsigned          m_prefetchOffset;      ///< Number of lines done for the front trigger
+
     // Statistics:
     DefineSampleVariable(uint64_t, numHits);
     DefineSampleVariable(uint64_t, numDelayedReads);
@@ -66,6 +101,11 @@ class ICache : public Object, public IMemoryCallback, public Inspect::Interface<
     DefineSampleVariable(uint64_t, numHardConflicts);
     DefineSampleVariable(uint64_t, numResolvedConflicts);
     DefineSampleVariable(uint64_t, numStallingMisses);
+    DefineSampleVariable(uint64_t, numPrefetchesIssued);
+    DefineSampleVariable(uint64_t, numPrefetchesDropped);
+    DefineSampleVariable(uint64_t, numPrefetchesUseful);
+    DefineSampleVariable(uint64_t, numPrefetchesLate);
+    DefineSampleVariable(uint64_t, numPrefetchesUseless);
 
     Object& GetDRISCParent() const { return *GetParent(); }
 
@@ -79,6 +119,7 @@ public:
     // Processes
     Process p_Outgoing;
     Process p_Incoming;
+    Process p_Prefetches;
 
     ArbitratedService<> p_service;
 
@@ -83,7 +83,9 @@ Pipeline::PipeAction Pipeline::MemoryStage::OnCycle()
                         return PIPE_STALL;
                     }
 
-                    if (!m_allocator.IncreaseThreadDependency(m_input.tid, THREADDEP_OUTSTANDING_WRITES))
+                    // A store merged into a pending write of the thread
+                    // (SUCCESS) is acknowledged with that write
+                    if (result == DELAYED && !m_allocator.IncreaseThreadDependency(m_input.tid, THREADDEP_OUTSTANDING_WRITES))
                     {
                         DeadlockWrite("F%u/T%u(%llu) %s unable to increase OUTSTANDING_WRITES",
                                       (unsigned)m_input.fid, (unsigned)m_input.tid, (unsigned long long)m_input.logical_index,
@@ -190,7 +192,7 @@ Pipeline::PipeAction Pipeline::MemoryStage::OnCycle()
                     else
                     {
                         // Normal read from memory.
-                        result = m_dcache.Read(m_input.address, data, m_input.size, &reg);
+                        result = m_dcache.Read(m_input.address, data, m_input.size, &reg, m_input.pc, m_input.fid);
 
                         switch(result)
                         {
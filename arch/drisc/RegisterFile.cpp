@@ -37,7 +37,7 @@ RegisterFile::RegisterFile(const std::string& name, DRISC& parent, Clock& clock)
     {
         static constexpr std::array<const char*, NUM_REG_TYPES> cfg_names = { {"NumIntRegisters", "NumFltRegisters"} };
         m_sizes[i] = GetConf(cfg_names[i], size_t);
-        m_files[i] = new RegValue[m_sizes[i]];
+        m_files[i] = GetKernel()->GetArena().Allocate<RegValue>(m_sizes[i]);
         for (RegSize j = 0; j < m_sizes[i]; ++j)
         {
             m_files[i][j] = MAKE_EMPTY_REG();
@@ -47,6 +47,8 @@ RegisterFile::RegisterFile(const std::string& name, DRISC& parent, Clock& clock)
     AddPort(p_pipelineW);
     AddPort(p_asyncW);
 
+    SetUpdateType(*this);
+
     // Register aliases for debugging
     for (size_t i = 0; i < NUM_REG_TYPES; ++i)
     {
@@ -57,12 +59,6 @@ RegisterFile::RegisterFile(const std::string& name, DRISC& parent, Clock& clock)
     }
 }
 
-RegisterFile::~RegisterFile()
-{
-    for (auto p : m_files)
-        delete[] p;
-}
-
 bool RegisterFile::ReadRegister(const RegAddr& addr, RegValue& data, bool quiet) const
 {
     auto& regs = m_files[addr.type];
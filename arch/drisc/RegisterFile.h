@@ -38,7 +38,6 @@ public:
      * @param[in] config reference to the configuration data.
      */
     RegisterFile(const std::string& name, DRISC& parent, Clock& clock);
-    ~RegisterFile();
 
     /**
      * Reads a register
@@ -111,8 +110,9 @@ public:
 private:
     // Applies the queued updates
     void Update() override;
+    friend class TypedStorageBatch<RegisterFile>;
 
-    std::array<RegValue*, NUM_REG_TYPES> m_files; ///< Sub-files of registers, indexed by RegType
+    std::array<RegValue*, NUM_REG_TYPES> m_files; ///< Sub-files of registers, indexed by RegType, in the arena
     std::array<RegSize, NUM_REG_TYPES> m_sizes;
 
     // We can have at most this many number of updates per cycle.
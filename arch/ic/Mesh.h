@@ -0,0 +1,542 @@
+// -*- c++ -*-
+#ifndef IC_MESH_H
+#define IC_MESH_H
+
+#include "arch/Interconnect.h"
+#include "arch/ic/WireNet.h"
+#include "arch/ic/EndPointRegistry.h"
+#include "arch/ic/DestinationBuffering.h"
+#include "sim/kernel.h"
+#include "sim/buffer.h"
+#include "sim/config.h"
+#include "sim/register_functions.h"
+#include "sim/delegate_closure.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace Simulator
+{
+
+    namespace IC {
+
+        /// A 2D mesh or torus of routers. The senders and receivers
+        /// are attached to the local ports of the routers, either as
+        /// configured by MeshNode on the endpoint, or in the order in
+        /// which they are registered.
+        ///
+        /// Messages are routed in dimension order: first along X,
+        /// then along Y. Each link input of a router has a number of
+        /// virtual channels, each a buffer of messages. A message
+        /// leaves a router RouterLatency cycles after it entered it
+        /// at the earliest, and takes LinkLatency cycles to cross a
+        /// link, which carries one message every LinkCycles cycles.
+        ///
+        /// On a torus, messages take the shortest way around each
+        /// dimension. They use the lower half of the virtual channels
+        /// until they cross the wraparound link of the dimension, and
+        /// the upper half afterwards, so that the rings cannot
+        /// deadlock.
+        ///
+        /// Broadcasts are sent as one message per receiver from the
+        /// router of the sender.
+        template<typename BaseIC>
+        class Mesh
+            : public virtual Object,
+              public virtual IInterconnect<typename BaseIC::PayloadType>,
+              public BaseIC
+        {
+        public:
+            typedef typename BaseIC::MessageType MessageType;
+
+        private:
+            enum LinkPort
+            {
+                LINK_NORTH,
+                LINK_EAST,
+                LINK_SOUTH,
+                LINK_WEST,
+                NUM_LINKS
+            };
+
+            struct Flit
+            {
+                MessageType* msg;
+                SenderKey    src;
+                ReceiverKey  dst;      ///< INVALID_KEY for a broadcast
+                CycleNo      ready;    ///< Cycle from which it can leave the router
+                CycleNo      injected; ///< Cycle in which it entered the network
+                unsigned     hops;     ///< Number of links crossed so far
+                unsigned     vcclass;  ///< Half of the virtual channels in use (torus)
+                bool         ydim;     ///< Whether the last link crossed was along Y
+
+                SERIALIZE(a) { a & "[flit" & msg & src & dst & ready & injected & hops & vcclass & ydim & "]"; }
+            };
+
+            struct Router
+            {
+                std::vector<Buffer<Flit>*> inputs;    ///< Link inputs (NUM_LINKS * VCs), then the local senders
+                std::vector<SenderKey>     senders;   ///< Sender of each local input
+                std::vector<ReceiverKey>   receivers; ///< Receivers on the local port
+                std::vector<CycleNo>       linkFree;  ///< First cycle each output link is free
+                std::vector<size_t>        next;      ///< Round-robin input for each output
+                std::vector<bool>          used;      ///< Scratch for DoRoute: inputs taken this cycle
+                Process*                   process;
+
+                Router()
+                    : inputs(), senders(), receivers(),
+                      linkFree(NUM_LINKS, 0), next(NUM_LINKS, 0),
+                      used(), process(NULL) {}
+                Router(const Router&) = default;
+                Router& operator=(const Router&) = default;
+            };
+
+            Clock&                     m_clock;
+            size_t                     m_width;
+            size_t                     m_height;
+            bool                       m_torus;
+            size_t                     m_numVCs;
+            unsigned                   m_routerLatency;
+            unsigned                   m_linkLatency;
+            unsigned                   m_linkCycles;
+
+            std::vector<Router>        m_routers;
+            std::vector<Buffer<Flit>*> m_injection;      ///< Input of each sender
+            std::vector<size_t>        m_senderNodes;
+            std::vector<size_t>        m_receiverNodes;
+            std::vector<ReceiverKey>   m_bcastReceivers;
+            std::vector<size_t>        m_bcastNext;      ///< Next broadcast receiver, for each sender
+
+            // Statistics
+            DefineSampleVariable(uint64_t, nmessages);   ///< Messages delivered
+            DefineSampleVariable(uint64_t, nhops);       ///< Links crossed by the delivered messages
+            DefineSampleVariable(uint64_t, latency);     ///< Cycles spent in the network by the delivered messages
+
+            size_t PlaceEndPoint(const std::string& lname, size_t key) const
+            {
+                const size_t numNodes = m_routers.size();
+                size_t node = GetKernel()->GetConfig()->template getValueOrDefault<size_t>(lname, "MeshNode", key % numNodes);
+                if (node >= numNodes)
+                {
+                    throw exceptf<InvalidArgumentException>(*this, "Node %zu of %s is outside the %zux%zu mesh",
+                                                            node, lname.c_str(), m_width, m_height);
+                }
+                return node;
+            }
+
+            // Direction to take along one dimension
+            LinkPort Direction(size_t from, size_t to, size_t size, LinkPort up, LinkPort down) const
+            {
+                if (m_torus)
+                {
+                    const size_t forward = (to + size - from) % size;
+                    return (forward <= size - forward) ? up : down;
+                }
+                return (to > from) ? up : down;
+            }
+
+            // Output link of router n towards receiver dst, or
+            // NUM_LINKS for the local port.
+            size_t Route(size_t n, ReceiverKey dst) const
+            {
+                const size_t node = m_receiverNodes[dst];
+                const size_t x = n % m_width, y = n / m_width;
+                const size_t dx = node % m_width, dy = node / m_width;
+                if (x != dx) {
+                    return Direction(x, dx, m_width, LINK_EAST, LINK_WEST);
+                }
+                if (y != dy) {
+                    return Direction(y, dy, m_height, LINK_SOUTH, LINK_NORTH);
+                }
+                return NUM_LINKS;
+            }
+
+            // Router on the other side of a link; wrap is set if it
+            // is a wraparound link of the torus.
+            size_t Neighbour(size_t n, size_t link, bool& wrap) const
+            {
+                size_t x = n % m_width, y = n / m_width;
+                wrap = false;
+                switch (link)
+                {
+                case LINK_NORTH: wrap = (y == 0);            y = (y + m_height - 1) % m_height; break;
+                case LINK_SOUTH: wrap = (y == m_height - 1); y = (y + 1) % m_height; break;
+                case LINK_WEST:  wrap = (x == 0);            x = (x + m_width - 1) % m_width; break;
+                case LINK_EAST:  wrap = (x == m_width - 1);  x = (x + 1) % m_width; break;
+                }
+                return y * m_width + x;
+            }
+
+            bool HasLink(size_t n, size_t link) const
+            {
+                if (m_torus) {
+                    return (link == LINK_NORTH || link == LINK_SOUTH) ? m_height > 1 : m_width > 1;
+                }
+                const size_t x = n % m_width, y = n / m_width;
+                switch (link)
+                {
+                case LINK_NORTH: return y > 0;
+                case LINK_SOUTH: return y < m_height - 1;
+                case LINK_WEST:  return x > 0;
+                default:         return x < m_width - 1;
+                }
+            }
+
+            static size_t Opposite(size_t link) { return (link + 2) % NUM_LINKS; }
+
+            // Destination of the message at the front of an input
+            ReceiverKey GetDestination(const Router& r, size_t input, const Flit& f) const
+            {
+                if (f.dst != INVALID_KEY) {
+                    return f.dst;
+                }
+                return m_bcastReceivers[m_bcastNext[r.senders[input - NUM_LINKS * m_numVCs]]];
+            }
+
+            Result DoRoute(size_t n)
+            {
+                Router& r = m_routers[n];
+                const CycleNo now = m_clock.GetCycleNo();
+                const size_t numInputs = r.inputs.size();
+                const size_t numOutputs = NUM_LINKS + r.receivers.size();
+                CycleNo wakeup = INFINITE_CYCLES;
+                bool progress = false, blocked = false;
+                std::vector<bool>& used = r.used;
+                used.assign(numInputs, false);
+
+                // Each output takes the message at the front of one
+                // input, in round-robin order.
+                for (size_t o = 0; o < numOutputs; ++o)
+                {
+                    for (size_t k = 0; k < numInputs; ++k)
+                    {
+                        const size_t i = (r.next[o] + k) % numInputs;
+                        Buffer<Flit>& input = *r.inputs[i];
+                        if (used[i] || input.Empty()) {
+                            continue;
+                        }
+
+                        if (i >= NUM_LINKS * m_numVCs && input.Front().dst == INVALID_KEY && m_bcastReceivers.empty())
+                        {
+                            // A broadcast without receivers
+                            COMMIT{ delete input.Front().msg; }
+                            input.Pop();
+                            used[i] = progress = true;
+                            continue;
+                        }
+
+                        const Flit& f = input.Front();
+                        const ReceiverKey dst = GetDestination(r, i, f);
+                        size_t out = Route(n, dst);
+                        if (out == NUM_LINKS) {
+                            out += std::find(r.receivers.begin(), r.receivers.end(), dst) - r.receivers.begin();
+                        }
+                        if (out != o) {
+                            continue;
+                        }
+
+                        const CycleNo ready = (o < NUM_LINKS) ? std::max(f.ready, r.linkFree[o]) : f.ready;
+                        if (ready > now)
+                        {
+                            wakeup = std::min(wakeup, ready);
+                            continue;
+                        }
+
+                        // Broadcasts send a copy to each receiver but the last
+                        const bool bcast = (f.dst == INVALID_KEY);
+                        const bool last = !bcast || m_bcastNext[r.senders[i - NUM_LINKS * m_numVCs]] + 1 == m_bcastReceivers.size();
+                        MessageType* msg = f.msg;
+                        if (!last) {
+                            COMMIT{ msg = f.msg->dup(); }
+                        }
+
+                        if (o < NUM_LINKS)
+                        {
+                            // Pick a virtual channel with room in the next router
+                            bool wrap;
+                            Router& next = m_routers[Neighbour(n, o, wrap)];
+                            const bool ydim = (o == LINK_NORTH || o == LINK_SOUTH);
+                            unsigned vcclass = (ydim == f.ydim) ? f.vcclass : 0;
+                            if (wrap) {
+                                vcclass = 1;
+                            }
+                            const size_t numVCs = m_torus ? m_numVCs / 2 : m_numVCs;
+                            const size_t first = Opposite(o) * m_numVCs + vcclass * numVCs;
+
+                            Buffer<Flit>* vc = NULL;
+                            for (size_t v = first; v < first + numVCs; ++v)
+                            {
+                                if (next.inputs[v]->size() < next.inputs[v]->GetMaxSize())
+                                {
+                                    vc = next.inputs[v];
+                                    break;
+                                }
+                            }
+
+                            if (vc == NULL)
+                            {
+                                blocked = true;
+                                if (!last) {
+                                    COMMIT{ delete msg; }
+                                }
+                                continue;
+                            }
+
+                            Flit nf = f;
+                            nf.msg     = msg;
+                            nf.dst     = dst;
+                            nf.ready   = now + m_linkLatency + m_routerLatency;
+                            nf.hops    = f.hops + 1;
+                            nf.vcclass = vcclass;
+                            nf.ydim    = ydim;
+                            if (!vc->Push(nf))
+                            {
+                                DeadlockWrite("Unable to push message into router %zu", (size_t)(&next - &m_routers[0]));
+                                return FAILED;
+                            }
+
+                            COMMIT{ r.linkFree[o] = now + m_linkCycles; }
+                        }
+                        else
+                        {
+                            if (!this->BaseIC::SendMessage(n, dst, msg))
+                            {
+                                blocked = true;
+                                if (!last) {
+                                    COMMIT{ delete msg; }
+                                }
+                                continue;
+                            }
+
+                            COMMIT
+                            {
+                                ++m_nmessages;
+                                m_nhops   += f.hops;
+                                m_latency += now - f.injected;
+                            }
+                        }
+
+                        if (bcast)
+                        {
+                            const SenderKey sk = r.senders[i - NUM_LINKS * m_numVCs];
+                            COMMIT{ m_bcastNext[sk] = last ? 0 : m_bcastNext[sk] + 1; }
+                        }
+                        if (last) {
+                            input.Pop();
+                        }
+
+                        COMMIT{ r.next[o] = (i + 1) % numInputs; }
+                        used[i] = progress = true;
+                        break;
+                    }
+                }
+
+                if (!progress)
+                {
+                    if (blocked)
+                    {
+                        DeadlockWrite("Unable to forward messages in router %zu", n);
+                        return FAILED;
+                    }
+                    if (wakeup != INFINITE_CYCLES) {
+                        GetKernel()->WaitUntil(wakeup);
+                    }
+                }
+                return SUCCESS;
+            }
+
+        public:
+            Mesh(const std::string& name, Object& parent)
+                : Object(name, parent),
+                  BaseIC(name, parent),
+                  m_clock(GetKernel()->CreateClock(GetKernel()->GetConfig()->template getValue<Clock::Frequency>(*this, "MeshFreq"))),
+                  m_width(GetKernel()->GetConfig()->template getValue<size_t>(*this, "MeshWidth")),
+                  m_height(GetKernel()->GetConfig()->template getValue<size_t>(*this, "MeshHeight")),
+                  m_torus(false),
+                  m_numVCs(GetKernel()->GetConfig()->template getValueOrDefault<size_t>(*this, "VirtualChannels", 2)),
+                  m_routerLatency(GetKernel()->GetConfig()->template getValueOrDefault<unsigned>(*this, "RouterLatency", 2)),
+                  m_linkLatency(GetKernel()->GetConfig()->template getValueOrDefault<unsigned>(*this, "LinkLatency", 1)),
+                  m_linkCycles(GetKernel()->GetConfig()->template getValueOrDefault<unsigned>(*this, "LinkCycles", 1)),
+                  m_routers(),
+                  m_injection(),
+                  m_senderNodes(),
+                  m_receiverNodes(),
+                  m_bcastReceivers(),
+                  m_bcastNext(),
+                  InitSampleVariable(nmessages, SVC_CUMULATIVE),
+                  InitSampleVariable(nhops, SVC_CUMULATIVE),
+                  InitSampleVariable(latency, SVC_CUMULATIVE)
+            {
+                const std::string topology = GetKernel()->GetConfig()->template getValueOrDefault<std::string>(*this, "Topology", "mesh");
+                if (topology == "torus" || topology == "TORUS") {
+                    m_torus = true;
+                } else if (topology != "mesh" && topology != "MESH") {
+                    throw exceptf<InvalidArgumentException>(*this, "Unknown topology: %s", topology.c_str());
+                }
+
+                if (m_width == 0 || m_height == 0) {
+                    throw InvalidArgumentException(*this, "MeshWidth and MeshHeight must be at least 1");
+                }
+                if (m_numVCs < (m_torus ? 2 : 1) || (m_torus && m_numVCs % 2 != 0)) {
+                    throw InvalidArgumentException(*this, "VirtualChannels must be at least 1, and even on a torus");
+                }
+                if (m_linkCycles == 0) {
+                    throw InvalidArgumentException(*this, "LinkCycles must be at least 1");
+                }
+
+                const BufferSize vcsize = GetKernel()->GetConfig()->template getValueOrDefault<BufferSize>(*this, "VCBufferSize", 2);
+                static const char* const links = "NESW";
+
+                m_routers.resize(m_width * m_height);
+                for (size_t n = 0; n < m_routers.size(); ++n)
+                {
+                    Router& r = m_routers[n];
+                    const std::string rname = "r" + std::to_string(n);
+                    r.process = new Process(*this, rname + ".p_route",
+                                            closure<Result>::adapter<Result>::capture<size_t>::create<Mesh, &Mesh::DoRoute>(*this, n));
+                    for (size_t l = 0; l < NUM_LINKS; ++l)
+                    {
+                        for (size_t v = 0; v < m_numVCs; ++v)
+                        {
+                            auto b = new Buffer<Flit>(rname + "." + links[l] + std::to_string(v) + ".b_buffer", *this, m_clock, vcsize);
+                            b->Sensitive(*r.process);
+                            r.inputs.push_back(b);
+                        }
+                    }
+
+                    // The routers deliver the messages to the receivers
+                    this->BaseIC::ConnectSender(this->BaseIC::RegisterSender(rname), *r.process);
+                }
+            }
+
+            ~Mesh()
+            {
+                for (auto& r : m_routers)
+                {
+                    for (size_t i = 0; i < NUM_LINKS * m_numVCs; ++i)
+                        delete r.inputs[i];
+                    delete r.process;
+                }
+                for (auto b : m_injection)
+                    delete b;
+            }
+
+            virtual Clock& GetSenderClock(SenderKey /*ignore*/) const override
+            {
+                return m_clock;
+            }
+
+            virtual ReceiverKey RegisterReceiver(const std::string& lname) override
+            {
+                auto rk = this->BaseIC::RegisterReceiver(lname);
+                if (rk >= m_receiverNodes.size())
+                    m_receiverNodes.resize(rk + 1);
+                const size_t node = PlaceEndPoint(lname, rk);
+                m_receiverNodes[rk] = node;
+
+                Router& r = m_routers[node];
+                r.receivers.push_back(rk);
+                r.next.push_back(0);
+                return rk;
+            }
+
+            virtual SenderKey RegisterSender(const std::string& lname) override
+            {
+                // The senders only push into the network; the routers
+                // are the senders of the underlying network.
+                SenderKey sk = m_injection.size();
+                const size_t node = PlaceEndPoint(lname, sk);
+                m_senderNodes.push_back(node);
+                m_bcastNext.push_back(0);
+
+                Router& r = m_routers[node];
+                const auto bname = "in" + std::to_string(sk) + ".b_buffer";
+                auto b = new Buffer<Flit>(bname, *this, m_clock,
+                                          GetKernel()->GetConfig()->template getValue<BufferSize>(*this, bname, "BufferSize"));
+                b->Sensitive(*r.process);
+                m_injection.push_back(b);
+                r.inputs.push_back(b);
+                r.senders.push_back(sk);
+                return sk;
+            }
+
+            virtual void ConnectSender(SenderKey sk, const Process& /*unused*/) override
+            {
+                assert(sk < m_injection.size());
+                (void)sk;
+            }
+
+            virtual StorageTraceSet GetRequestTraces(SenderKey sk) const override
+            {
+                return *m_injection[sk];
+            }
+
+            virtual StorageTraceSet GetBroadcastTraces(SenderKey sk) const override
+            {
+                return *m_injection[sk];
+            }
+
+            virtual bool SendMessage(SenderKey src, ReceiverKey dst, MessageType* msg) override
+            {
+                assert(src < m_injection.size());
+                assert(dst < m_receiverNodes.size());
+                const CycleNo now = m_clock.GetCycleNo();
+                if (!m_injection[src]->Push(Flit{ msg, src, dst, now + m_routerLatency, now, 0, 0, false }))
+                {
+                    DeadlockWrite("Unable to inject message %zu -> %zu", (size_t)src, (size_t)dst);
+                    return false;
+                }
+                return true;
+            }
+
+            virtual bool SendBroadcast(SenderKey src, MessageType* msg) override
+            {
+                assert(src < m_injection.size());
+                const CycleNo now = m_clock.GetCycleNo();
+                if (!m_injection[src]->Push(Flit{ msg, src, INVALID_KEY, now + m_routerLatency, now, 0, 0, false }))
+                {
+                    DeadlockWrite("Unable to inject broadcast from %zu", (size_t)src);
+                    return false;
+                }
+                return true;
+            }
+
+            virtual void Initialize() override
+            {
+                this->BaseIC::Initialize();
+
+                for (ReceiverKey rk = 0; rk < m_receiverNodes.size(); ++rk)
+                    if (this->BaseIC::IsBroadcastReceiver(rk))
+                        m_bcastReceivers.push_back(rk);
+
+                // The routers push to the next routers in the order
+                // of their links, then deliver to their receivers.
+                for (size_t n = 0; n < m_routers.size(); ++n)
+                {
+                    Router& r = m_routers[n];
+                    StorageTraceSet traces;
+                    for (size_t l = 0; l < NUM_LINKS; ++l)
+                    {
+                        if (!HasLink(n, l))
+                            continue;
+                        bool wrap;
+                        const Router& next = m_routers[Neighbour(n, l, wrap)];
+                        StorageTraceSet vcs;
+                        for (size_t v = 0; v < m_numVCs; ++v)
+                            vcs ^= *next.inputs[Opposite(l) * m_numVCs + v];
+                        traces = traces * opt(vcs);
+                    }
+                    for (auto rk : r.receivers)
+                        traces = traces * opt(this->GetReceiverTraces(rk));
+                    r.process->SetStorageTraces(traces);
+                }
+            }
+        };
+
+        template<typename Payload>
+        using BufferedMesh = EndPointRegistry<DestinationBuffering<Mesh<WireNet<Payload>>>>;
+
+    }
+}
+
+#endif
@@ -84,6 +84,10 @@ class BankedMemory::Bank : public Object
 
             m_incoming.Pop();
         }
+        else
+        {
+            GetKernel()->WaitUntil(request.done);
+        }
         return SUCCESS;
     }
 
@@ -114,6 +118,10 @@ class BankedMemory::Bank : public Object
 
             m_outgoing.Pop();
         }
+        else
+        {
+            GetKernel()->WaitUntil(request.done);
+        }
         return SUCCESS;
     }
 
@@ -141,6 +149,10 @@ class BankedMemory::Bank : public Object
                 return FAILED;
             }
         }
+        else
+        {
+            GetKernel()->WaitUntil(m_request.done);
+        }
         return SUCCESS;
     }
 
@@ -17,33 +17,71 @@ static T GET_BITS(const T& value, unsigned int offset, unsigned int size)
 
 static const unsigned long INVALID_ROW = std::numeric_limits<unsigned long>::max();
 
-bool DDRChannel::Read(MemAddr address, MemSize size)
+void DDRChannel::DecodeAddress(MemAddr address, unsigned& array, uint64_t& row) const
+{
+    // Ranks and banks are analogous in this concept; each bank can be invidually pre-charged and activated,
+    // providing an array of rows * columns cells.
+    address /= m_ddrconfig.m_nDevicesPerRank;
+    const unsigned int bank = GET_BITS(address, m_ddrconfig.m_nBankStart, m_ddrconfig.m_nBankBits),
+                       rank = GET_BITS(address, m_ddrconfig.m_nRankStart, m_ddrconfig.m_nRankBits);
+    array = rank * (1 << m_ddrconfig.m_nBankBits) + bank;
+    row   = GET_BITS(address, m_ddrconfig.m_nRowStart, m_ddrconfig.m_nRowBits);
+}
+
+DDRChannel::QueueCount::QueueCount(const std::string& name, Object& parent, Clock& clock, size_t maxSize)
+    : Object(name, parent),
+      Storage(name, parent, clock),
+      SensitiveStorage(name, parent, clock),
+      m_maxSize(maxSize),
+      InitStateVariable(count, 0),
+      InitStateVariable(arrivals, 0),
+      InitStateVariable(departures, 0)
 {
-    if (m_busy.IsSet())
+    SetUpdateType(*this);
+}
+
+bool DDRChannel::QueueCount::Add()
+{
+    MarkUpdate();
+    if (m_count + m_arrivals >= m_maxSize)
     {
-        // We're still busy
         return false;
     }
-
-    // Accept request
     COMMIT
     {
-        m_request.address = address;
-        m_request.offset  = 0;
-        m_request.size    = size;
-        m_request.write   = false;
+        ++m_arrivals;
+        RegisterUpdate();
     }
+    return true;
+}
 
-    if (!m_busy.Set())
+void DDRChannel::QueueCount::Remove()
+{
+    assert(m_departures < m_count);
+    MarkUpdate();
+    COMMIT
     {
-        return false;
+        ++m_departures;
+        RegisterUpdate();
     }
-    return true;
 }
 
-bool DDRChannel::Write(MemAddr address, MemSize size)
+void DDRChannel::QueueCount::Update()
+{
+    const size_t count = m_count + m_arrivals - m_departures;
+    if (m_count == 0 && count != 0) {
+        Notify();
+    } else if (m_count != 0 && count == 0) {
+        Unnotify();
+    }
+    m_count      = count;
+    m_arrivals   = 0;
+    m_departures = 0;
+}
+
+bool DDRChannel::QueueRequest(MemAddr address, MemSize size, bool write)
 {
-    if (m_busy.IsSet())
+    if (!m_queued.Add())
     {
         // We're still busy
         return false;
@@ -52,44 +90,157 @@ bool DDRChannel::Write(MemAddr address, MemSize size)
     // Accept request
     COMMIT
     {
-        m_request.address = address;
-        m_request.offset  = 0;
-        m_request.size    = size;
-        m_request.write   = true;
+        Request request;
+        request.address = address;
+        request.offset  = 0;
+        request.size    = size;
+        request.write   = write;
+        request.done    = 0;
+        request.seq     = m_nextSeq++;
+        request.arrival = m_clock.GetCycleNo();
+        DecodeAddress(address, request.array, request.row);
+        m_queues[request.array].push_back(request);
+
+        if (write) {
+            ++m_numWrites;
+        }
+        ++m_numRequests;
+        m_totalQueued += m_queued.size() + 1;
+        m_maxQueued = std::max(m_maxQueued, m_queued.size() + 1);
     }
+    return true;
+}
 
-    if (!m_busy.Set())
+bool DDRChannel::Read(MemAddr address, MemSize size)
+{
+    return QueueRequest(address, size, false);
+}
+
+bool DDRChannel::Write(MemAddr address, MemSize size)
+{
+    return QueueRequest(address, size, true);
+}
+
+bool DDRChannel::HasRowHit(unsigned array, uint64_t row) const
+{
+    for (auto& r : m_queues[array])
     {
-        return false;
+        if (r.row == row)
+        {
+            return true;
+        }
     }
-    return true;
+    return false;
+}
+
+// Select the next request to serve among the queued ones
+DDRChannel::Request* DDRChannel::SelectRequest(CycleNo now, bool draining)
+{
+    Request* best = NULL;
+    unsigned best_rank = 0;
+    for (size_t i = 0; i < m_queues.size(); ++i)
+    {
+        for (auto& r : m_queues[i])
+        {
+            if (r.arrival >= now)
+            {
+                // The scheduler sees requests from the cycle after
+                // they are queued.
+                continue;
+            }
+
+            // Rank the request by type (when draining is enabled),
+            // then by row hit (with FR-FCFS), then by age.
+            unsigned rank = 0;
+            if (m_drainHigh != 0 && r.write != draining) {
+                rank += 2;
+            }
+            if (m_scheduler == SCHED_FRFCFS && m_currentRow[i] != r.row) {
+                rank += 1;
+            }
+
+            if (best == NULL || rank < best_rank || (rank == best_rank && r.seq < best->seq))
+            {
+                best = &r;
+                best_rank = rank;
+            }
+        }
+    }
+    return best;
 }
 
 // Main process for timing the current active request
 Result DDRChannel::DoRequest()
 {
-    assert(m_busy.IsSet());
+    assert(m_queued.size() > 0);
 
     const CycleNo now = GetKernel()->GetActiveClock()->GetCycleNo();
     if (now < m_next_command)
     {
         // Can't continue yet
+        GetKernel()->WaitUntil(m_next_command);
         return SUCCESS;
     }
 
+    Request* request = &m_request;
+    if (!m_active)
+    {
+        // Start draining writes when too many are queued, and stop
+        // when few enough remain.
+        bool draining = m_draining;
+        if (m_drainHigh != 0)
+        {
+            if (!draining && m_numWrites >= m_drainHigh) {
+                draining = true;
+            } else if (draining && m_numWrites <= m_drainLow) {
+                draining = false;
+            }
+        }
+
+        request = SelectRequest(now, draining);
+        if (request == NULL)
+        {
+            // The queued requests have only just arrived
+            return SUCCESS;
+        }
+
+        // Take the request out of its queue
+        COMMIT
+        {
+            const unsigned long current = m_currentRow[request->array];
+            if (current == request->row) {
+                ++m_numRowHits;
+            } else if (current == INVALID_ROW) {
+                ++m_numRowMisses;
+            } else {
+                ++m_numRowConflicts;
+            }
+
+            if (draining && !m_draining) {
+                ++m_numWriteDrains;
+            }
+            m_draining = draining;
+
+            if (request->write) {
+                --m_numWrites;
+            }
+
+            std::vector<Request>& queue = m_queues[request->array];
+            m_request = *request;
+            m_active  = true;
+            queue.erase(queue.begin() + (request - &queue[0]));
+            request = &m_request;
+        }
+    }
+
     // We read from m_nDevicesPerRank devices, each providing m_nBurstLength bytes in the burst.
     const unsigned burst_size = m_ddrconfig.m_nBurstSize;
 
     // Decode the burst address and offset-within-burst
-    const MemAddr      address = (m_request.address + m_request.offset) / m_ddrconfig.m_nDevicesPerRank;
-    const unsigned int offset  = (m_request.address + m_request.offset) % m_ddrconfig.m_nDevicesPerRank;
-    const unsigned int bank    = GET_BITS(address, m_ddrconfig.m_nBankStart, m_ddrconfig.m_nBankBits),
-                       rank    = GET_BITS(address, m_ddrconfig.m_nRankStart, m_ddrconfig.m_nRankBits),
-                       row     = GET_BITS(address, m_ddrconfig.m_nRowStart,  m_ddrconfig.m_nRowBits);
-
-    // Ranks and banks are analogous in this concept; each bank can be invidually pre-charged and activated,
-    // providing an array of rows * columns cells.
-    const unsigned int array  = rank * (1 << m_ddrconfig.m_nBankBits) + bank;
+    const unsigned int offset = (request->address + request->offset) % m_ddrconfig.m_nDevicesPerRank;
+    unsigned int       array;
+    uint64_t           row;
+    DecodeAddress(request->address + request->offset, array, row);
 
     if (m_currentRow[array] != row)
     {
@@ -104,6 +255,13 @@ Result DDRChannel::DoRequest()
             return SUCCESS;
         }
 
+        if (now < m_bankReady[array])
+        {
+            // The bank is still being precharged
+            GetKernel()->WaitUntil(m_bankReady[array]);
+            return SUCCESS;
+        }
+
         // Activate (open) the desired row
         COMMIT
         {
@@ -116,15 +274,15 @@ Result DDRChannel::DoRequest()
     }
 
     // Process a single burst
-    unsigned int remainder = m_request.size - m_request.offset;
+    unsigned int remainder = request->size - request->offset;
     unsigned int size      = std::min(burst_size - offset, remainder);
 
-    if (m_request.write)
+    if (request->write)
     {
         COMMIT
         {
             // Update address to reflect written portion
-            m_request.offset += size;
+            request->offset += size;
 
             m_next_command   = now + m_ddrconfig.m_tCWL;
             m_next_precharge = now + m_ddrconfig.m_tWR;
@@ -141,8 +299,8 @@ Result DDRChannel::DoRequest()
         COMMIT
         {
             // Update address to reflect read portion
-            m_request.offset += size;
-            m_request.done    = now + m_ddrconfig.m_tCL;
+            request->offset += size;
+            request->done    = now + m_ddrconfig.m_tCL;
 
             // Schedule next read
             m_next_command = now + m_ddrconfig.m_tCCD;
@@ -155,7 +313,7 @@ Result DDRChannel::DoRequest()
         }
 
         // We're done with this read; queue it into the pipeline
-        if (!m_pipeline.Push(std::move(m_request)))
+        if (!m_pipeline.Push(*request))
         {
             // The read pipeline should be big enough
             DeadlockWrite("DDR read pipeline full");
@@ -164,9 +322,18 @@ Result DDRChannel::DoRequest()
     }
 
     // We've completed this request
-    if (!m_busy.Clear())
+    m_queued.Remove();
+
+    COMMIT
     {
-        return FAILED;
+        m_active = false;
+
+        if (m_pagePolicy == PAGE_CLOSED && !HasRowHit(array, row))
+        {
+            // Precharge the row now that no queued request needs it
+            m_bankReady[array]  = std::max(m_next_precharge, now) + m_ddrconfig.m_tRP;
+            m_currentRow[array] = INVALID_ROW;
+        }
     }
     return SUCCESS;
 }
@@ -176,17 +343,29 @@ Result DDRChannel::DoPipeline()
     assert(!m_pipeline.Empty());
     const CycleNo  now     = GetKernel()->GetActiveClock()->GetCycleNo();
     const Request& request = m_pipeline.Front();
+
+    // The kernel may have skipped the cycles since we last waited,
+    // up to the completion of the read; they count as busy cycles all
+    // the same.
+    const CycleNo skipped = (m_pipeline_resume != 0) ? std::min(now, request.done) - m_pipeline_resume : 0;
+
     if (now >= request.done)
     {
         // The last burst has completed, send the assembled data back
         assert(!request.write);
-        if (!m_callback->OnReadCompleted())
+        if (!m_callback->OnReadCompleted(request.address))
         {
             return FAILED;
         }
         m_pipeline.Pop();
+        COMMIT{ m_pipeline_resume = 0; }
     }
-    COMMIT{ m_busyCycles++; }
+    else
+    {
+        GetKernel()->WaitUntil(request.done);
+        COMMIT{ m_pipeline_resume = now + 1; }
+    }
+    COMMIT{ m_busyCycles += skipped + 1; }
     return SUCCESS;
 }
 
@@ -229,23 +408,83 @@ DDRChannel::DDRConfig::DDRConfig(const std::string& name, Object& parent, Clock&
 
 DDRChannel::DDRChannel(const std::string& name, Object& parent, Clock& clock)
     : Object(name, parent),
+      m_clock(clock),
       m_ddrconfig("config", *this, clock),
+      m_scheduler(SCHED_FCFS),
+      m_pagePolicy(PAGE_OPEN),
+      m_queueSize(GetConfOpt("QueueSize", size_t, 1)),
+      m_drainHigh(GetConfOpt("WriteDrainHighWatermark", size_t, 0)),
+      m_drainLow(GetConfOpt("WriteDrainLowWatermark", size_t, 0)),
       // Initialize each rank at 'no row selected'
       m_currentRow(1 << (m_ddrconfig.m_nRankBits + m_ddrconfig.m_nBankBits), INVALID_ROW),
+      m_bankReady(m_currentRow.size(), 0),
+      m_queues(m_currentRow.size()),
       m_callback(0),
       m_request(),
+      InitStateVariable(active, false),
+      InitStateVariable(numWrites, 0),
+      InitStateVariable(nextSeq, 0),
+      InitStateVariable(draining, false),
       InitStorage(m_pipeline, clock, m_ddrconfig.m_tCL),
-      InitStorage(m_busy, clock, false),
+      InitStorage(m_queued, clock, m_queueSize),
       InitStateVariable(next_command, 0),
       InitStateVariable(next_precharge, 0),
+      InitStateVariable(pipeline_resume, 0),
       m_traces(),
 
       InitProcess(p_Request, DoRequest),
       InitProcess(p_Pipeline, DoPipeline),
 
-      InitSampleVariable(busyCycles, SVC_CUMULATIVE)
+      InitSampleVariable(busyCycles, SVC_CUMULATIVE),
+      InitSampleVariable(numRequests, SVC_CUMULATIVE),
+      InitSampleVariable(numRowHits, SVC_CUMULATIVE),
+      InitSampleVariable(numRowMisses, SVC_CUMULATIVE),
+      InitSampleVariable(numRowConflicts, SVC_CUMULATIVE),
+      InitSampleVariable(numWriteDrains, SVC_CUMULATIVE),
+      InitSampleVariable(totalQueued, SVC_CUMULATIVE),
+      InitSampleVariable(maxQueued, SVC_WATERMARK, m_queueSize)
 {
+    const std::string scheduler = GetConfOpt("Scheduler", std::string, "FCFS");
+    if (scheduler == "FCFS" || scheduler == "fcfs")
+    {
+        m_scheduler = SCHED_FCFS;
+    }
+    else if (scheduler == "FRFCFS" || scheduler == "frfcfs")
+    {
+        m_scheduler = SCHED_FRFCFS;
+    }
+    else
+    {
+        throw exceptf<InvalidArgumentException>(*this, "Unknown DDR scheduler: %s", scheduler.c_str());
+    }
+
+    const std::string policy = GetConfOpt("PagePolicy", std::string, "open");
+    if (policy == "open" || policy == "OPEN")
+    {
+        m_pagePolicy = PAGE_OPEN;
+    }
+    else if (policy == "closed" || policy == "CLOSED")
+    {
+        m_pagePolicy = PAGE_CLOSED;
+    }
+    else
+    {
+        throw exceptf<InvalidArgumentException>(*this, "Unknown DDR page policy: %s", policy.c_str());
+    }
+
+    if (m_queueSize == 0)
+    {
+        throw InvalidArgumentException(*this, "QueueSize must be at least 1");
+    }
+
+    if (m_drainHigh != 0 && (m_drainLow >= m_drainHigh || m_drainHigh > m_queueSize))
+    {
+        throw InvalidArgumentException(*this, "WriteDrainLowWatermark must be below WriteDrainHighWatermark, which must not exceed QueueSize");
+    }
+
     RegisterStateVariable(m_currentRow, "currentRow");
+    RegisterStateVariable(m_bankReady, "bankReady");
+    RegisterStateObject(m_queues, "queues");
     RegisterStateVariable(m_request.address, "request.address");
     RegisterStateVariable(m_request.write, "request.write");
     RegisterStateVariable(m_request.size, "request.size");
@@ -253,8 +492,12 @@ DDRChannel::DDRChannel(const std::string& name, Object& parent, Clock& clock)
     RegisterStateArray(m_request.data.data, sizeof(m_request.data.data)/sizeof(m_request.data.data[0]), "request.data");
     RegisterStateArray(m_request.data.mask, sizeof(m_request.data.mask)/sizeof(m_request.data.mask[0]), "request.mask");
     RegisterStateVariable(m_request.done, "request.done");
+    RegisterStateVariable(m_request.seq, "request.seq");
+    RegisterStateVariable(m_request.arrival, "request.arrival");
+    RegisterStateVariable(m_request.array, "request.array");
+    RegisterStateVariable(m_request.row, "request.row");
 
-    m_busy.Sensitive(p_Request);
+    m_queued.Sensitive(p_Request);
     m_pipeline.Sensitive(p_Pipeline);
 
     RegisterModelObject(*this, "ddr");
@@ -281,8 +524,8 @@ void DDRChannel::SetClient(ICallback& cb, StorageTraceSet& sts, const StorageTra
     }
     m_callback = &cb;
 
-    sts = m_busy;
-    p_Request.SetStorageTraces(opt(opt(m_pipeline) * m_busy));
+    sts = opt(m_queued);
+    p_Request.SetStorageTraces(opt(opt(m_pipeline) * opt(m_queued)));
     p_Pipeline.SetStorageTraces(opt(storages));
 
     RegisterModelBidiRelation(cb, *this, "ddr");
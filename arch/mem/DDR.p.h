@@ -43,6 +43,16 @@ Note that a row cannot be precharged (closed) until at least tWR (Write
 Recovery) cycles after the last write and at least tRAS (Row Active to
 Precharge Delay) cycles after opening the row.
 
+The channel keeps the requests it has accepted in a queue per bank and
+schedules them one at a time. With the FCFS scheduler, the oldest request
+goes first. With FR-FCFS (first-ready, first-come first-served), requests
+that hit the open row of their bank go before older requests that would
+need a precharge and activate. With the open-page policy, a row is left
+open after an access; with the closed-page policy, it is precharged as
+soon as no other queued request hits it. When write draining is enabled,
+reads go before writes until enough writes are queued, and then writes go
+first until their number drops again.
+
 Each generation of DDR increases the maximum size of the memory device and
 doubled the I/O bus frequency multiplier (and, consequently, the prefetch
 buffer size). Below is an overview of some common DDR modules:
@@ -89,7 +99,11 @@ public:
     class ICallback
     {
     public:
-        virtual bool OnReadCompleted() = 0;
+        // Called when the read of address, as given to Read(), has
+        // completed. The reads complete in the order they are
+        // scheduled, which with FR-FCFS or write draining need not be
+        // the order in which they were queued.
+        virtual bool OnReadCompleted(MemAddr address) = 0;
         virtual ~ICallback() {}
     };
 
@@ -106,9 +120,58 @@ private:
       (unsigned  offset)    ///< Current offset that we're handling
       (bool      write)     ///< A write or read
       (CycleNo   done)      ///< When this request is done
+      (uint64_t  seq)       ///< Order of arrival, for age
+      (CycleNo   arrival)   ///< Cycle in which the request was queued
+      (unsigned  array)     ///< Rank and bank of the request
+      (uint64_t  row)       ///< Row of the request
          ))
     // {% endcall %}
 
+    enum SchedulerPolicy
+    {
+        SCHED_FCFS,     ///< Oldest request first
+        SCHED_FRFCFS,   ///< Oldest row hit first, then oldest request
+    };
+
+    enum PagePolicy
+    {
+        PAGE_OPEN,      ///< Leave the row open after an access
+        PAGE_CLOSED,    ///< Precharge the row when no queued request hits it
+    };
+
+    /*
+     The number of requests in the channel. Arrivals and completions
+     only take effect between cycles, so that both sides see the count
+     of the start of the cycle, and the request process runs while the
+     count is non-zero.
+    */
+    class QueueCount : public SensitiveStorage
+    {
+        const size_t m_maxSize;                   ///< Maximum number of requests
+        DefineStateVariable(size_t, count);       ///< Number of requests at the start of the cycle
+        DefineStateVariable(size_t, arrivals);    ///< Requests added this cycle
+        DefineStateVariable(size_t, departures);  ///< Requests removed this cycle
+
+    protected:
+        void Update() override;
+        friend class TypedStorageBatch<QueueCount>;
+
+    public:
+        // Number of requests at the start of the cycle
+        size_t size() const { return m_count; }
+
+        // Add a request; fails when the channel is full
+        bool Add();
+
+        // Remove a completed request
+        void Remove();
+
+        QueueCount(const std::string& name, Object& parent, Clock& clock, size_t maxSize);
+        QueueCount(const QueueCount&) = delete;
+        QueueCount& operator=(const QueueCount&) = delete;
+        static constexpr const char* NAME_PREFIX = "q_";
+    };
+
     class DDRConfig : public Object {
     public:
         unsigned int m_nBurstLength;    ///< Size of a single burst
@@ -140,14 +203,27 @@ private:
     };
 
     // Runtime parameters
+    Clock&                     m_clock;          ///< Clock of the channel
     DDRConfig                  m_ddrconfig;      ///< DDR virtual chip parameters
+    SchedulerPolicy            m_scheduler;      ///< Order in which queued requests are served
+    PagePolicy                 m_pagePolicy;     ///< When rows are closed
+    size_t                     m_queueSize;      ///< Maximum number of requests in the channel
+    size_t                     m_drainHigh;      ///< Queued writes that start draining (0 to disable)
+    size_t                     m_drainLow;       ///< Queued writes that stop draining
     std::vector<unsigned long> m_currentRow;     ///< Currently selected row, for each rank
+    std::vector<CycleNo>       m_bankReady;      ///< Minimum time for the next activate, for each rank
+    std::vector<std::vector<Request> > m_queues; ///< Queued requests, for each rank
     ICallback*                 m_callback;       ///< The callback to notify for completion
     DefineStateVariable(Request, request);       ///< The current request
+    DefineStateVariable(bool, active);           ///< Whether the current request is valid
+    DefineStateVariable(size_t, numWrites);      ///< Number of queued writes, excluding the current one
+    DefineStateVariable(uint64_t, nextSeq);      ///< Order of arrival of the next request
+    DefineStateVariable(bool, draining);         ///< Whether writes are being drained
     Buffer<Request>            m_pipeline;       ///< Pipelined reads
-    Flag                       m_busy;           ///< Trigger for process
+    QueueCount                 m_queued;         ///< Trigger for process; queued requests, including the current one
     DefineStateVariable(CycleNo, next_command);  ///< Minimum time for next command
     DefineStateVariable(CycleNo, next_precharge);///< Minimum time for next Row Precharge
+    DefineStateVariable(CycleNo, pipeline_resume);///< Cycle after the last wait in the pipeline (0 if none)
     TraceMap                   m_traces;         ///< Active traces
 
     // Processes
@@ -156,7 +232,18 @@ private:
 
     // Statistics
     DefineSampleVariable(CycleNo, busyCycles);
-
+    DefineSampleVariable(uint64_t, numRequests);     ///< Number of requests queued
+    DefineSampleVariable(uint64_t, numRowHits);      ///< Requests that found their row open
+    DefineSampleVariable(uint64_t, numRowMisses);    ///< Requests that found their bank closed
+    DefineSampleVariable(uint64_t, numRowConflicts); ///< Requests that found another row open
+    DefineSampleVariable(uint64_t, numWriteDrains);  ///< Number of times writes started draining
+    DefineSampleVariable(uint64_t, totalQueued);     ///< Sum of the queue occupancy seen by each request
+    DefineSampleVariable(size_t, maxQueued);         ///< Highest queue occupancy
+
+    void     DecodeAddress(MemAddr address, unsigned& array, uint64_t& row) const;
+    bool     QueueRequest(MemAddr address, MemSize size, bool write);
+    Request* SelectRequest(CycleNo now, bool draining);
+    bool     HasRowHit(unsigned array, uint64_t row) const;
     Result DoRequest();
     Result DoPipeline();
 
@@ -1,5 +1,6 @@
 #include <arch/mem/DDRMemory.h>
 #include <sim/config.h>
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstring>
@@ -27,7 +28,7 @@ class DDRMemory::Interface : public Object, public DDRChannel::ICallback
     Buffer<Request>     m_requests;  //< incoming from system, outgoing to memory
     Buffer<Request>     m_responses; //< incoming from memory, outgoing to system
 
-    std::queue<Request> m_activeRequests; //< Requests currently active in DDR
+    std::deque<Request> m_activeRequests; //< Requests currently active in DDR
 
     // Processes
     Process             p_Requests;
@@ -43,11 +44,15 @@ class DDRMemory::Interface : public Object, public DDRChannel::ICallback
 public:
 
     // IMemory
-    bool OnReadCompleted()
+    bool OnReadCompleted(MemAddr address) override
     {
-        assert(!m_activeRequests.empty());
+        // The DDR channel may reorder the reads; those to the same
+        // address complete in order.
+        auto p = std::find_if(m_activeRequests.begin(), m_activeRequests.end(),
+                              [address](const Request& r) { return r.address == address; });
+        assert(p != m_activeRequests.end());
 
-        Request& request = m_activeRequests.front();
+        Request& request = *p;
 
         COMMIT {
             m_memory.Read(request.address, request.data.data, m_lineSize);
@@ -60,7 +65,7 @@ public:
         }
 
         COMMIT {
-            m_activeRequests.pop();
+            m_activeRequests.erase(p);
         }
 
         return true;
@@ -102,7 +107,7 @@ public:
 
             COMMIT{
                 ++m_nreads;
-                m_activeRequests.push(req);
+                m_activeRequests.push_back(req);
             }
         }
         else
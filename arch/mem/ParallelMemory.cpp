@@ -62,6 +62,10 @@ class ParallelMemory::Port : public Object
             m_requests.Pop();
             COMMIT{ m_nextdone = 0; }
         }
+        else
+        {
+            GetKernel()->WaitUntil(m_nextdone);
+        }
         return SUCCESS;
     }
 
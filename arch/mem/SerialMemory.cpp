@@ -137,6 +137,10 @@ Result SerialMemory::DoRequests()
             m_requests.Pop();
             COMMIT{ m_nextdone = 0; }
         }
+        else
+        {
+            GetKernel()->WaitUntil(m_nextdone);
+        }
     }
     else
     {
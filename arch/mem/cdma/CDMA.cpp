@@ -131,6 +131,8 @@ CDMA::CDMA(const std::string& name, Simulator::Object& parent, Clock& clock)
     m_numCachesPerLowRing(GetConf("NumL2CachesPerRing", size_t)),
     m_numClients(0),
     m_lineSize(GetTopConf("CacheLineSize", size_t)),
+    m_numRings(GetConfOpt("NumRings", size_t, 1)),
+    m_bidirectional(GetConfOpt("BidirectionalRings", bool, false)),
     m_caches(),
     m_directories(),
     m_roots(GetConf("NumRootDirectories", size_t), 0),
@@ -139,7 +141,15 @@ CDMA::CDMA(const std::string& name, Simulator::Object& parent, Clock& clock)
     m_clientMap(),
     InitSampleVariable(nreads, SVC_CUMULATIVE), InitSampleVariable(nwrites, SVC_CUMULATIVE), InitSampleVariable(nread_bytes, SVC_CUMULATIVE), InitSampleVariable(nwrite_bytes, SVC_CUMULATIVE)
 {
+    if (m_numRings == 0)
+    {
+        throw InvalidArgumentException(*this, "NumRings must be at least 1");
+    }
 
+    if (m_bidirectional && m_numRings % 2 != 0)
+    {
+        throw InvalidArgumentException(*this, "BidirectionalRings requires an even NumRings");
+    }
 
     // Create the root directories
     if (!IsPowerOfTwo(m_roots.size()))
@@ -154,6 +164,15 @@ CDMA::CDMA(const std::string& name, Simulator::Object& parent, Clock& clock)
 
 }
 
+std::string CDMA::GetRingName(size_t ring, const std::string& name) const
+{
+    if (m_numRings == 1)
+    {
+        return name;
+    }
+    return "ring" + std::to_string(ring) + "." + name;
+}
+
 OneLevelCDMA::OneLevelCDMA(const std::string& name, Simulator::Object& parent, Clock& clock) :
     CDMA(name, parent, clock)
 { };
@@ -316,6 +335,8 @@ void CDMA::Cmd_Info(ostream& out, const vector<string>& arguments) const
     "cache services several processors. Rings of caches are connected via directories\n"
     "to higher-level rings. One or more root directories at the top provide access to\n"
     "to off-chip storage.\n"
+    "Each ring can be made of several parallel rings interleaved by line address\n"
+    "(NumRings), optionally running in alternating directions (BidirectionalRings).\n"
     "\n"
     "Supported operations:\n"
     "- info <component> ranges\n"
@@ -48,6 +48,8 @@ protected:
     size_t                      m_numCachesPerLowRing;
     size_t                      m_numClients;
     size_t                      m_lineSize;
+    size_t                      m_numRings;           ///< Number of parallel rings
+    bool                        m_bidirectional;      ///< Whether the odd rings run backwards
     std::vector<Cache*>         m_caches;             ///< List of caches
     std::vector<Directory*>     m_directories;        ///< List of directories
     std::vector<RootDirectory*> m_roots;              ///< List of root directories
@@ -77,6 +79,16 @@ public:
     const TraceMap& GetTraces() const { return m_traces; }
 
     size_t GetLineSize() const { return m_lineSize; }
+    size_t GetNumRings() const { return m_numRings; }
+
+    // The rings are interleaved by line address, so that all the
+    // messages for a line stay on the same ring and in order.
+    size_t GetRing(MemAddr address) const { return (address / m_lineSize) % m_numRings; }
+    bool IsReversedRing(size_t ring) const { return m_bidirectional && ring % 2 != 0; }
+
+    // Name of a per-ring component of the nodes; only prefixed
+    // with the ring when there is more than one.
+    std::string GetRingName(size_t ring, const std::string& name) const;
     size_t GetNumCaches() const { return m_caches.size(); }
     size_t GetNumDirectories() const { return m_directories.size(); }
     size_t GetNumRootDirectories() const { return m_roots.size(); }
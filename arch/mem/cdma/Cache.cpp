@@ -32,7 +32,8 @@ MCID CDMA::Cache::RegisterClient(IMemoryCallback& callback, Process& process, St
 
     m_storages *= opt(storages);
     p_Requests.SetStorageTraces(m_storages ^ GetOutgoingTrace());
-    p_In.SetStorageTraces(opt(m_storages ^ GetOutgoingTrace()));
+    for (size_t i = 0; i < p_In.size(); ++i)
+        p_In[i]->SetStorageTraces(opt(m_storages ^ GetOutgoingTrace(i)));
 
     return index;
 }
@@ -136,14 +137,11 @@ CDMA::Cache::Line* CDMA::Cache::FindLine(MemAddr address)
     const size_t  set  = setindex * m_assoc;
 
     // Find the line
-    for (size_t i = 0; i < m_assoc; ++i)
+    int way = m_tags.Find(setindex, tag);
+    if (way >= 0)
     {
-        Line& line = m_lines[set + i];
-        if (line.state != LINE_EMPTY && line.tag == tag)
-        {
-            // The wanted line was in the cache
-            return &line;
-        }
+        // The wanted line was in the cache
+        return &m_lines[set + way];
     }
     return NULL;
 }
@@ -158,37 +156,42 @@ CDMA::Cache::Line* CDMA::Cache::AllocateLine(MemAddr address, bool empty_only, M
     const size_t  set  = setindex * m_assoc;
 
     // Find the line
-    Line* empty   = NULL;
-    Line* replace = NULL;
-    for (size_t i = 0; i < m_assoc; ++i)
+    Line* line = NULL;
+    int   way  = m_tags.FindEmpty(setindex);
+    if (way >= 0)
     {
-        Line& line = m_lines[set + i];
-        if (line.state == LINE_EMPTY)
-        {
-            // Empty, unused line, remember this one
-            DeadlockWrite("New line, tag %#016llx: allocating empty line %zu from set %zu", (unsigned long long)tag, i, setindex);
-            empty = &line;
-        }
-        else if (!empty_only)
+        // Empty, unused line
+        DeadlockWrite("New line, tag %#016llx: allocating empty line %d from set %zu", (unsigned long long)tag, way, setindex);
+        line = &m_lines[set + way];
+    }
+    else if (!empty_only)
+    {
+        // We're also considering non-empty lines; let the policy choose
+        assert(m_tags.Find(setindex, tag) < 0);
+        TagArray::WayMask ways = 0;
+        for (size_t i = 0; i < m_assoc; ++i)
         {
-            // We're also considering non-empty lines; use LRU
-            assert(line.tag != tag);
-            DeadlockWrite("New line, tag %#016llx: considering busy line %zu from set %zu, tag %#016llx, state %u, updating %u, access %llu",
+            const Line& l = m_lines[set + i];
+            DeadlockWrite("New line, tag %#016llx: considering busy line %zu from set %zu, tag %#016llx, state %u, updating %u",
                           (unsigned long long)tag,
                           i, setindex,
-                          (unsigned long long)line.tag, (unsigned)line.state, (unsigned)line.updating, (unsigned long long)line.access);
-            if (line.state != LINE_LOADING && line.updating == 0 && (replace == NULL || line.access < replace->access))
+                          (unsigned long long)m_tags.GetTag(set + i), (unsigned)l.state, (unsigned)l.updating);
+            if (l.state != LINE_LOADING && l.updating == 0)
             {
-                // The line is available to be replaced and has a lower LRU rating,
-                // remember it for replacing
-                replace = &line;
+                // The line is available to be replaced
+                ways |= (TagArray::WayMask)1 << i;
             }
         }
+
+        way = m_replacement->FindVictim(setindex, ways);
+        if (way >= 0)
+        {
+            line = &m_lines[set + way];
+        }
     }
 
-    // The line could not be found, allocate the empty line or replace an existing line
     if (ptag) *ptag = tag;
-    return (empty != NULL) ? empty : replace;
+    return line;
 }
 
 bool CDMA::Cache::EvictLine(Line* line, const Request& req)
@@ -198,7 +201,7 @@ bool CDMA::Cache::EvictLine(Line* line, const Request& req)
     assert(line->updating == 0);
 
     size_t setindex = (line - &m_lines[0]) / m_assoc;
-    MemAddr address = m_selector->Unmap(line->tag, setindex) * m_lineSize;
+    MemAddr address = m_selector->Unmap(m_tags.GetTag(line - &m_lines[0]), setindex) * m_lineSize;
 
     TraceWrite(address, "Evicting with %u tokens due to miss for address %#016llx", line->tokens, (unsigned long long)req.address);
 
@@ -215,7 +218,7 @@ bool CDMA::Cache::EvictLine(Line* line, const Request& req)
         std::copy(line->data, line->data + m_lineSize, msg->data.data);
     }
 
-    if (!SendMessage(msg, MINSPACE_INSERTION))
+    if (!SendMessage(msg, address, MINSPACE_INSERTION))
     {
         DeadlockWrite("Unable to buffer eviction request for next node");
         return false;
@@ -237,7 +240,11 @@ bool CDMA::Cache::EvictLine(Line* line, const Request& req)
         }
     }
 
-    COMMIT{ line->state = LINE_EMPTY; }
+    COMMIT{
+        line->state = LINE_EMPTY;
+        m_tags.SetUsed(line - &m_lines[0], false);
+        m_replacement->Evict(line - &m_lines[0]);
+    }
     return true;
 }
 
@@ -294,8 +301,8 @@ bool CDMA::Cache::OnMessageReceived(Message* msg)
 
                     line->tokens -= msg->tokens;
 
-                    // Also update last access time.
-                    line->access = GetKernel()->GetCycleNo();
+                    // Also update the replacement information.
+                    m_replacement->Access(line - &m_lines[0]);
                 }
             }
             else if (msg->type == Message::REQUEST)
@@ -346,7 +353,7 @@ bool CDMA::Cache::OnMessageReceived(Message* msg)
 
             // Store the data, masked by the already-valid bitmask
             line::blitnot(line->data, msg->data.data, line->valid, m_lineSize);
-            line::setifnot(line->valid, true, line->valid, m_lineSize);
+            line->valid = line::range(0, m_lineSize);
 
             line->state  = LINE_FULL;
             line->tokens = msg->tokens;
@@ -427,12 +434,13 @@ bool CDMA::Cache::OnMessageReceived(Message* msg)
                 COMMIT
                 {
                     line->state    = LINE_FULL;
-                    line->tag      = tag;
                     line->tokens   = msg->tokens;
                     line->dirty    = msg->dirty;
                     line->updating = 0;
-                    line->access   = GetKernel()->GetCycleNo();
-                    std::fill(line->valid, line->valid + m_lineSize, true);
+                    m_tags.SetTag(line - &m_lines[0], tag);
+                    m_tags.SetUsed(line - &m_lines[0], true);
+                    m_replacement->Fill(line - &m_lines[0]);
+                    line->valid    = line::range(0, m_lineSize);
                     std::copy(msg->data.data, msg->data.data + m_lineSize, line->data);
 
                     delete msg;
@@ -486,7 +494,7 @@ bool CDMA::Cache::OnMessageReceived(Message* msg)
                 COMMIT
                 {
                     line::blit(line->data, msg->data.data, msg->data.mask, m_lineSize);
-                    line::setif(line->valid, true, msg->data.mask, m_lineSize);
+                    line->valid |= line::pack(msg->data.mask, m_lineSize);
 
                     // Statistics
                     ++m_numNetworkWHits;
@@ -576,7 +584,7 @@ Result CDMA::Cache::OnWriteRequest(const Request& req)
         {
             // We're overwriting another line, evict the old line
             TraceWrite(req.address, "Processing Bus Write Request: Miss; Evicting line with tag %#016llx",
-                       (unsigned long long)line->tag);
+                       (unsigned long long)m_tags.GetTag(line - &m_lines[0]));
 
             if (!EvictLine(line, req))
             {
@@ -595,11 +603,13 @@ Result CDMA::Cache::OnWriteRequest(const Request& req)
         COMMIT
         {
             line->state    = LINE_LOADING;
-            line->tag      = tag;
             line->tokens   = 0;
             line->dirty    = false;
             line->updating = 0;
-            std::fill(line->valid, line->valid + m_lineSize, false);
+            line->valid    = 0;
+            m_tags.SetTag(line - &m_lines[0], tag);
+            m_tags.SetUsed(line - &m_lines[0], true);
+            m_replacement->Fill(line - &m_lines[0]);
         }
 
         // Send a request out for the cache-line
@@ -615,7 +625,7 @@ Result CDMA::Cache::OnWriteRequest(const Request& req)
 
         }
 
-        if (!SendMessage(msg, MINSPACE_INSERTION))
+        if (!SendMessage(msg, req.address, MINSPACE_INSERTION))
         {
             ++m_numStallingWLoads;
             DeadlockWrite("Unable to buffer read request for next node");
@@ -668,7 +678,7 @@ Result CDMA::Cache::OnWriteRequest(const Request& req)
             line->updating++;
         }
 
-        if (!SendMessage(msg, MINSPACE_INSERTION))
+        if (!SendMessage(msg, req.address, MINSPACE_INSERTION))
         {
             ++m_numStallingWUpdates;
             DeadlockWrite("Unable to buffer update request for next node");
@@ -689,13 +699,13 @@ Result CDMA::Cache::OnWriteRequest(const Request& req)
     COMMIT
     {
         line::blit(line->data, req.mdata.data, req.mdata.mask, m_lineSize);
-        line::setif(line->valid, true, req.mdata.mask, m_lineSize);
+        line->valid |= line::pack(req.mdata.mask, m_lineSize);
 
         // The line is now dirty
         line->dirty = true;
 
-        // Also update last access time.
-        line->access = GetKernel()->GetCycleNo();
+        // Also update the replacement information.
+        m_replacement->Access(line - &m_lines[0]);
     }
     return SUCCESS;
 }
@@ -730,7 +740,7 @@ Result CDMA::Cache::OnReadRequest(const Request& req)
         {
             // We're overwriting another line, evict the old line
             TraceWrite(req.address, "Processing Bus Read Request: Miss; Evicting line with tag %#016llx",
-                       (unsigned long long)line->tag);
+                       (unsigned long long)m_tags.GetTag(line - &m_lines[0]));
 
             if (!EvictLine(line, req))
             {
@@ -749,12 +759,13 @@ Result CDMA::Cache::OnReadRequest(const Request& req)
         COMMIT
         {
             line->state    = LINE_LOADING;
-            line->tag      = tag;
             line->tokens   = 0;
             line->dirty    = false;
             line->updating = 0;
-            line->access   = GetKernel()->GetCycleNo();
-            std::fill(line->valid, line->valid + m_lineSize, false);
+            line->valid    = 0;
+            m_tags.SetTag(line - &m_lines[0], tag);
+            m_tags.SetUsed(line - &m_lines[0], true);
+            m_replacement->Fill(line - &m_lines[0]);
         }
 
         // Send a request out
@@ -769,7 +780,7 @@ Result CDMA::Cache::OnReadRequest(const Request& req)
             msg->sender    = GetNodeID();
         }
 
-        if (!SendMessage(msg, MINSPACE_INSERTION))
+        if (!SendMessage(msg, req.address, MINSPACE_INSERTION))
         {
             ++m_numStallingRLoads;
             DeadlockWrite("Unable to buffer read request for next node");
@@ -793,8 +804,8 @@ Result CDMA::Cache::OnReadRequest(const Request& req)
         {
             std::copy(line->data, line->data + m_lineSize, data);
 
-            // Update LRU information
-            line->access = GetKernel()->GetCycleNo();
+            // Update the replacement information
+            m_replacement->Access(line - &m_lines[0]);
 
             ++m_numRFullHits;
         }
@@ -842,18 +853,19 @@ Result CDMA::Cache::DoRequests()
     return (result == FAILED) ? FAILED : SUCCESS;
 }
 
-Result CDMA::Cache::DoReceive()
+Result CDMA::Cache::DoReceive(size_t ring)
 {
     // Handle received message from prev
-    assert(!m_incoming.Empty());
+    Buffer<Message*>& incoming = GetIncoming(ring);
+    assert(!incoming.Empty());
 
     COMMIT{ ++m_numReceivedMessages; }
 
-    if (!OnMessageReceived(m_incoming.Front()))
+    if (!OnMessageReceived(incoming.Front()))
     {
         return FAILED;
     }
-    m_incoming.Pop();
+    incoming.Pop();
     return SUCCESS;
 }
 
@@ -875,7 +887,9 @@ CDMA::Cache::Cache(const std::string& name, CDMA& parent, Clock& clock, NodeID i
     m_storages (),
     p_lines    (clock, GetName() + ".p_lines"),
     m_lines    (m_assoc * m_sets),
-    m_data     (m_lines.size() * m_lineSize),
+    m_data     (GetKernel()->GetArena().Allocate<char>(m_lines.size() * m_lineSize)),
+    m_tags     (),
+    m_replacement(NULL),
 
     InitSampleVariable(numRAccesses, SVC_CUMULATIVE),
     InitSampleVariable(numHardRConflicts, SVC_CUMULATIVE),
@@ -911,40 +925,44 @@ CDMA::Cache::Cache(const std::string& name, CDMA& parent, Clock& clock, NodeID i
     InitSampleVariable(numStallingWSnoops, SVC_CUMULATIVE),
 
     InitProcess(p_Requests, DoRequests),
-    InitProcess(p_In, DoReceive),
+    p_In       (CreateReceivers<Cache, &Cache::DoReceive>(*this, "p_In")),
     p_bus      (clock, GetName() + ".p_bus"),
     InitBuffer(m_requests, clock, "RequestBufferSize"),
     InitBuffer(m_responses, clock, "ResponseBufferSize")
 {
 
-    RegisterStateVariable(m_data, "data");
+    RegisterStateArray(m_data, m_lines.size() * m_lineSize, "data");
+    m_tags.Initialize(*this, m_sets, m_assoc);
+    m_replacement = IReplacementPolicy::makePolicy(*this, GetConfOpt("Replacement", string, "LRU"), m_sets, m_assoc);
+
     // Create the cache lines
     for (size_t i = 0; i < m_lines.size(); ++i)
     {
         Line& line = m_lines[i];
         line.state = LINE_EMPTY;
         line.data  = &m_data[i * m_lineSize];
+        line.valid = 0;
         auto ln = "line" + to_string(i);
         RegisterStateVariable(line.state, ln + ".state");
-        RegisterStateVariable(line.tag, ln + ".tag");
-        RegisterStateVariable(line.access, ln + ".access");
         RegisterStateVariable(line.tokens, ln + ".tokens");
         RegisterStateVariable(line.dirty, ln + ".dirty");
         RegisterStateVariable(line.updating, ln + ".updating");
-        RegisterStateArray(line.valid, sizeof(line.valid)/sizeof(line.valid[0]), ln + ".valid");
+        RegisterStateVariable(line.valid, ln + ".valid");
     }
 
     m_requests.Sensitive(p_Requests);
-    m_incoming.Sensitive(p_In);
 
-    p_lines.AddProcess(p_In);
+    for (auto p : p_In)
+        p_lines.AddProcess(*p);
     p_lines.AddProcess(p_Requests);
 
-    p_bus.AddPriorityProcess(p_In);                   // Update triggers write completion
+    for (auto p : p_In)
+        p_bus.AddPriorityProcess(*p);                 // Update triggers write completion
     p_bus.AddPriorityProcess(p_Requests);             // Read or write hit
 
     RegisterModelObject(*this, "cache");
     RegisterModelProperty(*this, "selector", m_selector->GetName());
+    RegisterModelProperty(*this, "replacement", m_replacement->GetName());
     RegisterModelProperty(*this, "assoc", (uint32_t)m_assoc);
     RegisterModelProperty(*this, "sets", (uint32_t)m_sets);
     RegisterModelProperty(*this, "lsz", (uint32_t)m_lineSize);
@@ -953,6 +971,9 @@ CDMA::Cache::Cache(const std::string& name, CDMA& parent, Clock& clock, NodeID i
 
 CDMA::Cache::~Cache()
 {
+    for (auto p : p_In)
+        delete p;
+    delete m_replacement;
     delete m_selector;
 }
 
@@ -1006,6 +1027,7 @@ void CDMA::Cache::Cmd_Read(std::ostream& out, const std::vector<std::string>& ar
         }
 
         out << "L2 bank mapping:  " << m_selector->GetName() << endl
+            << "Replacement:      " << m_replacement->GetName() << endl
             << "Cache size:       " << dec << (m_lineSize * m_lines.size()) << " bytes" << endl
             << "Cache line size:  " << dec << m_lineSize << " bytes" << endl
             << endl;
@@ -1212,7 +1234,7 @@ void CDMA::Cache::Cmd_Read(std::ostream& out, const std::vector<std::string>& ar
         {
             const size_t set = i / m_assoc;
             const Line& line = m_lines[i];
-            MemAddr lineaddr = m_selector->Unmap(line.tag, set) * m_lineSize;
+            MemAddr lineaddr = m_selector->Unmap(m_tags.GetTag(i), set) * m_lineSize;
             if (specific && lineaddr != seladdr)
                 continue;
 
@@ -1238,7 +1260,7 @@ void CDMA::Cache::Cmd_Read(std::ostream& out, const std::vector<std::string>& ar
                         if ((fmt == fmt_bytes) || ((fmt == fmt_words) && (x % sizeof(Integer) == 0)))
                             out << " ";
 
-                        if (line.valid[x]) {
+                        if (line::test(line.valid, x)) {
                             char byte = line.data[x];
                             if (fmt == fmt_chars)
                                 out << (isprint(byte) ? byte : '.');
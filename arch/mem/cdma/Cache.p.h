@@ -5,6 +5,8 @@
 #include <arch/mem/cdma/Node.h>
 #include <sim/inspect.h>
 #include <arch/BankSelector.h>
+#include <arch/TagArray.h>
+#include <arch/ReplacementPolicy.h>
 
 #include <queue>
 #include <set>
@@ -27,13 +29,11 @@ public:
     struct Line
     {
         LineState    state;     ///< State of the line
-        MemAddr      tag;       ///< Tag of the line
         char*        data;      ///< Data of the line
-        CycleNo      access;    ///< Last access time (for LRU replacement)
         unsigned int tokens;    ///< Number of tokens in this line
         bool         dirty;     ///< Dirty: line has been written to
         unsigned int updating;  ///< Number of REQUEST_UPDATEs pending on this line
-        bool         valid[MAX_MEMORY_OPERATION_SIZE]; ///< Validity bitmask
+        line::Mask   valid;     ///< Validity bitmask
     };
 
 private:
@@ -58,7 +58,9 @@ private:
     StorageTraceSet               m_storages;
     ArbitratedService<>           p_lines;
     std::vector<Line>             m_lines;
-    std::vector<char>             m_data;
+    char*                         m_data;     ///< The data in the cache lines, in the arena
+    TagArray                      m_tags;     ///< The tags of the cache lines
+    IReplacementPolicy*           m_replacement; ///< Choice of the lines to replace
 
     // Statistics
 
@@ -105,8 +107,8 @@ private:
     DefineSampleVariable(uint64_t, numStallingWSnoops);
 
     // Processes
-    Process p_Requests;
-    Process p_In;
+    Process               p_Requests;
+    std::vector<Process*> p_In;  ///< One per ring
 
     // Incoming requests from the processors
     // First arbitrate, then buffer (models a bus)
@@ -120,7 +122,7 @@ private:
 
     // Processes
     Result DoRequests();
-    Result DoReceive();
+    Result DoReceive(size_t ring);
 
     Result OnReadRequest(const Request& req);
     Result OnWriteRequest(const Request& req);
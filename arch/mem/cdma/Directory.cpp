@@ -49,8 +49,10 @@ size_t* CDMA::Directory::FindLine(MemAddr address)
     return &linei->second;
 }
 
-// Marks the specified address as present in the directory
-static size_t pseudoline;
+// Marks the specified address as present in the directory. Outside
+// of the commit phase, the line is a placeholder; it is per host
+// thread since concurrent simulations write to it.
+static thread_local size_t pseudoline;
 size_t* CDMA::Directory::AllocateLine(MemAddr address)
 {
     size_t *line = &pseudoline;
@@ -201,27 +203,29 @@ bool CDMA::Directory::OnMessageReceivedTop(Message* msg)
     return true;
 }
 
-Result CDMA::Directory::DoInBottom()
+Result CDMA::Directory::DoInBottom(size_t ring)
 {
     // Handle incoming message on bottom ring from previous node
-    assert(!m_bottom.m_incoming.Empty());
-    if (!OnMessageReceivedBottom(m_bottom.m_incoming.Front()))
+    Buffer<Message*>& incoming = m_bottom.GetIncoming(ring);
+    assert(!incoming.Empty());
+    if (!OnMessageReceivedBottom(incoming.Front()))
     {
         return FAILED;
     }
-    m_bottom.m_incoming.Pop();
+    incoming.Pop();
     return SUCCESS;
 }
 
-Result CDMA::Directory::DoInTop()
+Result CDMA::Directory::DoInTop(size_t ring)
 {
     // Handle incoming message on top ring from previous node
-    assert(!m_top.m_incoming.Empty());
-    if (!OnMessageReceivedTop(m_top.m_incoming.Front()))
+    Buffer<Message*>& incoming = m_top.GetIncoming(ring);
+    assert(!incoming.Empty());
+    if (!OnMessageReceivedTop(incoming.Front()))
     {
         return FAILED;
     }
-    m_top.m_incoming.Pop();
+    incoming.Pop();
     return SUCCESS;
 }
 
@@ -235,18 +239,17 @@ CDMA::Directory::Directory(const std::string& name, CDMA& parent, Clock& clock)
     m_maxNumLines(0),
     m_firstNode (-1),
     m_lastNode  (-1),
-    InitProcess(p_InBottom, DoInBottom),
-    InitProcess(p_InTop, DoInTop)
+    p_InBottom  (m_bottom.CreateReceivers<Directory, &Directory::DoInBottom>(*this, "p_InBottom")),
+    p_InTop     (m_top.CreateReceivers<Directory, &Directory::DoInTop>(*this, "p_InTop"))
 {
+    for (size_t i = 0; i < p_InTop.size(); ++i)
+    {
+        p_lines.AddProcess(*p_InTop[i]);
+        p_lines.AddProcess(*p_InBottom[i]);
 
-    m_bottom.m_incoming.Sensitive(p_InBottom);
-    m_top.m_incoming.Sensitive(p_InTop);
-
-    p_lines.AddProcess(p_InTop);
-    p_lines.AddProcess(p_InBottom);
-
-    p_InBottom.SetStorageTraces(m_top.GetOutgoingTrace());
-    p_InTop.SetStorageTraces((m_top.GetOutgoingTrace() * opt(m_bottom.GetOutgoingTrace())) ^ m_bottom.GetOutgoingTrace());
+        p_InBottom[i]->SetStorageTraces(m_top.GetOutgoingTrace(i));
+        p_InTop[i]->SetStorageTraces((m_top.GetOutgoingTrace(i) * opt(m_bottom.GetOutgoingTrace(i))) ^ m_bottom.GetOutgoingTrace(i));
+    }
 
     RegisterModelObject(m_top, "dt");
     RegisterModelProperty(m_top, "freq", clock.GetFrequency());
@@ -256,6 +259,14 @@ CDMA::Directory::Directory(const std::string& name, CDMA& parent, Clock& clock)
     RegisterModelBidiRelation(m_bottom, m_top, "dir");
 }
 
+CDMA::Directory::~Directory()
+{
+    for (auto p : p_InBottom)
+        delete p;
+    for (auto p : p_InTop)
+        delete p;
+}
+
 void CDMA::Directory::ConnectRing(Node* first, Node* last)
 {
     m_bottom.Connect(last, first);
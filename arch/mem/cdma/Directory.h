@@ -54,9 +54,9 @@ private:
     NodeID              m_firstNode;  ///< ID of first node in the subring
     NodeID              m_lastNode;   ///< ID of last node in the subring
 
-    // Processes
-    Process p_InBottom;
-    Process p_InTop;
+    // Processes, one per ring
+    std::vector<Process*> p_InBottom;
+    std::vector<Process*> p_InTop;
 
     size_t* FindLine(MemAddr address);
     size_t* AllocateLine(MemAddr address);
@@ -65,13 +65,16 @@ private:
     bool  IsBelow(NodeID id) const;
 
     // Processes
-    Result DoInBottom();
+    Result DoInBottom(size_t ring);
     Result DoOutBottom();
-    Result DoInTop();
+    Result DoInTop(size_t ring);
     Result DoOutTop();
 
 public:
     Directory(const std::string& name, CDMA& parent, Clock& clock);
+    Directory(const Directory&) = delete;
+    Directory& operator=(const Directory&) = delete;
+    ~Directory();
 
     // Connect directory to caches
     void ConnectRing(Node* first, Node* last);
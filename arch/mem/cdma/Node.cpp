@@ -1,5 +1,6 @@
 #include "Node.h"
 #include <sim/config.h>
+#include <sim/sampling.h>
 
 #include <sstream>
 #include <iostream>
@@ -10,36 +11,10 @@ using namespace std;
 namespace Simulator
 {
 
-// Memory management data
-/*static*/ unsigned long                   CDMA::Node::g_References   = 0;
-/*static*/ CDMA::Node::Message*            CDMA::Node::g_FreeMessages = NULL;
-/*static*/ std::list<CDMA::Node::Message*> CDMA::Node::g_Messages;
-
 /*static*/ void* CDMA::Node::Message::operator new(size_t size)
 {
-    // We allocate this many messages at once
-    constexpr size_t ALLOCATE_SIZE = 1024;
-
     assert(size == sizeof(Message));
-    if (g_FreeMessages == NULL)
-    {
-        // Allocate more messages
-        Message* msg = new Message[ALLOCATE_SIZE];
-        g_Messages.push_back(msg);
-
-        // Link the new messages into the free list
-        for (size_t i = 0; i < ALLOCATE_SIZE; ++i, ++msg)
-        {
-            msg->next = g_FreeMessages;
-            g_FreeMessages = msg;
-        }
-    }
-    assert(g_FreeMessages != NULL);
-
-    // Grab a message off the free list
-    Message* msg = g_FreeMessages;
-    g_FreeMessages = msg->next;
-    return msg;
+    return MessagePool::Allocate();
 }
 
 /*static*/ void CDMA::Node::Message::operator delete(void *p, size_t size)
@@ -53,8 +28,7 @@ namespace Simulator
 #endif
 
     // Append the message to the free list
-    msg->next = g_FreeMessages;
-    g_FreeMessages = msg;
+    MessagePool::Free(msg);
 }
 
 string CDMA::Node::Message::str() const
@@ -109,8 +83,11 @@ string CDMA::Node::Message::str() const
 
 void CDMA::Node::Print(std::ostream& out) const
 {
-    Print(out, "incoming", m_incoming);
-    Print(out, "outgoing", m_outgoing);
+    for (size_t i = 0; i < m_rings.size(); ++i)
+    {
+        Print(out, m_parent.GetRingName(i, "incoming"), *m_rings[i].incoming);
+        Print(out, m_parent.GetRingName(i, "outgoing"), *m_rings[i].outgoing);
+    }
 }
 
 size_t CDMA::Node::GetNumLines() const
@@ -118,35 +95,63 @@ size_t CDMA::Node::GetNumLines() const
     return 0;
 }
 
+StorageTraceSet CDMA::Node::GetOutgoingTrace() const
+{
+    StorageTraceSet res;
+    for (auto& r : m_rings)
+        res ^= *r.outgoing;
+    return res;
+}
+
 void CDMA::Node::Connect(Node* next, Node* prev)
 {
-    m_prev = prev;
-    m_next = next;
-    p_Forward.SetStorageTraces(next->m_incoming);
+    for (size_t i = 0; i < m_rings.size(); ++i)
+    {
+        Ring& r = m_rings[i];
+        if (m_parent.IsReversedRing(i))
+        {
+            // This ring runs in the opposite direction
+            std::swap(next, prev);
+        }
+        r.prev = prev;
+        r.next = next;
+        r.p_Forward->SetStorageTraces(*next->m_rings[i].incoming);
+        if (m_parent.IsReversedRing(i))
+        {
+            std::swap(next, prev);
+        }
+    }
 }
 
-Result CDMA::Node::DoForward()
+Result CDMA::Node::DoForward(size_t ring)
 {
     // Forward requests to the next node
-    assert(!m_outgoing.Empty());
-    assert(m_next != NULL);
+    Ring& r = m_rings[ring];
+    assert(!r.outgoing->Empty());
+    assert(r.next != NULL);
 
-    TraceWrite(m_outgoing.Front()->address, "Sending %s to %s", m_outgoing.Front()->str().c_str(), m_next->GetName().c_str());
+    TraceWrite(r.outgoing->Front()->address, "Sending %s to %s", r.outgoing->Front()->str().c_str(), r.next->GetName().c_str());
 
-    if (!m_next->m_incoming.Push( m_outgoing.Front() ))
+    if (!r.next->m_rings[ring].incoming->Push( r.outgoing->Front() ))
     {
-        DeadlockWrite("Unable to send request to next node (%s)", m_next->GetName().c_str());
+        DeadlockWrite("Unable to send request to next node (%s)", r.next->GetName().c_str());
         return FAILED;
     }
-    m_outgoing.Pop();
+    r.outgoing->Pop();
+    COMMIT{ ++r.nforwarded; }
     return SUCCESS;
 }
 
-// Send a message to the next node.
+// Send a message to the next node on the ring of its address.
 // Only succeeds if there's min_space left before the push.
 bool CDMA::Node::SendMessage(Message* message, size_t min_space)
 {
-    if (!m_outgoing.Push(message, min_space))
+    return SendMessage(message, message->address, min_space);
+}
+
+bool CDMA::Node::SendMessage(Message* message, MemAddr address, size_t min_space)
+{
+    if (!m_rings[m_parent.GetRing(address)].outgoing->Push(message, min_space))
     {
         return false;
     }
@@ -157,29 +162,35 @@ CDMA::Node::Node(const std::string& name, CDMA& parent, Clock& clock, NodeID id)
     : Simulator::Object(name, parent),
       CDMA::Object(name, parent),
       m_id(id),
-      m_prev(NULL),
-      m_next(NULL),
-      InitBuffer(m_incoming, clock, "NodeBufferSize"),
-      InitBuffer(m_outgoing, clock, "NodeBufferSize"),
-      InitProcess(p_Forward, DoForward)
+      m_rings(parent.GetNumRings())
 {
-    g_References++;
+    MessagePool::AddUser();
 
-    m_outgoing.Sensitive(p_Forward);
+    const BufferSize size = GetConf("NodeBufferSize", BufferSize);
+    for (size_t i = 0; i < m_rings.size(); ++i)
+    {
+        Ring& r = m_rings[i];
+        r.prev       = NULL;
+        r.next       = NULL;
+        r.incoming   = new Buffer<Message*>(parent.GetRingName(i, "b_incoming"), *this, clock, size);
+        r.outgoing   = new Buffer<Message*>(parent.GetRingName(i, "b_outgoing"), *this, clock, size);
+        r.p_Forward  = new Process(*this, parent.GetRingName(i, "p_Forward"),
+                                   closure<Result>::adapter<Result>::capture<size_t>::create<Node, &Node::DoForward>(*this, i));
+        r.nforwarded = 0;
+        r.outgoing->Sensitive(*r.p_Forward);
+        RegisterSampleVariableInObjectWithName(r.nforwarded, parent.GetRingName(i, "nforwarded"), SVC_CUMULATIVE);
+    }
 }
 
 CDMA::Node::~Node()
 {
-    assert(g_References > 0);
-    if (--g_References == 0)
+    for (auto& r : m_rings)
     {
-        // Clean up the allocated messages
-        for (std::list<Message*>::const_iterator p = g_Messages.begin(); p != g_Messages.end(); ++p)
-        {
-            delete[] *p;
-        }
-        g_Messages.clear();
+        delete r.p_Forward;
+        delete r.outgoing;
+        delete r.incoming;
     }
+    MessagePool::RemoveUser();
 }
 
 }
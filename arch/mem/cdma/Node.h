@@ -3,6 +3,8 @@
 #define CDMA_NODE_H
 
 #include "CDMA.h"
+#include <sim/delegate_closure.h>
+#include <sim/freelist.h>
 
 namespace Simulator
 {
@@ -77,31 +79,62 @@ protected:
     };
 
 private:
-    // Message management
-    static Message*            g_FreeMessages;
-    static std::list<Message*> g_Messages;
-    static unsigned long       g_References;
+    // Message management. The messages come from a pool shared by
+    // the systems of the process; the nodes are its users, so that
+    // the messages are released when the last ring goes away.
+    typedef FreeList<Message> MessagePool;
+
+    /// The interface of the node on one of the parallel rings
+    struct Ring
+    {
+        Node*             prev;       ///< Prev node on this ring
+        Node*             next;       ///< Next node on this ring
+        Buffer<Message*>* incoming;   ///< Buffer for incoming messages from the prev node
+        Buffer<Message*>* outgoing;   ///< Buffer for outgoing messages to the next node
+        Process*          p_Forward;  ///< Process for sending to the next node
+        uint64_t          nforwarded; ///< Messages sent to the next node
+    };
 
     NodeID            m_id;             ///< Node identifier in the memory network
-    Node*             m_prev;           ///< Prev node in the ring
-    Node*             m_next;           ///< Next node in the ring
-protected:
-    Buffer<Message*>  m_incoming;       ///< Buffer for incoming messages from the prev node
-private:
-    Buffer<Message*>  m_outgoing;       ///< Buffer for outgoing messages to the next node
+    std::vector<Ring> m_rings;          ///< The node on each ring
 
-    /// Process for sending to the next node
-    Process           p_Forward;
-    Result            DoForward();
+    Result DoForward(size_t ring);
 
 protected:
-    StorageTraceSet GetOutgoingTrace() const {
-        return m_outgoing;
+    /// Buffer for incoming messages on a ring from the prev node
+    Buffer<Message*>& GetIncoming(size_t ring) const { return *m_rings[ring].incoming; }
+
+    StorageTraceSet GetOutgoingTrace(size_t ring) const {
+        return *m_rings[ring].outgoing;
     }
 
-    /// Send the message to the next node
+    /// The outgoing buffers of all rings, for processes that send
+    /// messages for any address.
+    StorageTraceSet GetOutgoingTrace() const;
+
+    /// Creates a process for each ring in owner that handles the
+    /// incoming messages of the ring with Method(ring).
+    template<typename T, Result (T::*Method)(size_t)>
+    std::vector<Process*> CreateReceivers(T& owner, const std::string& name) const
+    {
+        std::vector<Process*> procs;
+        for (size_t i = 0; i < m_rings.size(); ++i)
+        {
+            Process* p = new Process(owner, m_parent.GetRingName(i, name),
+                                     closure<Result>::adapter<Result>::capture<size_t>::create<T, Method>(owner, i));
+            m_rings[i].incoming->Sensitive(*p);
+            procs.push_back(p);
+        }
+        return procs;
+    }
+
+    /// Send the message to the next node on the ring of its address
     bool SendMessage(Message* message, size_t min_space);
 
+    /// Send a new message for the address to the next node; the
+    /// message is only allocated in the commit phase.
+    bool SendMessage(Message* message, MemAddr address, size_t min_space);
+
     /// Print a message queue
     static void Print(std::ostream& out, const std::string& name, const Buffer<Message*>& buffer);
 
@@ -114,9 +147,10 @@ protected:
     Node& operator=(const Node&) = delete;
     virtual ~Node();
 
-    /// For iterating during directory initialization
-    Node* GetNextNode() const { return m_next; }
-    Node* GetPrevNode() const { return m_prev; }
+    /// For iterating during directory initialization. These follow
+    /// the first ring, which always runs in the forward direction.
+    Node* GetNextNode() const { return m_rings[0].next; }
+    Node* GetPrevNode() const { return m_rings[0].prev; }
     NodeID GetNodeID() const { return m_id; }
 
 public:
@@ -2,6 +2,7 @@
 #include <arch/mem/DDR.h>
 #include <sim/config.h>
 
+#include <algorithm>
 #include <iomanip>
 using namespace std;
 
@@ -22,7 +23,9 @@ CDMA::RootDirectory::Line* CDMA::RootDirectory::FindLine(MemAddr address)
     return &linei->second;
 }
 
-static
+// Placeholder returned outside of the commit phase. Per host thread,
+// since concurrent simulations write to it.
+static thread_local
 CDMA::RootDirectory::Line pseudoline = { CDMA::RootDirectory::LINE_EMPTY, 0, (size_t)-1 };
 
 CDMA::RootDirectory::Line* CDMA::RootDirectory::AllocateLine(MemAddr address)
@@ -39,11 +42,15 @@ CDMA::RootDirectory::Line* CDMA::RootDirectory::AllocateLine(MemAddr address)
     return line;
 }
 
-bool CDMA::RootDirectory::OnReadCompleted()
+bool CDMA::RootDirectory::OnReadCompleted(MemAddr address)
 {
-    assert (!m_active.empty());
+    // The DDR channel may reorder the reads; those to the same
+    // address complete in order.
+    auto p = std::find_if(m_active.begin(), m_active.end(),
+                          [address](const std::pair<MemAddr, Message*>& a) { return a.first == address; });
+    assert(p != m_active.end());
 
-    Message* msg = m_active.front();
+    Message* msg = p->second;
     COMMIT
     {
         msg->type = Message::REQUEST_DATA_TOKEN;
@@ -51,7 +58,7 @@ bool CDMA::RootDirectory::OnReadCompleted()
 
         static_cast<VirtualMemory&>(m_parent).Read(msg->address, msg->data.data, m_lineSize);
 
-        m_active.pop();
+        m_active.erase(p);
     }
 
     if (!m_responses.Push(msg))
@@ -235,15 +242,16 @@ bool CDMA::RootDirectory::OnMessageReceived(Message* msg)
     return true;
 }
 
-Result CDMA::RootDirectory::DoIncoming()
+Result CDMA::RootDirectory::DoIncoming(size_t ring)
 {
     // Handle incoming message from previous node
-    assert(!m_incoming.Empty());
-    if (!OnMessageReceived(m_incoming.Front()))
+    Buffer<Message*>& incoming = GetIncoming(ring);
+    assert(!incoming.Empty());
+    if (!OnMessageReceived(incoming.Front()))
     {
         return FAILED;
     }
-    m_incoming.Pop();
+    incoming.Pop();
     return SUCCESS;
 }
 
@@ -280,7 +288,7 @@ Result CDMA::RootDirectory::DoRequests()
 
             COMMIT{
                 ++m_nreads;
-                m_active.push(msg);
+                m_active.push_back(std::make_pair(mem_address, msg));
             }
 #else
             COMMIT
@@ -401,7 +409,7 @@ CDMA::RootDirectory::RootDirectory(const std::string& name, CDMA& parent, Clock&
     InitStorage(m_requests, clock, GetConf("ExternalOutputQueueSize", size_t)),
     InitStorage(m_responses, clock, GetConf("ExternalInputQueueSize", size_t)),
     m_active   (),
-    InitProcess(p_Incoming, DoIncoming),
+    p_Incoming (CreateReceivers<RootDirectory, &RootDirectory::DoIncoming>(*this, "p_Incoming")),
     InitProcess(p_Requests, DoRequests),
     InitProcess(p_Responses, DoResponses),
     InitSampleVariable(nreads, SVC_CUMULATIVE),
@@ -412,12 +420,12 @@ CDMA::RootDirectory::RootDirectory(const std::string& name, CDMA& parent, Clock&
     RegisterModelObject(*this, "rootdir");
     RegisterModelProperty(*this, "freq", (uint32_t)clock.GetFrequency());
 
-    m_incoming.Sensitive(p_Incoming);
     m_requests.Sensitive(p_Requests);
     m_responses.Sensitive(p_Responses);
 
     p_lines.AddProcess(p_Responses);
-    p_lines.AddProcess(p_Incoming);
+    for (auto p : p_Incoming)
+        p_lines.AddProcess(*p);
 
     size_t ddrid = GetConfOpt("DDRChannelID", size_t, id);
     if (ddrid >= ddr.size())
@@ -430,10 +438,17 @@ CDMA::RootDirectory::RootDirectory(const std::string& name, CDMA& parent, Clock&
     m_memory->SetClient(*this, sts, m_responses);
 
     p_Requests.SetStorageTraces(sts ^ m_responses);
-    p_Incoming.SetStorageTraces((GetOutgoingTrace() * opt(m_requests)) ^ opt(m_requests));
+    for (size_t i = 0; i < p_Incoming.size(); ++i)
+        p_Incoming[i]->SetStorageTraces((GetOutgoingTrace(i) * opt(m_requests)) ^ opt(m_requests));
     p_Responses.SetStorageTraces(GetOutgoingTrace());
 }
 
+CDMA::RootDirectory::~RootDirectory()
+{
+    for (auto p : p_Incoming)
+        delete p;
+}
+
 void CDMA::RootDirectory::Cmd_Info(std::ostream& out, const std::vector<std::string>& /*args*/) const
 {
     out <<
@@ -5,6 +5,7 @@
 #include "Directory.h"
 #include <arch/mem/DDR.h>
 
+#include <deque>
 #include <queue>
 #include <set>
 
@@ -45,10 +46,10 @@ private:
     DDRChannel*       m_memory;    ///< DDR memory channel
     Buffer<Message*>  m_requests;  ///< Requests to memory
     Buffer<Message*>  m_responses; ///< Responses from memory
-    std::queue<Message*> m_active;  ///< Messages active in DDR
+    std::deque<std::pair<MemAddr, Message*> > m_active; ///< Messages active in DDR, with their DDR address
 
     // Processes
-    Process p_Incoming;
+    std::vector<Process*> p_Incoming; ///< One per ring
     Process p_Requests;
     Process p_Responses;
 
@@ -56,10 +57,10 @@ private:
     Line* FindLine(MemAddr address);
     Line* AllocateLine(MemAddr address);
     bool  OnMessageReceived(Message* msg);
-    bool  OnReadCompleted();
+    bool  OnReadCompleted(MemAddr address) override;
 
     // Processes
-    Result DoIncoming();
+    Result DoIncoming(size_t ring);
     Result DoRequests();
     Result DoResponses();
 
@@ -74,6 +75,7 @@ public:
     RootDirectory(const std::string& name, CDMA& parent, Clock& clock, size_t id, const DDRChannelRegistry& ddr);
     RootDirectory(const RootDirectory&) = delete;
     RootDirectory& operator=(const RootDirectory&) = delete;
+    ~RootDirectory();
 
     // Updates the internal data structures
     void Initialize();
@@ -8,36 +8,10 @@ using namespace std;
 namespace Simulator
 {
 
-// Memory management data
-/*static*/ unsigned long                     ZLCDMA::Node::g_References   = 0;
-/*static*/ ZLCDMA::Node::Message*            ZLCDMA::Node::g_FreeMessages = NULL;
-/*static*/ std::list<ZLCDMA::Node::Message*> ZLCDMA::Node::g_Messages;
-
 /*static*/ void* ZLCDMA::Node::Message::operator new(size_t size)
 {
-    // We allocate this many messages at once
-    static const size_t ALLOCATE_SIZE = 1024;
-
     assert(size == sizeof(Message));
-    if (g_FreeMessages == NULL)
-    {
-        // Allocate more messages
-        Message* msg = new Message[ALLOCATE_SIZE];
-        g_Messages.push_back(msg);
-
-        // Link the new messages into the free list
-        for (size_t i = 0; i < ALLOCATE_SIZE; ++i, ++msg)
-        {
-            msg->next = g_FreeMessages;
-            g_FreeMessages = msg;
-        }
-    }
-    assert(g_FreeMessages != NULL);
-
-    // Grab a message off the free list
-    Message* msg = g_FreeMessages;
-    g_FreeMessages = msg->next;
-    return msg;
+    return MessagePool::Allocate();
 }
 
 /*static*/ void ZLCDMA::Node::Message::operator delete(void *p, size_t size)
@@ -51,8 +25,7 @@ namespace Simulator
 #endif
 
     // Append the message to the free list
-    msg->next = g_FreeMessages;
-    g_FreeMessages = msg;
+    MessagePool::Free(msg);
 }
 
 /*static*/ void ZLCDMA::Node::PrintMessage(std::ostream& out, const Message& msg)
@@ -141,23 +114,14 @@ ZLCDMA::Node::Node(const std::string& name, ZLCDMA& parent, Clock& clock)
       InitStorage(m_outgoing, clock, 2),
       InitProcess(p_Forward, DoForward)
 {
-    g_References++;
+    MessagePool::AddUser();
 
     m_outgoing.Sensitive(p_Forward);
 }
 
 ZLCDMA::Node::~Node()
 {
-    assert(g_References > 0);
-    if (--g_References == 0)
-    {
-        // Clean up the allocated messages
-        for (std::list<Message*>::const_iterator p = g_Messages.begin(); p != g_Messages.end(); ++p)
-        {
-            delete[] *p;
-        }
-        g_Messages.clear();
-    }
+    MessagePool::RemoveUser();
 }
 
 }
@@ -3,6 +3,7 @@
 #define ZLCDMA_NODE_H
 
 #include "CDMA.h"
+#include <sim/freelist.h>
 
 namespace Simulator
 {
@@ -99,10 +100,10 @@ protected:
     };
 
 private:
-    // Message management
-    static Message*            g_FreeMessages;
-    static std::list<Message*> g_Messages;
-    static unsigned long       g_References;
+    // Message management. The messages come from a pool shared by
+    // the systems of the process; the nodes are its users, so that
+    // the messages are released when the last ring goes away.
+    typedef FreeList<Message> MessagePool;
 
     static void PrintMessage(std::ostream& out, const Message& msg);
 
@@ -2,6 +2,7 @@
 #include <arch/mem/DDR.h>
 #include <sim/config.h>
 
+#include <algorithm>
 #include <iomanip>
 using namespace std;
 
@@ -70,10 +71,14 @@ ZLCDMA::RootDirectory::Line* ZLCDMA::RootDirectory::GetEmptyLine(MemAddr address
     return NULL;
 }
 
-bool ZLCDMA::RootDirectory::OnReadCompleted()
+bool ZLCDMA::RootDirectory::OnReadCompleted(MemAddr address)
 {
-    assert(!m_active.empty());
-    Message* msg = m_active.front();
+    // The DDR channel may reorder the reads; those to the same
+    // address complete in order.
+    auto p = std::find_if(m_active.begin(), m_active.end(),
+                          [address](const std::pair<MemAddr, Message*>& a) { return a.first == address; });
+    assert(p != m_active.end());
+    Message* msg = p->second;
 
     // Attach data to message, give all tokens and send
     COMMIT
@@ -86,7 +91,7 @@ bool ZLCDMA::RootDirectory::OnReadCompleted()
 
         msg->dirty = false;
 
-        m_active.pop();
+        m_active.erase(p);
     }
 
     if (!m_responses.Push(msg))
@@ -369,7 +374,7 @@ Result ZLCDMA::RootDirectory::DoRequests()
 
             COMMIT{
                 ++m_nreads;
-                m_active.push(msg);
+                m_active.push_back(std::make_pair((MemAddr)mem_address, msg));
             }
         }
         else
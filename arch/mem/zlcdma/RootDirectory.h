@@ -5,6 +5,7 @@
 #include "Directory.h"
 #include <arch/mem/DDR.h>
 
+#include <deque>
 #include <queue>
 #include <set>
 
@@ -47,7 +48,7 @@ private:
     Buffer<Message*>  m_requests;  ///< Requests to memory
     Buffer<Message*>  m_responses; ///< Responses from memory
 
-    std::queue<Message*> m_active;  ///< Active messages in memory
+    std::deque<std::pair<MemAddr, Message*> > m_active; ///< Active messages in memory, with their DDR address
 
 	std::queue<Line*>    m_activelines;
 
@@ -59,7 +60,7 @@ private:
     Line* FindLine(MemAddr address);
     Line* GetEmptyLine(MemAddr address, MemAddr& tag);
     bool  OnMessageReceived(Message* msg);
-    bool  OnReadCompleted();
+    bool  OnReadCompleted(MemAddr address) override;
 
     // Processes
     Result DoIncoming();
@@ -0,0 +1,47 @@
+#include "commands.h"
+
+#include <fstream>
+
+using namespace Simulator;
+using namespace std;
+
+bool cmd_profile(const vector<string>& /*command*/, vector<string>& args, cli_context& ctx)
+{
+    Kernel& kernel = *ctx.sys.GetKernel();
+
+    if (!args.empty())
+    {
+        if      (args[0] == "on")    kernel.SetProfiling(true);
+        else if (args[0] == "off")   kernel.SetProfiling(false);
+        else if (args[0] == "reset") kernel.ResetProfile();
+        else
+        {
+            cerr << "Unknown profile command: " << args[0] << endl;
+            return false;
+        }
+    }
+
+    const KernelProfile& kp = kernel.GetProfile();
+    cout << "Profiling is " << (kernel.IsProfiling() ? "enabled" : "disabled")
+         << "; " << kp.cycles << " cycles profiled so far." << endl;
+    return false;
+}
+
+bool cmd_profile_dump(const vector<string>& /*command*/, vector<string>& args, cli_context& ctx)
+{
+    ofstream os(args[1].c_str());
+    if (!os)
+    {
+        cerr << "Unable to open " << args[1] << " for writing" << endl;
+        return false;
+    }
+    try
+    {
+        ctx.sys.DumpProfile(os, args[0]);
+    }
+    catch (const exception& e)
+    {
+        PrintException(&ctx.sys, cerr, e);
+    }
+    return false;
+}
@@ -45,7 +45,19 @@ bool cmd_show_processes(const vector<string>& /*command*/, vector<string>& args,
     string pat = "*";
     if (!args.empty())
         pat = args[0];
-    ctx.sys.PrintProcesses(cout, pat);
+
+    string sort = "name";
+    if (args.size() > 1)
+        sort = args[1];
+
+    try
+    {
+        ctx.sys.PrintProcesses(cout, pat, sort);
+    }
+    catch (const exception& e)
+    {
+        PrintException(&ctx.sys, cerr, e);
+    }
     return false;
 }
 
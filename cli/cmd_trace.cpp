@@ -21,6 +21,8 @@ bool cmd_trace_show(const vector<string>& /*command*/, vector<string>& /*args*/,
     if (m & Kernel::DEBUG_MEMNET)    debugStr += " memnet";
     if (!debugStr.size()) debugStr = " (nothing)";
     cout << "Tracing enabled for:" << debugStr << endl;
+    if (ctx.sys.GetKernel()->GetDebugTrace() != NULL)
+        cout << "Traces are recorded in binary form." << endl;
     return false;
 }
 
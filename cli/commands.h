@@ -39,6 +39,8 @@ extern command_handler
     cmd_info,
     cmd_line,
     cmd_lookup,
+    cmd_profile,
+    cmd_profile_dump,
     cmd_quit,
     cmd_inspect,
     cmd_run,
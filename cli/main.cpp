@@ -11,6 +11,7 @@
 #include <sim/rusage.h>
 #include <sim/sampling.h>
 #include <sim/monitor.h>
+#include <sim/debugtrace.h>
 
 #include <sstream>
 #include <iostream>
@@ -31,6 +32,8 @@ struct ProgramConfig
     unsigned int                     m_areaTech;
     string                           m_configFile;
     bool                             m_enableMonitor;
+    string                           m_traceFile;
+    string                           m_profileFile;
     bool                             m_interactive;
     bool                             m_terminate;
     bool                             m_dumpconf;
@@ -51,6 +54,8 @@ struct ProgramConfig
         : m_areaTech(0),
           m_configFile(MGSIM_CONFIG_PATH),
           m_enableMonitor(false),
+          m_traceFile(),
+          m_profileFile(),
           m_interactive(false),
           m_terminate(false),
           m_dumpconf(false),
@@ -135,6 +140,10 @@ static const struct argp_option mgsim_options[] =
     { "no-edge-properties", 12, 0, 0, "Do not print link properties in the topology output.", 6 },
 
     { "monitor", 'm', 0, 0, "Enable asynchronous simulation monitoring (configure with -o MonitorSampleVariables).", 7 },
+    { "trace-file", 13, "FILE", 0, "Record debug traces in binary form to FILE instead of printing them. Use decodetrace(1) to convert FILE to text.", 7 },
+    { "record-inputs", 15, "FILE", 0, "Record the inputs from the host (UART, RTC, RPC) to FILE. Same as -o RecordInputs=FILE.", 7 },
+    { "replay-inputs", 16, "FILE", 0, "Replay the inputs recorded in FILE instead of reading them from the host. Same as -o ReplayInputs=FILE.", 7 },
+    { "profile", 14, "FILE", 0, "Profile the host time spent in each process and write the profile to FILE at the end of the simulation. The profile is written as CSV if FILE ends with .csv, otherwise as folded stacks for flame graphs.", 7 },
 
     { "symtable", 's', "FILE", OPTION_HIDDEN, "(obsolete; symbols are now read automatically from ELF)", 8 },
 
@@ -173,6 +182,10 @@ static error_t mgsim_parse_opt(int key, char *arg, struct argp_state *state)
     case 'T': config.m_dumptopo = true; config.m_topofile = arg; break;
     case 11 : config.m_dumpnodeprops = false; break;
     case 12 : config.m_dumpedgeprops = false; break;
+    case 13 : config.m_traceFile = arg; break;
+    case 14 : config.m_profileFile = arg; break;
+    case 15 : config.m_overrides.append("RecordInputs", arg); break;
+    case 16 : config.m_overrides.append("ReplayInputs", arg); break;
     case 'n': config.m_earlyquit = true; break;
     case 'o':
     {
@@ -272,6 +285,17 @@ void AtEnd(const MGSystem& sys, const ProgramConfig& cfg)
         clog << "### end end-of-simulation statistics" << endl;
     }
     PrintFinalVariables(*sys.GetKernel(), cfg);
+
+    if (!cfg.m_profileFile.empty())
+    {
+        const string& fname = cfg.m_profileFile;
+        bool csv = fname.size() >= 4 && fname.compare(fname.size() - 4, 4, ".csv") == 0;
+        ofstream os(fname.c_str());
+        if (!os)
+            cerr << "Unable to open " << fname << " for writing" << endl;
+        else
+            sys.DumpProfile(os, csv ? "csv" : "folded");
+    }
 }
 
 static
@@ -295,6 +319,7 @@ int main(int argc, char** argv)
 
     ProgramConfig flags;
     UNIQUE_PTR<Config> config;
+    UNIQUE_PTR<DebugTrace> trace;
     UNIQUE_PTR<MGSystem> sys;
     UNIQUE_PTR<Monitor> mo;
 
@@ -397,9 +422,9 @@ int main(int argc, char** argv)
         config->GetOverrides().append("RandomSeed", s);
     }
     {
+        // The seed is used by the kernel of the system.
         unsigned seed = config->getValue<unsigned>("RandomSeed");
         clog << "### random seed: " << seed << endl;
-        srand(seed);
     }
 
     if (flags.m_dumpconf)
@@ -479,6 +504,27 @@ int main(int argc, char** argv)
     mo.reset(new Monitor(*sys, flags.m_enableMonitor,
                          mo_mdfile, flags.m_earlyquit ? "" : mo_tfile, !flags.m_interactive));
 
+    // Then the debug trace recorder, if requested.
+    if (!flags.m_traceFile.empty())
+    {
+        try
+        {
+            trace.reset(new DebugTrace(flags.m_traceFile));
+        }
+        catch (const exception& e)
+        {
+            PrintException(NULL, cerr, e);
+            return 1;
+        }
+        sys->GetKernel()->SetDebugTrace(trace.get());
+    }
+
+    // Profile the processes from the start, if requested.
+    if (!flags.m_profileFile.empty())
+    {
+        sys->GetKernel()->SetProfiling(true);
+    }
+
     // Simulation proper.
     // Rules:
     // - if interactive, then do not automatically start the simulation.
@@ -521,7 +567,7 @@ int main(int argc, char** argv)
         {
             // Command loop
             cout << endl;
-            CommandLineReader clr;
+            CommandLineReader clr(sys->GetDisplayManager());
             cli_context ctx = { clr, *sys, *mo };
 
             while (HandleCommandLine(ctx) == false)
@@ -540,6 +586,7 @@ int main(int argc, char** argv)
         AtEnd(*sys, flags);
 
         sys.reset(nullptr);
+        trace.reset(nullptr);
         if (ex != NULL)
         {
             // The program is telling us how to terminate. Do it.
@@ -15,8 +15,10 @@ char *cmdline = NULL;
 using namespace Simulator;
 using namespace std;
 
+DisplayManager* CommandLineReader::s_displays = NULL;
+
 int CommandLineReader::ReadLineHook(void) {
-    auto dm = DisplayManager::GetManager();
+    auto dm = s_displays;
     if (!dm)
         return 0;
 
@@ -40,8 +42,9 @@ int CommandLineReader::ReadLineHook(void) {
     return 0;
 }
 
-CommandLineReader::CommandLineReader()
+CommandLineReader::CommandLineReader(DisplayManager* displays)
     : m_histfilename() {
+    s_displays = displays;
 #ifdef HAVE_LIBREADLINE
     rl_event_hook = &ReadLineHook;
 # ifdef HAVE_READLINE_HISTORY
@@ -54,6 +57,7 @@ CommandLineReader::CommandLineReader()
 }
 
 CommandLineReader::~CommandLineReader() {
+    s_displays = NULL;
 #ifdef HAVE_LIBREADLINE
     rl_event_hook = 0;
 #endif
@@ -45,12 +45,18 @@ extern "C" {
 #include <string>
 #include <vector>
 
+namespace Simulator { class DisplayManager; }
+
 class CommandLineReader {
     std::string   m_histfilename;
 
+    // Displays to refresh while waiting for input, if any. Static
+    // because the readline hook has no context argument.
+    static Simulator::DisplayManager* s_displays;
+
     static int ReadLineHook(void);
 public:
-    CommandLineReader();
+    CommandLineReader(Simulator::DisplayManager* displays);
     ~CommandLineReader();
 
     char* GetCommandLine(const std::string& prompt);
@@ -31,7 +31,7 @@ void StepSystem(Simulator::MGSystem& system, Simulator::CycleNo cycles)
     sigaction(SIGINT, &new_handler, &old_handler);
 
     // The selector sets/resets O_NONBLOCK on all monitored fds.
-    Simulator::Selector::GetSelector().Enable();
+    system.GetSelector().Enable();
 
     try
     {
@@ -46,6 +46,6 @@ void StepSystem(Simulator::MGSystem& system, Simulator::CycleNo cycles)
     sigaction(SIGINT, &old_handler, NULL);
     active_system = NULL;
 
-    Simulator::Selector::GetSelector().Disable();
+    system.GetSelector().Disable();
 }
 
@@ -19,6 +19,8 @@ command_descriptor command_table[] =
     { { "info", 0 },                  1, -1, cmd_info,       "info COMPONENT [ARGS...]",    "Show help/configuration/layout for COMPONENT." },
     { { "line", 0 },                  2, 2,  cmd_line,       "line COMPONENT ADDR", "Lookup the memory line at address ADDR in the memory system COMPONENT." },
     { { "lookup", 0 },                1, 1,  cmd_lookup,     "lookup ADDR",       "Look up the program symbol closest to address ADDR." },
+    { { "profile", "dump", 0 },       2, 2,  cmd_profile_dump, "profile dump FORMAT FILE", "Write the host time profile to FILE as csv or folded stacks (FORMAT)." },
+    { { "profile", 0 },               0, 1,  cmd_profile,    "profile [on|off|reset]", "Show the profiler state / enable, disable or clear the host time profile of the processes." },
     { { "quit", 0 },                  0, 0,  cmd_quit,       "quit",              "Exit the simulation." },
     { { "inspect", 0 },               1, -1, cmd_inspect,    "inspect NAME [ARGS...]", "Inspect NAME. See 'info NAME' for details." },
     { { "run", 0 },                   0, 0,  cmd_run,        "run",               "Run the system until it is idle or deadlocks. Livelocks will not be reported." },
@@ -26,7 +28,7 @@ command_descriptor command_table[] =
     { { "show", "vars", 0 },          0, 1,  cmd_show_vars,  "show vars [PAT]",   "List monitoring variables matching PAT." },
     { { "show", "syms", 0 },          0, 1,  cmd_show_syms,  "show syms [PAT]",   "List program symbols matching PAT." },
     { { "show", "components", 0 },    0, 2,  cmd_show_components, "show components [PAT] [LEVEL]",   "List components matching PAT (at most LEVELs)." },
-    { { "show", "processes", 0 },     0, 1,  cmd_show_processes, "show processes [PAT]",   "List processes matching PAT." },
+    { { "show", "processes", 0 },     0, 2,  cmd_show_processes, "show processes [PAT] [SORT]",   "List processes matching PAT, with their profile sorted by SORT (name, time, calls or stalls)." },
     { { "show", "devicedb", 0 },      0, 0,  cmd_show_devdb, "show devicedb",     "List the I/O device identifier database." },
     { { "state", 0 },                 0, 0,  cmd_state,       "state",            "Show the state of the system. Idle components are left out." },
     { { "statistics", 0 },            0, 0,  cmd_stats,       "statistics",       "Print the current simulation statistics." },
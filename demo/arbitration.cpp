@@ -0,0 +1,79 @@
+#include "demo/arbitration.h"
+#include "sim/delegate.h"
+
+template <typename Base>
+ExampleRequester<Base>::ExampleRequester(const std::string& name, Simulator::Object& parent, Simulator::Clock& clock,
+                                         Simulator::ArbitratedService<Base>& service, unsigned period)
+    : Simulator::Object(name, parent),
+      m_service(service),
+      m_period(period),
+      m_granted(0),
+      p_Request(*this, "request", Simulator::delegate::create<ExampleRequester, &ExampleRequester::DoRequest>(*this)),
+      m_enabled("f_enabled", *this, clock, true)
+{
+    m_enabled.Sensitive(p_Request);
+}
+
+template <typename Base>
+Simulator::Result
+ExampleRequester<Base>::DoRequest()
+{
+    if (GetKernel()->GetCycleNo() % m_period != 0)
+    {
+        return Simulator::SUCCESS;
+    }
+    if (!m_service.Invoke())
+    {
+        return Simulator::FAILED;
+    }
+    COMMIT {
+        ++m_granted;
+    }
+    return Simulator::SUCCESS;
+}
+
+// Create requesters req<first>...req<first+count-1> and register
+// them with the service using the given member function.
+template <typename Base, typename Port>
+static void CreateRequesters(Simulator::Object& root, Simulator::Clock& clock,
+                             Simulator::ArbitratedService<Base>& service, size_t first, size_t count,
+                             unsigned period, void (Port::*add)(const Simulator::Process&))
+{
+    for (size_t i = first; i < first + count; ++i)
+    {
+        auto r = new ExampleRequester<Base>("req" + std::to_string(i), root, clock, service, period);
+        (service.*add)(r->p_Request);
+    }
+}
+
+bool SetupArbitration(Simulator::Object& root, Simulator::Clock& clock,
+                      const std::string& policy, size_t requesters)
+{
+    using namespace Simulator;
+
+    if (policy == "priority")
+    {
+        auto s = new ArbitratedService<PriorityArbitratedPort>(clock, "service");
+        CreateRequesters(root, clock, *s, 0, requesters, 1, &PriorityArbitratedPort::AddProcess);
+    }
+    else if (policy == "cyclic")
+    {
+        auto s = new ArbitratedService<CyclicArbitratedPort>(clock, "service");
+        CreateRequesters(root, clock, *s, 0, requesters, 1, &CyclicArbitratedPort::AddProcess);
+    }
+    else if (policy == "prioritycyclic")
+    {
+        // One priority requester every other cycle, the others
+        // take turns in between.
+        auto s = new ArbitratedService<PriorityCyclicArbitratedPort>(clock, "service");
+        if (requesters > 0)
+            CreateRequesters(root, clock, *s, 0, 1, 2, &PriorityCyclicArbitratedPort::AddPriorityProcess);
+        if (requesters > 1)
+            CreateRequesters(root, clock, *s, 1, requesters - 1, 1, &PriorityCyclicArbitratedPort::AddCyclicProcess);
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
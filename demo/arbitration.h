@@ -0,0 +1,33 @@
+// -*- c++ -*-
+#ifndef ARBITRATION_H
+#define ARBITRATION_H
+
+#include "sim/kernel.h"
+#include "sim/ports.h"
+#include "sim/flag.h"
+
+// A requester that tries to access a shared arbitrated service
+// once every `period' cycles.
+template <typename Base>
+class ExampleRequester : public Simulator::Object
+{
+public:
+    ExampleRequester(const std::string& name, Simulator::Object& parent, Simulator::Clock& clock,
+                     Simulator::ArbitratedService<Base>& service, unsigned period);
+
+    Simulator::Result DoRequest();
+
+    Simulator::ArbitratedService<Base>& m_service;
+    unsigned                            m_period;
+    uint64_t                            m_granted;
+    Simulator::Process                  p_Request;
+    Simulator::Flag                     m_enabled;
+};
+
+// Instantiate a service with the given arbitration policy
+// ("priority", "cyclic" or "prioritycyclic") and a number of
+// requesters. Returns false if the policy is unknown.
+bool SetupArbitration(Simulator::Object& root, Simulator::Clock& clock,
+                      const std::string& policy, size_t requesters);
+
+#endif
@@ -2,10 +2,13 @@
 #include "demo/memclient.h"
 #include "demo/prodcons.h"
 #include "demo/prodcons2.h"
+#include "demo/arbitration.h"
+#include "demo/storage.h"
 
 #include "arch/mem/SerialMemory.h"
 
 #include <cstdlib>
+#include <chrono>
 
 
 // An example test program:
@@ -18,11 +21,18 @@ int main(int argc, char *argv[])
                   << "Supported demos:" << std::endl
                   << "   memory          Demo of the memory subsystem with a serial memory." << std::endl
                   << "   prodcons N M S  Demo a producer-consumer with a buffer of size S" << std::endl
-                  << "                   and frequency ratio N/M." << std::endl;
+                  << "                   and frequency ratio N/M." << std::endl
+                  << "   arbitration P N C" << std::endl
+                  << "                   Demo N requesters competing for a service with" << std::endl
+                  << "                   arbitration policy P (priority, cyclic or" << std::endl
+                  << "                   prioritycyclic) during C cycles." << std::endl
+                  << "   storage N C     Demo N storages of mixed types that all need" << std::endl
+                  << "                   an update every cycle, during C cycles." << std::endl;
 	return 0;
     }
     MGSim env(argv[1]);
     std::string demo = argv[2];
+    Simulator::CycleNo cycles = 100000;
 
     // To show the configuration found so far: env.cfg->dumpConfiguration(std::cerr, argv[1]);
 
@@ -71,6 +81,38 @@ int main(int argc, char *argv[])
 	c->Connect(*prod);
 	c->Initialize();
     }
+    else if (demo == "arbitration")
+    {
+	std::string policy = (argc > 3) ? argv[3] : "cyclic";
+	size_t n = 1;
+	if (argc > 4)
+            n = atoi(argv[4]);
+	if (argc > 5)
+            cycles = strtoull(argv[5], NULL, 0);
+
+	auto& clock = env.k->CreateClock(1);
+	auto root = new Simulator::Object("", *env.k);
+	if (!SetupArbitration(*root, clock, policy, n))
+	{
+            std::cerr << "Unknown arbitration policy: " << policy << std::endl;
+            return 1;
+	}
+    }
+    else if (demo == "storage")
+    {
+	size_t n = 1000;
+	if (argc > 3)
+            n = atoi(argv[3]);
+	if (argc > 4)
+            cycles = strtoull(argv[4], NULL, 0);
+
+	auto& clock = env.k->CreateClock(1);
+	auto root = new Simulator::Object("", *env.k);
+	new ExampleStorageBank("bank", *root, clock, n);
+
+	// Measure the host time spent in the storage updates.
+	env.k->SetProfiling(true);
+    }
     else if (demo == "memory")
     {
 	// Set up a clock and top-leval object
@@ -97,10 +139,21 @@ int main(int argc, char *argv[])
 
     std::cout << "Initialization done, starting simulation..." << std::endl;
 
-    // Global simulation loop: simulate 100 cycles
+    // Global simulation loop
     try {
-        env.DoSteps(100000);
-	std::cout << "Simulation completed, " << env.k->GetCycleNo() << " cycles elapsed." << std::endl;
+        auto start = std::chrono::steady_clock::now();
+        env.DoSteps(cycles);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	std::cout << "Simulation completed, " << env.k->GetCycleNo() << " cycles elapsed in "
+                  << elapsed.count() << " s (" << env.k->GetCycleNo() / elapsed.count()
+                  << " cycles/s)." << std::endl;
+        if (env.k->IsProfiling())
+        {
+            auto& prof = env.k->GetProfile();
+            double updatetime = prof.updatetime / 1e9;
+            std::cout << "Storage updates: " << prof.updates << " in " << updatetime << " s ("
+                      << prof.updates / updatetime << " updates/s)." << std::endl;
+        }
     }
     catch (const std::exception& e) {
         // Standard exception message
@@ -0,0 +1,90 @@
+#include "demo/storage.h"
+#include "sim/delegate.h"
+
+ExampleStorageBank::ExampleStorageBank(const std::string& name, Simulator::Object& parent, Simulator::Clock& clock,
+                                       size_t count)
+    : Simulator::Object(name, parent),
+      p_Toggle(*this, "toggle", Simulator::delegate::create<ExampleStorageBank, &ExampleStorageBank::DoToggle>(*this)),
+      m_enabled("f_enabled", *this, clock, true),
+      m_flags(),
+      m_registers(),
+      m_buffers()
+{
+    m_enabled.Sensitive(p_Toggle);
+
+    // Spread the storages over the types, interleaving their
+    // construction as in a real model.
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::string n = std::to_string(i);
+        switch (i % 3)
+        {
+        case 0:
+            m_flags.push_back(new Simulator::Flag("f_" + n, *this, clock, false));
+            m_flags.back()->Sensitive(p_Toggle);
+            break;
+        case 1:
+            m_registers.push_back(new Simulator::Register<unsigned>("r_" + n, *this, clock));
+            m_registers.back()->Sensitive(p_Toggle);
+            break;
+        default:
+            m_buffers.push_back(new Simulator::Buffer<unsigned>("b_" + n, *this, clock, 2));
+            m_buffers.back()->Sensitive(p_Toggle);
+            break;
+        }
+    }
+
+    // The process accesses all flags and registers, then all buffers
+    // on the cycles where it pushes to them. Pop() is not traced.
+    Simulator::StorageTrace t;
+    for (auto f : m_flags)
+        t.Append(*f);
+    for (auto r : m_registers)
+        t.Append(*r);
+    Simulator::StorageTraceSet traces(t);
+    if (!m_buffers.empty())
+    {
+        for (auto b : m_buffers)
+            t.Append(*b);
+        traces ^= Simulator::StorageTraceSet(t);
+    }
+    p_Toggle.SetStorageTraces(traces);
+}
+
+ExampleStorageBank::~ExampleStorageBank()
+{
+    for (auto f : m_flags)
+        delete f;
+    for (auto r : m_registers)
+        delete r;
+    for (auto b : m_buffers)
+        delete b;
+}
+
+Simulator::Result
+ExampleStorageBank::DoToggle()
+{
+    // Every storage goes from empty to full or back.
+    for (auto f : m_flags)
+    {
+        if (f->IsSet())
+            f->Clear();
+        else
+            f->Set();
+    }
+    for (auto r : m_registers)
+    {
+        if (r->Empty())
+            r->Write(1);
+        else
+            r->Clear();
+    }
+    for (auto b : m_buffers)
+    {
+        if (b->Empty())
+            b->Push(1);
+        else
+            b->Pop();
+    }
+    return Simulator::SUCCESS;
+}
@@ -0,0 +1,33 @@
+// -*- c++ -*-
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include "sim/kernel.h"
+#include "sim/flag.h"
+#include "sim/register.h"
+#include "sim/buffer.h"
+
+#include <vector>
+
+// A bank of storages of mixed types that a single process changes
+// every cycle, so that all of them need an update at the end of
+// every cycle.
+class ExampleStorageBank : public Simulator::Object
+{
+public:
+    ExampleStorageBank(const std::string& name, Simulator::Object& parent, Simulator::Clock& clock,
+                       size_t count);
+    ~ExampleStorageBank();
+    ExampleStorageBank(const ExampleStorageBank&) = delete;
+    ExampleStorageBank& operator=(const ExampleStorageBank&) = delete;
+
+    Simulator::Result DoToggle();
+
+    Simulator::Process                         p_Toggle;
+    Simulator::Flag                            m_enabled;
+    std::vector<Simulator::Flag*>              m_flags;
+    std::vector<Simulator::Register<unsigned>*> m_registers;
+    std::vector<Simulator::Buffer<unsigned>*>   m_buffers;
+};
+
+#endif
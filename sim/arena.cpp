@@ -0,0 +1,101 @@
+#include <sys_config.h>
+#include "sim/arena.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
+namespace Simulator
+{
+    Arena::Arena()
+        : m_regions(),
+          m_used(0),
+          m_hugePages(true),
+          m_numHuge(0),
+          m_allocated(0),
+          m_mutex()
+    {}
+
+    Arena::~Arena()
+    {
+        for (auto& r : m_regions)
+        {
+#ifdef HAVE_MMAP
+            if (r.mapped)
+            {
+                munmap(r.base, r.size);
+                continue;
+            }
+#endif
+            delete[] r.heap;
+        }
+    }
+
+    size_t Arena::GetReservedSize() const
+    {
+        size_t size = 0;
+        for (auto& r : m_regions)
+            size += r.size;
+        return size;
+    }
+
+    void Arena::NewRegion(size_t size)
+    {
+        Region r = { NULL, size, false, NULL };
+
+#if defined(HAVE_MMAP) && defined(MAP_ANONYMOUS)
+        // Map one region more than needed, so that the region can be
+        // aligned on a huge page by unmapping the excess.
+        void* p = mmap(NULL, size + REGION_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p != MAP_FAILED)
+        {
+            char*  base = static_cast<char*>(p);
+            size_t head = (REGION_SIZE - (uintptr_t)base % REGION_SIZE) % REGION_SIZE;
+            if (head > 0)
+                munmap(base, head);
+            if (REGION_SIZE - head > 0)
+                munmap(base + head + size, REGION_SIZE - head);
+
+            r.base   = base + head;
+            r.mapped = true;
+#if defined(HAVE_MADVISE) && defined(MADV_HUGEPAGE)
+            // This only fails if the host does not support
+            // transparent huge pages; the region is then still usable.
+            if (m_hugePages && madvise(r.base, size, MADV_HUGEPAGE) == 0)
+                ++m_numHuge;
+#endif
+        }
+#endif
+        if (r.base == NULL)
+        {
+            r.heap = new char[size + MAX_ALIGN];
+            r.base = r.heap + (MAX_ALIGN - (uintptr_t)r.heap % MAX_ALIGN) % MAX_ALIGN;
+        }
+
+        m_regions.push_back(r);
+        m_used = 0;
+    }
+
+    void* Arena::Allocate(size_t size, size_t align)
+    {
+        assert(align > 0 && (align & (align - 1)) == 0 && align <= MAX_ALIGN);
+        SetupLock lock(m_mutex);
+
+        size_t offset = m_regions.empty() ? 0 : (m_used + align - 1) & ~(align - 1);
+        if (m_regions.empty() || offset + size > m_regions.back().size)
+        {
+            // Arrays larger than a region get a region of their own,
+            // rounded up to whole huge pages.
+            NewRegion((std::max(size, (size_t)1) + REGION_SIZE - 1) / REGION_SIZE * REGION_SIZE);
+            offset = 0;
+        }
+
+        m_used = offset + size;
+        m_allocated += size;
+        return m_regions.back().base + offset;
+    }
+}
@@ -0,0 +1,86 @@
+// -*- c++ -*-
+#ifndef SIM_ARENA_H
+#define SIM_ARENA_H
+
+#include "sim/setuplock.h"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace Simulator
+{
+    /// Host memory for the large state arrays of the components of a
+    /// system, such as the data of the cache lines and the register
+    /// files.
+    //
+    // The arrays are carved out of regions of (a multiple of) 2 MiB,
+    // aligned on 2 MiB, which the host is asked to back with huge
+    // pages where it supports it. In a system with many cores, this
+    // replaces thousands of separate heap allocations by a few huge
+    // pages, which reduces the TLB misses of the simulation. When
+    // huge pages are unavailable, the regions use normal pages, or
+    // the heap if anonymous mappings are unavailable.
+    //
+    // The arrays are never freed individually: the memory is
+    // released with the arena, i.e. with the kernel.
+    class Arena
+    {
+    public:
+        static const size_t REGION_SIZE = 2 * 1024 * 1024;
+
+        /// Largest alignment of the allocations, a host cache line.
+        static const size_t MAX_ALIGN = 64;
+
+    private:
+        struct Region
+        {
+            char*  base;
+            size_t size;
+            bool   mapped;  ///< Mapped from the host, instead of the heap
+            char*  heap;    ///< The allocation from the heap, if not mapped
+        };
+
+        std::vector<Region> m_regions;
+        size_t              m_used;        ///< Bytes used in the last region
+        bool                m_hugePages;   ///< Ask the host for huge pages?
+        size_t              m_numHuge;     ///< Number of regions advised to use huge pages
+        size_t              m_allocated;   ///< Bytes handed out
+        SetupMutex          m_mutex;       ///< Components can be constructed concurrently
+
+        void NewRegion(size_t size);
+
+    public:
+        /// Allocate size bytes aligned on align, which must be a
+        /// power of two no larger than MAX_ALIGN.
+        void* Allocate(size_t size, size_t align);
+
+        /// Allocate an array of count value-initialized objects.
+        template<typename T>
+        T* Allocate(size_t count)
+        {
+            static_assert(std::is_trivially_destructible<T>::value,
+                          "Objects in the arena are never destroyed");
+            T* p = static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+            for (size_t i = 0; i < count; ++i)
+                new (p + i) T();
+            return p;
+        }
+
+        /// Set whether new regions ask the host for huge pages.
+        void SetHugePages(bool enable) { m_hugePages = enable; }
+
+        size_t GetNumRegions()      const { return m_regions.size(); }
+        size_t GetNumHugeRegions()  const { return m_numHuge; }
+        size_t GetAllocatedSize()   const { return m_allocated; }
+        size_t GetReservedSize()    const;
+
+        Arena();
+        ~Arena();
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+    };
+}
+
+#endif
@@ -2,9 +2,9 @@
 #ifndef SIM_BUFFER_H
 #define SIM_BUFFER_H
 
-#include <deque>
 #include "sim/storage.h"
 #include "sim/sampling.h"
+#include "sim/ringqueue.h"
 
 namespace Simulator
 {
@@ -21,7 +21,7 @@ namespace Simulator
 
         const size_t  m_maxSize;             ///< Maximum size of this buffer
         const size_t  m_maxPushes;           ///< Maximum number of pushes at a cycle
-        std::deque<T> m_data;                ///< The actual buffer storage
+        RingQueue<T>  m_data;                ///< The actual buffer storage
         size_t        m_pushes;              ///< Number of items Push()'d this cycle
         T             m_new[MAX_PUSHES];     ///< The items being pushed (when m_pushes > 0)
         DefineStateVariable(bool, popped);   ///< Has a Pop() been done?
@@ -36,6 +36,7 @@ namespace Simulator
     protected:
         // Update: update the buffer between cycles.
         void Update() override;
+        friend class TypedStorageBatch<Buffer>;
 
     public:
         // How many slots are there in total?
@@ -64,8 +65,8 @@ namespace Simulator
         static constexpr const char* NAME_PREFIX = "b_";
 
         // We define an iterator for debugging the contents only
-        typedef typename std::deque<T>::const_iterator         const_iterator;
-        typedef typename std::deque<T>::const_reverse_iterator const_reverse_iterator;
+        typedef typename RingQueue<T>::const_iterator         const_iterator;
+        typedef typename RingQueue<T>::const_reverse_iterator const_reverse_iterator;
         const_iterator         begin()  const { return m_data.begin(); }
         const_iterator         end()    const { return m_data.end();   }
         const_reverse_iterator rbegin() const { return m_data.rbegin(); }
@@ -148,7 +148,7 @@ namespace Simulator
           SensitiveStorage(name, parent, clock),
           m_maxSize(maxSize),
           m_maxPushes(maxPushes),
-          m_data(),
+          m_data(maxSize),
           m_pushes(0),
           InitStateVariable(popped, false),
           InitSampleVariable(stalls, SVC_CUMULATIVE),
@@ -159,6 +159,7 @@ namespace Simulator
     {
         RegisterStateObject(m_data, "data");
         assert(maxPushes <= MAX_PUSHES);
+        SetUpdateType(*this);
     }
 
 }
@@ -1,4 +1,5 @@
 #include "sim/kernel.h"
+#include "sim/storage.h"
 
 namespace Simulator
 {
@@ -18,7 +19,14 @@ namespace Simulator
         m_activeProcesses(NULL),
         m_activeStorages(NULL),
         m_activeArbitrators(NULL),
-        m_activated(false)
+        m_activated(false),
+        m_batches()
     {}
 
+    Clock::~Clock()
+    {
+        for (auto b : m_batches)
+            delete b;
+    }
+
 }
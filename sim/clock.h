@@ -7,6 +7,7 @@
 #endif
 
 #include <cstdint>
+#include <vector>
 
 namespace Simulator
 {
@@ -25,6 +26,7 @@ namespace Simulator
     // Forward declarations
     class Process;
     class Storage;
+    class StorageBatch;
     class Arbitrator;
     class Kernel;
 
@@ -51,12 +53,15 @@ namespace Simulator
         CycleNo       m_cycle;       ///< Next cycle this clock needs to run
 
         Process*      m_activeProcesses;   ///< List of processes that need to be run.
-        Storage*      m_activeStorages;    ///< List of storages that need to be updated.
+        StorageBatch* m_activeStorages;    ///< List of batches of storages that need to be updated.
         Arbitrator*   m_activeArbitrators; ///< List of arbitrators that need arbitration.
 
         bool          m_activated;   ///< Has this clock already been activated this cycle?
 
+        std::vector<StorageBatch*> m_batches; ///< The storage batches of this clock, by type index
+
         Clock(const Clock& clock) = delete; // No copying
+        Clock& operator=(const Clock& clock) = delete;
 
         // Constructor, called by Kernel::GetClock.
         //
@@ -67,6 +72,7 @@ namespace Simulator
         // The 3rd argument (period) is the number of master ticks per
         // tick of this clock.
         Clock(Kernel&, Frequency frequency, Period period);
+        ~Clock();
 
     public:
 #ifdef STATIC_KERNEL
@@ -80,7 +86,7 @@ namespace Simulator
         const Clock* GetNext() const { return m_next; }
 
         const Process* GetActiveProcesses() const { return m_activeProcesses; }
-        const Storage* GetActiveStorages() const { return m_activeStorages; }
+        const StorageBatch* GetActiveStorages() const { return m_activeStorages; }
         const Arbitrator* GetActiveArbitrators() const { return m_activeArbitrators; }
 
         CycleNo GetNextTick() const { return m_cycle; }
@@ -92,11 +98,18 @@ namespace Simulator
         Frequency GetFrequency() const { return m_frequency; }
 
         /**
-         * @brief Register an update request for the specified storage at the end of the cycle.
-         * @param storage The storage to update
-         * @return the next storage that requires updating
+         * @brief Register an update request for the specified batch of storages at the end of the cycle.
+         * @param batch The batch to update
+         * @return the next batch that requires updating
+         */
+        StorageBatch* ActivateStorageBatch(StorageBatch& batch);
+
+        /**
+         * @brief Returns the batch that updates the storages of type S on this clock.
+         * Defined in sim/storage.hpp.
          */
-        Storage* ActivateStorage(Storage& storage);
+        template<typename S>
+        StorageBatch& GetStorageBatch();
 
         /**
          * @brief Register an update request for the specified arbitrator at the end of the cycle.
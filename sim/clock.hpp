@@ -22,10 +22,11 @@ namespace Simulator
     }
 
     inline
-    Storage* Clock::ActivateStorage(Storage& storage)
+    StorageBatch* Clock::ActivateStorageBatch(StorageBatch& batch)
     {
-        Storage* next = m_activeStorages;
-        m_activeStorages = &storage;
+        Kernel::SetupGuard guard(GetKernel());
+        StorageBatch* next = m_activeStorages;
+        m_activeStorages = &batch;
         GetKernel().ActivateClock(*this);
         return next;
     }
@@ -33,6 +34,7 @@ namespace Simulator
     inline
     Arbitrator* Clock::ActivateArbitrator(Arbitrator& arbitrator)
     {
+        Kernel::SetupGuard guard(GetKernel());
         Arbitrator* next = m_activeArbitrators;
         m_activeArbitrators = &arbitrator;
         GetKernel().ActivateClock(*this);
@@ -42,6 +44,7 @@ namespace Simulator
     inline
     void Clock::ActivateProcess(Process& process)
     {
+        Kernel::SetupGuard guard(GetKernel());
         if (++process.m_activations == 1)
         {
             // First time this process has been activated, queue it
@@ -4,18 +4,32 @@
 
 // Returns the number of trailing 0-bits in x, starting at the least
 // significant bit position. (If x is 0, the result is undefined.)
+// clzll returns the number of leading 0-bits in a 64-bit x, starting at
+// the most significant bit position. (If x is 0, the result is undefined.)
 
 #ifdef __GNUC__
 # define ctz(N) __builtin_ctz(N)
+# define ctzll(N) __builtin_ctzll(N)
+# define clzll(N) __builtin_clzll(N)
 #else
 template<typename T>
 inline int ctz(T x)
 {
-    int p, b;
+    int p;
+    T b;
     for (p = 0, b = 1; !(b & x); b <<= 1, ++p)
         ;
     return p;
 }
+# define ctzll(N) ctz((unsigned long long)(N))
+inline int clzll(unsigned long long x)
+{
+    int p;
+    unsigned long long b;
+    for (p = 0, b = 1ULL << 63; !(b & x); b >>= 1, ++p)
+        ;
+    return p;
+}
 #endif
 
 #endif
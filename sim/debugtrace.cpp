@@ -0,0 +1,273 @@
+#include "sim/debugtrace.h"
+#include "sim/except.h"
+
+#include <cstring>
+#include <cerrno>
+
+#ifdef CAN_USE_SIGMASK_ON_STD_THREAD
+#include <csignal>
+#include <pthread.h>
+#define pthread(Function, ...) do { if (pthread_ ## Function(__VA_ARGS__)) perror("pthread_" #Function); } while(0)
+#endif
+
+using namespace std;
+
+namespace Simulator
+{
+    // File header: magic, format version and a byte order marker.
+    static const char     TRACE_MAGIC[8] = { 'M', 'G', 'D', 'T', 'R', 'A', 'C', 'E' };
+    static const uint32_t TRACE_VERSION  = 1;
+    static const uint32_t TRACE_BYTEORDER = 0x01020304;
+
+    void* rundebugtrace(void *arg)
+    {
+#ifdef CAN_USE_SIGMASK_ON_STD_THREAD
+        sigset_t sigset;
+        sigemptyset(&sigset);
+        sigaddset(&sigset, SIGINT);
+        sigaddset(&sigset, SIGQUIT);
+        sigaddset(&sigset, SIGHUP);
+        sigaddset(&sigset, SIGTERM);
+        pthread(sigmask, SIG_BLOCK, &sigset, 0);
+#endif
+
+        DebugTrace *t = (DebugTrace*) arg;
+        t->run();
+        return 0;
+    }
+
+    // Extract the types of the arguments consumed by a printf-style
+    // format string. The decoder performs the same analysis.
+    vector<DebugTrace::ArgSpec> DebugTrace::ParseFormat(const char* fmt)
+    {
+        vector<ArgSpec> args;
+        for (const char *p = fmt; *p != '\0'; ++p)
+        {
+            if (*p != '%')
+                continue;
+            if (*++p == '%')
+                continue;
+
+            // Flags
+            while (*p != '\0' && strchr("-+ #0'", *p) != NULL)
+                ++p;
+            // Width
+            if (*p == '*') {
+                args.push_back({ARG_INT, ~0ULL});
+                ++p;
+            } else while (*p >= '0' && *p <= '9')
+                ++p;
+            // Precision
+            if (*p == '.') {
+                ++p;
+                if (*p == '*') {
+                    args.push_back({ARG_INT, ~0ULL});
+                    ++p;
+                } else while (*p >= '0' && *p <= '9')
+                    ++p;
+            }
+            // Length modifier
+            int length = 0; // -2: hh, -1: h, 0: none, 1: l, 2: ll/j/z/t/q, 3: L
+            switch (*p)
+            {
+            case 'h': ++p; length = -1; if (*p == 'h') { ++p; length = -2; } break;
+            case 'l': ++p; length = 1;  if (*p == 'l') { ++p; length = 2; } break;
+            case 'j': case 'z': case 't': case 'q': ++p; length = 2; break;
+            case 'L': ++p; length = 3; break;
+            }
+            // Conversion
+            const uint64_t mask = (length == -2) ? 0xffULL : (length == -1) ? 0xffffULL : ~0ULL;
+            switch (*p)
+            {
+            case 'd': case 'i':
+                args.push_back({length == 1 ? ARG_LONG : length >= 2 ? ARG_LLONG : ARG_INT, ~0ULL});
+                break;
+            case 'o': case 'u': case 'x': case 'X': case 'c':
+                args.push_back({length == 1 ? ARG_ULONG : length >= 2 ? ARG_ULLONG : ARG_UINT, mask});
+                break;
+            case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+                args.push_back({length == 3 ? ARG_LDOUBLE : ARG_DOUBLE, ~0ULL});
+                break;
+            case 's':
+                args.push_back({ARG_STRING, ~0ULL});
+                break;
+            case 'p': case 'n':
+                args.push_back({ARG_POINTER, ~0ULL});
+                break;
+            case '\0':
+                return args;
+            default:
+                throw exceptf<InvalidArgumentException>("Unsupported conversion in debug format string: %s", fmt);
+            }
+        }
+        return args;
+    }
+
+    void DebugTrace::PutString(const char* str)
+    {
+        if (str == NULL)
+            str = "(null)";
+        uint32_t len = strlen(str);
+        Put(len);
+        Put(str, len);
+    }
+
+    uint32_t DebugTrace::InternName(unordered_map<const void*, uint32_t>& table, RecordKind kind,
+                                    const void* key, const string& name)
+    {
+        auto p = table.find(key);
+        if (p != table.end())
+            return p->second;
+
+        uint32_t id = table.size() + 1;
+        table[key] = id;
+        Put((uint8_t)kind);
+        Put(id);
+        PutString(name.c_str());
+        return id;
+    }
+
+    const DebugTrace::FormatInfo& DebugTrace::InternFormat(const char* fmt)
+    {
+        auto p = m_formats.find(fmt);
+        if (p != m_formats.end())
+            return p->second;
+
+        FormatInfo& info = m_formats[fmt];
+        info.id = m_formats.size();
+        info.args = ParseFormat(fmt);
+        Put((uint8_t)REC_FORMAT);
+        Put(info.id);
+        PutString(fmt);
+        return info;
+    }
+
+    void DebugTrace::Record(RecordKind kind, CycleNo cycle, const Object& obj, const Process* proc,
+                            const char* fmt, va_list args)
+    {
+        // Definitions must precede the message in the stream.
+        uint32_t oid = InternName(m_objects, REC_OBJECT, &obj, obj.GetName());
+        uint32_t pid = (proc == NULL) ? 0 : InternName(m_processes, REC_PROCESS, proc, proc->GetName());
+        const FormatInfo& info = InternFormat(fmt);
+
+        Put((uint8_t)kind);
+        Put((uint64_t)cycle);
+        Put(oid);
+        Put(pid);
+        Put(info.id);
+
+        for (auto& a : info.args)
+        {
+            switch (a.kind)
+            {
+            case ARG_INT:     Put((int64_t)va_arg(args, int)); break;
+            case ARG_UINT:    Put((uint64_t)va_arg(args, unsigned int) & a.mask); break;
+            case ARG_LONG:    Put((int64_t)va_arg(args, long)); break;
+            case ARG_ULONG:   Put((uint64_t)va_arg(args, unsigned long)); break;
+            case ARG_LLONG:   Put((int64_t)va_arg(args, long long)); break;
+            case ARG_ULLONG:  Put((uint64_t)va_arg(args, unsigned long long)); break;
+            case ARG_DOUBLE:  Put(va_arg(args, double)); break;
+            case ARG_LDOUBLE: Put((double)va_arg(args, long double)); break;
+            case ARG_STRING:  PutString(va_arg(args, const char*)); break;
+            case ARG_POINTER: Put((uint64_t)(uintptr_t)va_arg(args, void*)); break;
+            }
+        }
+
+        ++m_records;
+        if (m_current->size() >= BUFFER_SIZE)
+            Submit();
+    }
+
+    void DebugTrace::Submit()
+    {
+        unique_lock<mutex> lock(m_lock);
+        m_full.push_back(m_current);
+        if (m_free.empty())
+        {
+            m_current = new Buffer;
+            m_current->reserve(BUFFER_SIZE + BUFFER_SIZE / 4);
+        }
+        else
+        {
+            m_current = m_free.back();
+            m_free.pop_back();
+        }
+        m_cond.notify_one();
+    }
+
+    void DebugTrace::Flush()
+    {
+        if (!m_current->empty())
+            Submit();
+    }
+
+    void DebugTrace::run()
+    {
+        unique_lock<mutex> lock(m_lock);
+        for (;;)
+        {
+            m_cond.wait(lock, [this] { return m_stop || !m_full.empty(); });
+            if (m_full.empty())
+                break;
+
+            Buffer* buf = m_full.front();
+            m_full.pop_front();
+
+            // Write without holding the lock, so that the simulation
+            // can continue to submit buffers.
+            lock.unlock();
+            if (fwrite(buf->data(), 1, buf->size(), m_file) != buf->size())
+                perror("debug trace");
+            buf->clear();
+            lock.lock();
+
+            m_free.push_back(buf);
+        }
+        fflush(m_file);
+    }
+
+    DebugTrace::DebugTrace(const string& filename)
+        : m_file(fopen(filename.c_str(), "wb")),
+          m_objects(),
+          m_processes(),
+          m_formats(),
+          m_current(new Buffer),
+          m_records(0),
+          m_lock(),
+          m_cond(),
+          m_full(),
+          m_free(),
+          m_stop(false),
+          m_writer(NULL)
+    {
+        if (m_file == NULL)
+        {
+            delete m_current;
+            throw exceptf<>("Unable to open %s for writing: %s", filename.c_str(), strerror(errno));
+        }
+        m_current->reserve(BUFFER_SIZE + BUFFER_SIZE / 4);
+
+        Put(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+        Put(TRACE_VERSION);
+        Put(TRACE_BYTEORDER);
+
+        m_writer = new std::thread(rundebugtrace, this);
+    }
+
+    DebugTrace::~DebugTrace()
+    {
+        Flush();
+        {
+            unique_lock<mutex> lock(m_lock);
+            m_stop = true;
+            m_cond.notify_one();
+        }
+        m_writer->join();
+        delete m_writer;
+
+        fclose(m_file);
+        for (auto b : m_free)
+            delete b;
+        delete m_current;
+    }
+}
@@ -0,0 +1,131 @@
+// -*- c++ -*-
+#ifndef SIM_DEBUGTRACE_H
+#define SIM_DEBUGTRACE_H
+
+#include <sim/kernel.h>
+
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Simulator
+{
+    class Object;
+    class Process;
+
+    // DebugTrace: binary recorder for the debug output of the
+    // components.
+    //
+    // Instead of formatting debug messages as text, the recorder
+    // stores the cycle, the emitting component and process, the
+    // format string and the raw arguments. Names and format strings
+    // are interned and written once. Records accumulate in memory
+    // buffers which are written out by a background thread. The
+    // text is rendered offline with the `decodetrace' tool.
+    //
+    // Recording happens on the simulation thread; only the file
+    // output is asynchronous.
+    class DebugTrace
+    {
+    public:
+        // Kinds of records in the trace. These must match decodetrace.
+        enum RecordKind
+        {
+            REC_OBJECT   = 'o', ///< Definition of a component name
+            REC_PROCESS  = 'p', ///< Definition of a process name
+            REC_FORMAT   = 'f', ///< Definition of a format string
+            REC_DEBUG    = 'D', ///< Message from DebugSimWrite_ and friends
+            REC_DEADLOCK = 'L', ///< Message from DeadlockWrite_
+        };
+
+    private:
+        // Argument kinds, extracted from the format strings.
+        enum ArgKind
+        {
+            ARG_INT,        ///< int or smaller, signed
+            ARG_UINT,       ///< int or smaller, unsigned
+            ARG_LONG,       ///< long, signed
+            ARG_ULONG,      ///< long, unsigned
+            ARG_LLONG,      ///< long long, intmax_t, size_t, ptrdiff_t, signed
+            ARG_ULLONG,     ///< same, unsigned
+            ARG_DOUBLE,     ///< double
+            ARG_LDOUBLE,    ///< long double
+            ARG_STRING,     ///< const char*
+            ARG_POINTER,    ///< void*
+        };
+
+        struct ArgSpec
+        {
+            ArgKind  kind;
+            uint64_t mask;  ///< Mask applied to unsigned values (for h/hh)
+        };
+
+        struct FormatInfo
+        {
+            uint32_t             id;
+            std::vector<ArgSpec> args;
+
+            FormatInfo() : id(0), args() {}
+        };
+
+        typedef std::vector<char> Buffer;
+
+        FILE*                                         m_file;
+        std::unordered_map<const void*, uint32_t>     m_objects;   ///< Interned component names
+        std::unordered_map<const void*, uint32_t>     m_processes; ///< Interned process names
+        std::unordered_map<const char*, FormatInfo>   m_formats;   ///< Interned format strings
+        Buffer*                                       m_current;   ///< Buffer being filled
+        size_t                                        m_records;   ///< Number of messages recorded
+
+        // State shared with the writer thread.
+        std::mutex                                    m_lock;
+        std::condition_variable                       m_cond;
+        std::deque<Buffer*>                           m_full;      ///< Buffers waiting to be written
+        std::vector<Buffer*>                          m_free;      ///< Buffers that can be reused
+        bool                                          m_stop;
+        std::thread*                                  m_writer;
+
+        static const size_t BUFFER_SIZE = 1 << 20;
+
+        static std::vector<ArgSpec> ParseFormat(const char* fmt);
+
+        uint32_t InternName(std::unordered_map<const void*, uint32_t>& table, RecordKind kind,
+                            const void* key, const std::string& name);
+        const FormatInfo& InternFormat(const char* fmt);
+
+        void Put(const void* data, size_t size) { m_current->insert(m_current->end(), (const char*)data, (const char*)data + size); }
+        template<typename T>
+        void Put(T value) { Put(&value, sizeof(value)); }
+        void PutString(const char* str);
+
+        void Submit();
+
+        friend void* rundebugtrace(void*);
+        void run();
+
+    public:
+        // Open the trace file and start the writer thread.
+        DebugTrace(const std::string& filename);
+        DebugTrace(const DebugTrace&) = delete;
+        DebugTrace& operator=(const DebugTrace&) = delete;
+        // Write out all pending records and close the file.
+        ~DebugTrace();
+
+        // Record one message.
+        void Record(RecordKind kind, CycleNo cycle, const Object& obj, const Process* proc,
+                    const char* fmt, va_list args);
+
+        // Hand the records so far to the writer thread.
+        void Flush();
+
+        size_t GetNumRecords() const { return m_records; }
+    };
+}
+
+#endif
@@ -32,6 +32,7 @@ namespace Simulator
           InitSampleVariable(lastcycle, SVC_CUMULATIVE),
           InitSampleVariable(totalsize, SVC_CUMULATIVE)
     {
+        SetUpdateType(*this);
         if (set) {
             RegisterUpdate();
         }
@@ -23,6 +23,7 @@ namespace Simulator
 
         // Update: commit this flag's changes between master cycles.
         void Update() override;
+        friend class TypedStorageBatch<Flag>;
 
     public:
         // IsSet: return true iff the flag is set.
@@ -0,0 +1,164 @@
+// -*- c++ -*-
+#ifndef SIM_FREELIST_H
+#define SIM_FREELIST_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace Simulator
+{
+    /// Pool of objects of type T, such as network messages, which are
+    /// allocated and freed at a high rate during the simulation. T
+    /// must have a member T* next, which is only used while the
+    /// object is free.
+    //
+    // The objects are allocated in chunks. Each host thread keeps
+    // its own list of free objects, so that systems that run on
+    // separate threads allocate without locking. The chunks belong
+    // to the pool, not to the threads, since the objects can move
+    // between threads with the system that holds them: when a thread
+    // exits, its free objects are handed back to the pool, and are
+    // reused by the next thread that runs out.
+    //
+    // Components that hold objects of the pool may register as its
+    // users; when the last user goes away, no object can be live any
+    // more, and the chunks are released to the host. The free lists
+    // of the threads are then discarded lazily, by comparing their
+    // generation to the generation of the pool.
+    template<typename T>
+    class FreeList
+    {
+        // We allocate this many objects at once
+        static const size_t CHUNK_SIZE = 1024;
+
+        struct Shared
+        {
+            std::mutex            lock;
+            std::vector<T*>       chunks;      ///< The allocated chunks
+            T*                    orphans;     ///< Free objects of the threads that exited
+            size_t                users;       ///< Number of registered users
+            std::atomic<uint64_t> generation;  ///< Incremented when the chunks are released
+
+            Shared() : lock(), chunks(), orphans(NULL), users(0), generation(0) {}
+            Shared(const Shared&) = delete;
+            Shared& operator=(const Shared&) = delete;
+        };
+
+        struct Local
+        {
+            T*       free;               ///< Free objects of this thread
+            uint64_t generation;         ///< Generation of the pool of the objects
+
+            Local() : free(NULL), generation(GetGeneration()) {}
+            ~Local()
+            {
+                if (free == NULL)
+                    return;
+                Shared& shared = GetShared();
+                std::lock_guard<std::mutex> lock(shared.lock);
+                if (generation == GetGeneration())
+                {
+                    T* last = free;
+                    while (last->next != NULL)
+                        last = last->next;
+                    last->next     = shared.orphans;
+                    shared.orphans = free;
+                }
+            }
+            Local(const Local&) = delete;
+            Local& operator=(const Local&) = delete;
+        };
+
+        static Shared& GetShared()
+        {
+            static Shared shared;
+            return shared;
+        }
+
+        static uint64_t GetGeneration()
+        {
+            return GetShared().generation.load(std::memory_order_relaxed);
+        }
+
+        static Local& GetLocal()
+        {
+            static thread_local Local local;
+            return local;
+        }
+
+        static void Refill(Local& local)
+        {
+            Shared& shared = GetShared();
+            std::lock_guard<std::mutex> lock(shared.lock);
+            local.generation = GetGeneration();
+            if (shared.orphans != NULL)
+            {
+                // Adopt the free objects of the threads that exited
+                local.free     = shared.orphans;
+                shared.orphans = NULL;
+                return;
+            }
+
+            T* obj = new T[CHUNK_SIZE];
+            shared.chunks.push_back(obj);
+            local.free = NULL;
+            for (size_t i = 0; i < CHUNK_SIZE; ++i, ++obj)
+            {
+                obj->next  = local.free;
+                local.free = obj;
+            }
+        }
+
+    public:
+        static T* Allocate()
+        {
+            Local& local = GetLocal();
+            if (local.free == NULL || local.generation != GetGeneration())
+            {
+                Refill(local);
+            }
+            T* obj = local.free;
+            local.free = obj->next;
+            return obj;
+        }
+
+        static void Free(T* obj)
+        {
+            Local& local = GetLocal();
+            if (local.generation != GetGeneration())
+            {
+                local.free       = NULL;
+                local.generation = GetGeneration();
+            }
+            obj->next  = local.free;
+            local.free = obj;
+        }
+
+        static void AddUser()
+        {
+            Shared& shared = GetShared();
+            std::lock_guard<std::mutex> lock(shared.lock);
+            ++shared.users;
+        }
+
+        static void RemoveUser()
+        {
+            Shared& shared = GetShared();
+            std::lock_guard<std::mutex> lock(shared.lock);
+            if (--shared.users == 0)
+            {
+                // Clean up the allocated objects
+                for (T* chunk : shared.chunks)
+                    delete[] chunk;
+                shared.chunks.clear();
+                shared.orphans = NULL;
+                shared.generation.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    };
+}
+
+#endif
@@ -38,6 +38,8 @@ bool InputConfigRegistry::lookup(const string& name_, string& result, const stri
     string pat;
     transform(name.begin(), name.end(), name.begin(), ::tolower);
 
+    SetupLock lock(m_setup_mutex);
+
     auto p = m_cache.find(name);
     if (p != m_cache.end())
     {
@@ -142,6 +144,6 @@ vector<string> InputConfigRegistry::getWordList(const string& name)
 }
 
 InputConfigRegistry::InputConfigRegistry(const ConfigMap& defaults, const ConfigMap& overrides)
-    : m_data(defaults), m_overrides(overrides), m_cache()
+    : m_data(defaults), m_overrides(overrides), m_cache(), m_setup_mutex()
 {
 }
@@ -6,6 +6,7 @@
 #include "sim/convertval.h"
 #include "sim/except.h"
 #include "sim/kernel.h"
+#include "sim/setuplock.h"
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -28,6 +29,9 @@ class InputConfigRegistry
     typedef std::unordered_map<std::string, std::pair<std::string, std::string> > ConfigCache;
     ConfigCache              m_cache;
 
+    // Protects m_cache during parallel component construction.
+    Simulator::SetupMutex    m_setup_mutex;
+
 public:
     /// Constructor, destructor etc.
     InputConfigRegistry(const ConfigMap& data, const ConfigMap& overrides);
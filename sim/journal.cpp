@@ -0,0 +1,202 @@
+#include "sim/journal.h"
+#include "sim/except.h"
+
+#include <cerrno>
+#include <cstring>
+
+using namespace std;
+
+namespace Simulator
+{
+    // File header: magic, format version and a byte order marker.
+    static const char     JOURNAL_MAGIC[8] = { 'M', 'G', 'J', 'O', 'U', 'R', 'N', 'L' };
+    static const uint32_t JOURNAL_VERSION  = 1;
+    static const uint32_t JOURNAL_BYTEORDER = 0x01020304;
+
+    static const size_t HEADER_SIZE = sizeof(JOURNAL_MAGIC) + 2 * sizeof(uint32_t);
+
+    InputJournal::InputJournal(const string& filename, Mode mode)
+        : m_mode(mode),
+          m_filename(filename),
+          m_file(NULL),
+          m_sources(),
+          m_names(),
+          m_data(),
+          m_entries(0)
+    {
+        if (m_mode == REPLAY)
+        {
+            Load();
+            return;
+        }
+
+        m_file = fopen(filename.c_str(), "wb");
+        if (m_file == NULL)
+            throw exceptf<>("Unable to open %s for writing: %s", filename.c_str(), strerror(errno));
+
+        fwrite(JOURNAL_MAGIC, 1, sizeof(JOURNAL_MAGIC), m_file);
+        fwrite(&JOURNAL_VERSION, 1, sizeof(JOURNAL_VERSION), m_file);
+        fwrite(&JOURNAL_BYTEORDER, 1, sizeof(JOURNAL_BYTEORDER), m_file);
+    }
+
+    InputJournal::~InputJournal()
+    {
+        if (m_file != NULL)
+            fclose(m_file);
+    }
+
+    void InputJournal::PutVarint(uint64_t value)
+    {
+        do
+        {
+            unsigned char b = value & 0x7f;
+            value >>= 7;
+            if (value != 0)
+                b |= 0x80;
+            putc(b, m_file);
+        } while (value != 0);
+    }
+
+    void InputJournal::Load()
+    {
+        FILE* f = fopen(m_filename.c_str(), "rb");
+        if (f == NULL)
+            throw exceptf<>("Unable to open %s for reading: %s", m_filename.c_str(), strerror(errno));
+
+        vector<char> buf;
+        char tmp[65536];
+        size_t n;
+        while ((n = fread(tmp, 1, sizeof(tmp), f)) > 0)
+            buf.insert(buf.end(), tmp, tmp + n);
+        fclose(f);
+
+        uint32_t version, byteorder;
+        if (buf.size() < HEADER_SIZE || memcmp(&buf[0], JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0)
+            throw exceptf<>("%s is not an input journal", m_filename.c_str());
+        memcpy(&version, &buf[sizeof(JOURNAL_MAGIC)], sizeof(version));
+        memcpy(&byteorder, &buf[sizeof(JOURNAL_MAGIC) + sizeof(version)], sizeof(byteorder));
+        if (version != JOURNAL_VERSION || byteorder != JOURNAL_BYTEORDER)
+            throw exceptf<>("%s: unsupported journal version or byte order", m_filename.c_str());
+
+        size_t pos = HEADER_SIZE;
+        auto varint = [&]() -> uint64_t {
+            uint64_t v = 0;
+            for (unsigned shift = 0; ; shift += 7)
+            {
+                if (pos >= buf.size() || shift >= 64)
+                    throw exceptf<>("%s: truncated or corrupted journal", m_filename.c_str());
+                unsigned char b = buf[pos++];
+                v |= (uint64_t)(b & 0x7f) << shift;
+                if (!(b & 0x80))
+                    return v;
+            }
+        };
+
+        // The ids in the file are mapped to sources by name.
+        vector<SourceID> ids;
+        while (pos < buf.size())
+        {
+            char kind = buf[pos++];
+            uint64_t id = varint();
+            if (kind == 's')
+            {
+                uint64_t len = varint();
+                if (len > buf.size() - pos)
+                    throw exceptf<>("%s: truncated or corrupted journal", m_filename.c_str());
+                if (id >= ids.size())
+                    ids.resize(id + 1, (SourceID)-1);
+                ids[id] = RegisterSource(string(&buf[pos], len));
+                pos += len;
+            }
+            else if (kind == 'e')
+            {
+                if (id >= ids.size() || ids[id] == (SourceID)-1)
+                    throw exceptf<>("%s: entry for undefined source %llu", m_filename.c_str(), (unsigned long long)id);
+                Entry e;
+                e.cycle = varint();
+                e.size = varint();
+                if (e.size > buf.size() - pos)
+                    throw exceptf<>("%s: truncated or corrupted journal", m_filename.c_str());
+                e.offset = m_data.size();
+                m_data.insert(m_data.end(), &buf[pos], &buf[pos] + e.size);
+                pos += e.size;
+                m_sources[ids[id]].entries.push_back(e);
+            }
+            else
+                throw exceptf<>("%s: unknown record kind %#x", m_filename.c_str(), (unsigned)(unsigned char)kind);
+        }
+    }
+
+    InputJournal::SourceID InputJournal::RegisterSource(const string& name)
+    {
+        auto i = m_names.find(name);
+        if (i != m_names.end())
+        {
+            if (m_mode == RECORD)
+                throw exceptf<InvalidArgumentException>("Input journal source %s registered twice", name.c_str());
+            // In replay mode, the source was defined by the file.
+            return i->second;
+        }
+
+        SourceID id = m_sources.size();
+        m_sources.push_back(Source{name, vector<Entry>(), 0});
+        m_names[name] = id;
+
+        if (m_mode == RECORD)
+        {
+            putc('s', m_file);
+            PutVarint(id);
+            PutVarint(name.size());
+            fwrite(name.data(), 1, name.size(), m_file);
+        }
+        return id;
+    }
+
+    void InputJournal::Record(SourceID src, CycleNo cycle, const void* data, size_t size)
+    {
+        assert(m_mode == RECORD && src < m_sources.size());
+        putc('e', m_file);
+        PutVarint(src);
+        PutVarint(cycle);
+        PutVarint(size);
+        fwrite(data, 1, size, m_file);
+        ++m_entries;
+    }
+
+    const InputJournal::Entry* InputJournal::Next(SourceID src, CycleNo cycle) const
+    {
+        assert(m_mode == REPLAY && src < m_sources.size());
+        const Source& s = m_sources[src];
+        if (s.next >= s.entries.size() || s.entries[s.next].cycle != cycle)
+            return NULL;
+        return &s.entries[s.next];
+    }
+
+    CycleNo InputJournal::GetNextCycle(SourceID src) const
+    {
+        assert(m_mode == REPLAY && src < m_sources.size());
+        const Source& s = m_sources[src];
+        return (s.next < s.entries.size()) ? s.entries[s.next].cycle : INFINITE_CYCLES;
+    }
+
+    void InputJournal::Replay(SourceID src, CycleNo cycle, vector<char>& data)
+    {
+        const Entry* e = Next(src, cycle);
+        if (e == NULL)
+            Diverged(src, cycle, "no entry recorded at this cycle");
+        data.assign(m_data.begin() + e->offset, m_data.begin() + e->offset + e->size);
+        ++m_sources[src].next;
+        ++m_entries;
+    }
+
+    void InputJournal::Diverged(SourceID src, CycleNo cycle, const char* what) const
+    {
+        const Source& s = m_sources[src];
+        CycleNo next = GetNextCycle(src);
+        if (next == INFINITE_CYCLES)
+            throw exceptf<SimulationException>("Replay of %s diverged at cycle %llu: %s (journal exhausted)",
+                                               s.name.c_str(), (unsigned long long)cycle, what);
+        throw exceptf<SimulationException>("Replay of %s diverged at cycle %llu: %s (next entry at cycle %llu)",
+                                           s.name.c_str(), (unsigned long long)cycle, what, (unsigned long long)next);
+    }
+}
@@ -0,0 +1,136 @@
+// -*- c++ -*-
+#ifndef SIM_JOURNAL_H
+#define SIM_JOURNAL_H
+
+#include <sim/kernel.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace Simulator
+{
+    // InputJournal: record and replay of the values that enter the
+    // simulation from the host.
+    //
+    // Components that read external inputs (host streams, wall-clock
+    // time, host system calls) register one source per kind of input.
+    // In record mode, every value they read is appended to the
+    // journal with the cycle at which it was read. In replay mode,
+    // the components take the values from the journal instead of the
+    // host, so that the simulation is exactly reproduced.
+    //
+    // Each source uses the cycle counter of the clock of its
+    // component. The entries of a source must be recorded in cycle
+    // order; several entries can have the same cycle.
+    //
+    // The file starts with a magic number, a format version and a
+    // byte order marker. It then holds records, each starting with a
+    // kind byte:
+    //  - 's': source definition: id, name length, name;
+    //  - 'e': entry: source id, cycle, data size, data.
+    // The integers after the header are unsigned LEB128 varints.
+    class InputJournal
+    {
+    public:
+        enum Mode { RECORD, REPLAY };
+
+        typedef size_t SourceID;
+
+    private:
+        struct Entry
+        {
+            CycleNo cycle;
+            size_t  offset;  ///< Offset of the data in m_data
+            size_t  size;
+        };
+
+        struct Source
+        {
+            std::string        name;
+            std::vector<Entry> entries;  ///< Replay: entries of this source
+            size_t             next;     ///< Replay: index of the next entry
+        };
+
+        Mode                                    m_mode;
+        std::string                             m_filename;
+        FILE*                                   m_file;    ///< Record: output file
+        std::vector<Source>                     m_sources;
+        std::unordered_map<std::string, SourceID> m_names;
+        std::vector<char>                       m_data;    ///< Replay: data of all entries
+        uint64_t                                m_entries; ///< Number of entries recorded or replayed
+
+        void PutVarint(uint64_t value);
+        void Load();
+
+        const Entry* Next(SourceID src, CycleNo cycle) const;
+        [[noreturn]] void Diverged(SourceID src, CycleNo cycle, const char* what) const;
+
+    public:
+        InputJournal(const std::string& filename, Mode mode);
+        ~InputJournal();
+        InputJournal(const InputJournal&) = delete;
+        InputJournal& operator=(const InputJournal&) = delete;
+
+        Mode GetMode() const { return m_mode; }
+        bool IsReplaying() const { return m_mode == REPLAY; }
+        const std::string& GetFileName() const { return m_filename; }
+        uint64_t GetNumEntries() const { return m_entries; }
+
+        // Register a source of inputs. The name must identify the
+        // source across simulation runs.
+        SourceID RegisterSource(const std::string& name);
+
+        // Record: append a value read at the given cycle.
+        void Record(SourceID src, CycleNo cycle, const void* data, size_t size);
+        void Record(SourceID src, CycleNo cycle, const std::vector<char>& data)
+        {
+            Record(src, cycle, data.data(), data.size());
+        }
+        template <typename T>
+        void Record(SourceID src, CycleNo cycle, const T& value)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "journal values must be trivially copyable");
+            Record(src, cycle, &value, sizeof(value));
+        }
+
+        // Replay: cycle of the next entry of a source, or
+        // INFINITE_CYCLES if the source is exhausted.
+        CycleNo GetNextCycle(SourceID src) const;
+
+        // Replay: whether the next entry of a source was recorded at
+        // the given cycle. If so, and if value is given, its value is
+        // copied to value. The entry is not consumed.
+        bool Peek(SourceID src, CycleNo cycle) const { return GetNextCycle(src) == cycle; }
+        template <typename T>
+        bool Peek(SourceID src, CycleNo cycle, T& value) const
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "journal values must be trivially copyable");
+            const Entry* e = Next(src, cycle);
+            if (e == NULL)
+                return false;
+            if (e->size != sizeof(value))
+                Diverged(src, cycle, "entry size does not match");
+            memcpy(&value, &m_data[e->offset], sizeof(value));
+            return true;
+        }
+
+        // Replay: consume the next entry of a source. Throws if it
+        // was not recorded at the given cycle, i.e. the simulation
+        // diverged from the recorded one.
+        void Replay(SourceID src, CycleNo cycle, std::vector<char>& data);
+        template <typename T>
+        void Replay(SourceID src, CycleNo cycle, T& value)
+        {
+            if (!Peek(src, cycle, value))
+                Diverged(src, cycle, "no entry recorded at this cycle");
+            ++m_sources[src].next;
+            ++m_entries;
+        }
+    };
+}
+
+#endif
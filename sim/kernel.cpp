@@ -1,13 +1,13 @@
 #include "kernel.h"
 #include "storage.h"
 #include "sampling.h"
-#include <arch/dev/Display.h>
 
 #include <cassert>
 #include <cstdarg>
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <chrono>
 
 using namespace std;
 
@@ -102,7 +102,36 @@ namespace Simulator
         return *m_clocks.back();
     }
 
+    // Host time in nanoseconds, for profiling.
+    static inline uint64_t HostTime()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    template<bool Profiling>
+    inline Result Kernel::InvokeProcess(Process& process, CyclePhase phase)
+    {
+        if (!Profiling)
+        {
+            return process.m_delegate();
+        }
+
+        uint64_t start = HostTime();
+        Result result = process.m_delegate();
+        process.m_profile.hosttime[phase] += HostTime() - start;
+        ++process.m_profile.calls[phase];
+        return result;
+    }
+
     RunState Kernel::Step(CycleNo cycles)
+    {
+        // The profiling code is compiled into a separate instance
+        // of the simulation loop, so it costs nothing when disabled.
+        return m_profiling ? DoStep<true>(cycles) : DoStep<false>(cycles);
+    }
+
+    template<bool Profiling>
+    RunState Kernel::DoStep(CycleNo cycles)
     {
         try
         {
@@ -114,7 +143,7 @@ namespace Simulator
                 // Update any changed storages.
                 // This is just to effect the initialization writes,
                 // in order to activate the initial processes.
-                UpdateStorages();
+                UpdateStorages<Profiling>();
             }
 
             // Advance time to the first clock to run.
@@ -131,6 +160,10 @@ namespace Simulator
                 // We start each cycle being idle, and see if we did something this cycle
                 idle = true;
 
+                // Are all processes that run this cycle only waiting, and until when?
+                bool    waiting = m_skipIdle;
+                CycleNo wakeup  = INFINITE_CYCLES;
+
                 //
                 // Acquire phase
                 //
@@ -147,7 +180,7 @@ namespace Simulator
                         process->OnBeginCycle();
 
                         // If we fail in the acquire stage, don't bother with the check and commit stages
-                        Result result = process->m_delegate();
+                        Result result = InvokeProcess<Profiling>(*process, PHASE_ACQUIRE);
                         if (result == SUCCESS)
                         {
                             process->m_state = STATE_RUNNING;
@@ -157,6 +190,7 @@ namespace Simulator
                             assert(result == FAILED);
                             process->m_state = STATE_DEADLOCK;
                             ++process->m_stalls;
+                            waiting = false;
                         }
                     }
                 }
@@ -164,6 +198,7 @@ namespace Simulator
                 //
                 // Arbitrate phase
                 //
+                uint64_t start = Profiling ? HostTime() : 0;
                 for (Clock* clock = m_activeClocks; clock != NULL && m_cycle == clock->m_cycle; clock = clock->m_next)
                 {
                     m_clock = clock;
@@ -171,9 +206,14 @@ namespace Simulator
                     {
                         arbitrator->OnArbitrate();
                         arbitrator->Deactivate();
+                        waiting = false;
+                        if (Profiling)
+                            ++m_profile.arbitrations;
                     }
                     clock->m_activeArbitrators = NULL;
                 }
+                if (Profiling)
+                    m_profile.arbitratetime += HostTime() - start;
 
                 //
                 // Commit phase
@@ -188,7 +228,7 @@ namespace Simulator
                             m_process   = process;
                             m_phase     = PHASE_CHECK;
 
-                            Result result = process->m_delegate();
+                            Result result = InvokeProcess<Profiling>(*process, PHASE_CHECK);
                             if (result == SUCCESS)
                             {
                                 // This process is done this cycle.
@@ -198,12 +238,18 @@ namespace Simulator
                                 process->OnEndCycle();
 
                                 m_phase = PHASE_COMMIT;
-                                result = process->m_delegate();
+                                process->m_wakeup = 0;
+                                result = InvokeProcess<Profiling>(*process, PHASE_COMMIT);
 
                                 // If the CHECK succeeded, the COMMIT cannot fail
                                 assert(result == SUCCESS);
                                 process->m_state = STATE_RUNNING;
 
+                                if (process->m_wakeup == 0)
+                                    waiting = false;
+                                else
+                                    wakeup = std::min(wakeup, process->m_wakeup);
+
                                 // We've done something -- we're not idle
                                 idle = false;
                             }
@@ -213,6 +259,7 @@ namespace Simulator
                                 // called in the first place.
                                 assert(result == FAILED);
                                 process->m_state = STATE_DEADLOCK;
+                                waiting = false;
                             }
                         }
                     }
@@ -221,12 +268,16 @@ namespace Simulator
                 // Process the requested storage updates
                 // This can activate or deactivate processes due to changes in storages
                 // made by processes run in this cycle.
-                if (UpdateStorages())
+                if (UpdateStorages<Profiling>())
                 {
                     // We've update at least one storage
                     idle = false;
+                    waiting = false;
                 }
 
+                if (Profiling)
+                    ++m_profile.cycles;
+
                 if (idle)
                 {
                     // We haven't done anything this cycle. Check if there are clocks scheduled
@@ -241,12 +292,33 @@ namespace Simulator
                     }
                 }
 
-                auto dm = DisplayManager::GetManager();
-                if (dm) dm->OnCycle(m_cycle);
+                if (m_cycle >= m_nextHook)
+                    RunCycleHooks();
 
                 if (!idle)
                 {
                     // Advance the simulation
+                    CycleNo resume = m_cycle;
+                    if (waiting && wakeup != INFINITE_CYCLES)
+                    {
+                        // Nothing but waiting happened this cycle, so nothing will
+                        // happen until the first process wakes up, or until another
+                        // clock ticks, or until the end of the step. Reschedule the
+                        // clocks that ran from just before that point.
+                        CycleNo target = std::min(std::min(wakeup, endcycle), m_nextHook);
+                        for (Clock* clock = m_activeClocks; clock != NULL; clock = clock->m_next)
+                        {
+                            if (clock->m_cycle > m_cycle)
+                            {
+                                target = std::min(target, clock->m_cycle);
+                                break;
+                            }
+                        }
+                        if (target > m_cycle + 1)
+                        {
+                            resume = target - 1;
+                        }
+                    }
 
                     // Update the clocks
                     for (Clock *next, *clock = m_activeClocks; clock != NULL && m_cycle == clock->m_cycle; clock = next)
@@ -262,9 +334,10 @@ namespace Simulator
                         if (clock->m_activeProcesses != NULL || clock->m_activeStorages != NULL)
                         {
                             // This clock still has active components, reschedule it
-                            ActivateClock(*clock);
+                            ActivateClock(*clock, resume);
                         }
                     }
+                    m_skipped += resume - m_cycle;
 
                     // Advance time to first clock to run
                     if (m_activeClocks != NULL)
@@ -298,12 +371,64 @@ namespace Simulator
         }
     }
 
-    void Kernel::ActivateClock(Clock& clock)
+    size_t Kernel::AddCycleHook(CycleNo period, CycleHook&& hook)
+    {
+        period = std::max<CycleNo>(period, 1);
+        m_hooks.push_back(PeriodicHook{std::move(hook), period, m_cycle, m_cycle + period});
+        ScheduleCycleHooks();
+        return m_hooks.size() - 1;
+    }
+
+    void Kernel::SetCycleHookPeriod(size_t id, CycleNo period)
+    {
+        PeriodicHook& h = m_hooks[id];
+        h.period = std::max<CycleNo>(period, 1);
+        if (h.hook)
+            h.next = h.last + h.period;
+        ScheduleCycleHooks();
+    }
+
+    void Kernel::RemoveCycleHook(size_t id)
+    {
+        PeriodicHook& h = m_hooks[id];
+        h.hook = CycleHook();
+        h.next = INFINITE_CYCLES;
+        ScheduleCycleHooks();
+    }
+
+    void Kernel::ScheduleCycleHooks()
+    {
+        m_nextHook = INFINITE_CYCLES;
+        for (auto& h : m_hooks)
+            m_nextHook = std::min(m_nextHook, h.next);
+    }
+
+    void Kernel::RunCycleHooks()
+    {
+        // Hooks may change their period or register other hooks, so
+        // the list is indexed rather than iterated over.
+        for (size_t i = 0; i < m_hooks.size(); ++i)
+        {
+            if (m_hooks[i].next <= m_cycle)
+            {
+                m_hooks[i].last = m_cycle;
+                m_hooks[i].next = INFINITE_CYCLES;
+                m_hooks[i].hook(m_cycle);
+
+                PeriodicHook& h = m_hooks[i];
+                if (h.hook)
+                    h.next = h.last + h.period;
+            }
+        }
+        ScheduleCycleHooks();
+    }
+
+    void Kernel::ActivateClock(Clock& clock, CycleNo cycle)
     {
         if (!clock.m_activated)
         {
             // Calculate new activation time for clock
-            clock.m_cycle = (m_cycle / clock.m_period) * clock.m_period + clock.m_period;
+            clock.m_cycle = (cycle / clock.m_period) * clock.m_period + clock.m_period;
 
             // Insert clock into list based on activation time (earliest in front)
             Clock **before = &m_activeClocks, *after = m_activeClocks;
@@ -318,22 +443,34 @@ namespace Simulator
         }
     }
 
+    template<bool Profiling>
     bool Kernel::UpdateStorages()
     {
+        uint64_t start = Profiling ? HostTime() : 0;
         bool updated = false;
         for (Clock* clock = m_activeClocks; clock != NULL && m_cycle == clock->m_cycle; clock = clock->m_next)
         {
-            for (Storage *s = clock->m_activeStorages; s != NULL; s = s->GetNext())
+            for (StorageBatch *b = clock->m_activeStorages; b != NULL; b = b->m_next)
             {
-                s->Update();
-                s->Deactivate();
+                size_t n = b->Update();
                 updated = true;
+                if (Profiling)
+                    m_profile.updates += n;
             }
             clock->m_activeStorages = NULL;
         }
+        if (Profiling)
+            m_profile.updatetime += HostTime() - start;
         return updated;
     }
 
+    void Kernel::ResetProfile()
+    {
+        m_profile = KernelProfile();
+        for (auto p : m_proc_registry)
+            p->m_profile = ProcessProfile();
+    }
+
 
     void Kernel::SetDebugMode(int flags)
     {
@@ -348,6 +485,7 @@ namespace Simulator
     void
     Kernel::RegisterProcess(Process& p)
     {
+        SetupGuard guard(*this);
         m_proc_registry.insert(&p);
     }
 
@@ -365,10 +503,25 @@ namespace Simulator
           m_suspended(false),
           m_config(NULL),
           m_var_registry(),
-          m_proc_registry()
+          m_proc_registry(),
+          m_debugTrace(NULL),
+          m_journal(NULL),
+          m_random(),
+          m_profiling(false),
+          m_skipIdle(true),
+          m_skipped(0),
+          m_profile(),
+          m_arena(),
+          m_hooks(),
+          m_nextHook(INFINITE_CYCLES)
+#ifdef ENABLE_PARALLEL_SETUP
+        , m_setup_mutex(),
+          m_concurrent_setup(false)
+#endif
     {
         m_var_registry.RegisterVariable(m_cycle, "kernel.cycle", SVC_CUMULATIVE);
         m_var_registry.RegisterVariable(m_phase, "kernel.phase", SVC_STATE);
+        m_var_registry.RegisterVariable(m_skipped, "kernel.skipped", SVC_CUMULATIVE);
     }
 
     Kernel::~Kernel()
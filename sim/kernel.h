@@ -5,6 +5,7 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <random>
 #include <cassert>
 
 // Dependencies of Kernel.
@@ -13,6 +14,8 @@
 #include "sim/delegate.h"
 #include "sim/storagetrace.h"
 #include "sim/sampling.h"
+#include "sim/setuplock.h"
+#include "sim/arena.h"
 
 // Other classes that users of Kernel expect to see defined too.
 #include "sim/clock.h"
@@ -38,6 +41,28 @@ namespace Simulator
      * The kernel class is the manager for all components in the simulation. It advances
      * time, calls the cycle callbacks on all components, initiates arbitration and more.
      */
+    class DebugTrace;
+    class InputJournal;
+
+    /**
+     * @brief Host-side profile of the work done by the kernel itself,
+     * outside of the processes.
+     */
+    struct KernelProfile
+    {
+        uint64_t cycles;        ///< Number of master cycles simulated while profiling
+        uint64_t arbitrations;  ///< Number of arbitrator invocations
+        uint64_t arbitratetime; ///< Host time in arbitration, in nanoseconds
+        uint64_t updates;       ///< Number of storage updates
+        uint64_t updatetime;    ///< Host time in storage updates, in nanoseconds
+    };
+
+    /**
+     * @brief Host-side callback run periodically by the kernel, with
+     * the current master cycle. See Kernel::AddCycleHook.
+     */
+    typedef delegate_gen<void, CycleNo> CycleHook;
+
     class Kernel
     {
 
@@ -77,8 +102,37 @@ public:
         Config*             m_config;       ///< Attached configuration object.
         VariableRegistry    m_var_registry; ///< Attached variable registry.
         std::set<Process*>  m_proc_registry; ///< Set of all processes instantiated.
+        DebugTrace*         m_debugTrace;   ///< Binary recorder for debug output, if any.
+        InputJournal*       m_journal;      ///< Record/replay of external inputs, if any.
+        std::mt19937        m_random;       ///< Pseudo-random numbers used by the model.
+        bool                m_profiling;    ///< Profile the host time of the processes?
+        bool                m_skipIdle;     ///< Skip ahead over cycles where all processes wait?
+        CycleNo             m_skipped;      ///< Number of master cycles skipped ahead.
+        KernelProfile       m_profile;      ///< Host time profile of the kernel.
+        Arena               m_arena;        ///< Host memory for the state arrays of the components.
+
+        struct PeriodicHook
+        {
+            CycleHook hook;     ///< The callback, empty if removed.
+            CycleNo   period;   ///< Master cycles between calls.
+            CycleNo   last;     ///< Master cycle of the last call.
+            CycleNo   next;     ///< Master cycle of the next call.
+        };
+        std::vector<PeriodicHook> m_hooks;  ///< Registered periodic hooks.
+        CycleNo             m_nextHook;     ///< Master cycle at which the first hook is due.
+#ifdef ENABLE_PARALLEL_SETUP
+        SetupMutex          m_setup_mutex;  ///< Protects the shared structures during parallel setup.
+        bool                m_concurrent_setup; ///< Are components being constructed concurrently?
+#endif
 
+        template<bool Profiling>
         bool UpdateStorages();
+        template<bool Profiling>
+        RunState DoStep(CycleNo cycles);
+        template<bool Profiling>
+        static Result InvokeProcess(Process& process, CyclePhase phase);
+        void RunCycleHooks();
+        void ScheduleCycleHooks();
 
 #ifdef STATIC_KERNEL
         static Kernel* g_kernel;
@@ -101,6 +155,13 @@ public:
         VariableRegistry& GetVariableRegistry() { return m_var_registry; }
         const VariableRegistry& GetVariableRegistry() const { return m_var_registry; }
 
+        /**
+         * @brief The host memory for the large state arrays of the
+         * components, which lives as long as the kernel.
+         */
+        Arena& GetArena() { return m_arena; }
+        const Arena& GetArena() const { return m_arena; }
+
         /**
          * @brief Register a process for introspection.
          */
@@ -111,10 +172,47 @@ public:
          */
         const std::set<Process*>& GetAllProcesses() const { return m_proc_registry; };
 
+        /**
+         * @brief Indicate whether components are being constructed from
+         * multiple host threads. While set, SetupGuard serializes changes
+         * to the clocks, the process registry and the object tree.
+         */
+#ifdef ENABLE_PARALLEL_SETUP
+        void SetConcurrentSetup(bool enable) { m_concurrent_setup = enable; }
+#else
+        void SetConcurrentSetup(bool) {}
+#endif
+
+        /**
+         * @brief Scoped lock on the kernel's shared structures, only taken
+         * during concurrent setup.
+         */
+        class SetupGuard
+        {
+#ifdef ENABLE_PARALLEL_SETUP
+            std::unique_lock<std::recursive_mutex> m_lock;
+        public:
+            explicit SetupGuard(Kernel& k)
+                : m_lock(k.m_setup_mutex, std::defer_lock)
+            {
+                if (k.m_concurrent_setup)
+                    m_lock.lock();
+            }
+#else
+        public:
+            explicit SetupGuard(Kernel&) {}
+#endif
+        };
+
         /**
          * @brief Activate a clock to run in the next cycle.
          */
-        void ActivateClock(Clock& clock);
+        void ActivateClock(Clock& clock) { ActivateClock(clock, m_cycle); }
+
+        /**
+         * @brief Activate a clock to run at its first tick after master cycle @a cycle.
+         */
+        void ActivateClock(Clock& clock, CycleNo cycle);
 
         /**
          * @brief Creates a clock at the specified frequency (in MHz).
@@ -136,6 +234,50 @@ public:
          */
         inline Process* GetActiveProcess() const { return m_process; }
 
+        /**
+         * @brief Declares that the active process is only waiting.
+         * A process calls this in a cycle where it does nothing but wait
+         * for its clock to reach tick @a cycle, for example for a fixed
+         * latency to elapse. It must not have any other effect in such a
+         * cycle. When all the processes that run in a cycle only wait, the
+         * kernel skips ahead to the earliest cycle declared, or to the
+         * next tick of another clock if that comes first.
+         * @param cycle the tick of the active clock to wait for.
+         */
+        inline void WaitUntil(CycleNo cycle) { m_process->m_wakeup = cycle * m_clock->m_period; }
+
+        /**
+         * @brief Enables or disables skipping ahead over waiting cycles.
+         */
+        void SetSkipIdle(bool enable) { m_skipIdle = enable; }
+
+        /**
+         * @brief Get the number of master cycles skipped ahead so far.
+         */
+        CycleNo GetSkippedCycles() const { return m_skipped; }
+
+        /**
+         * @brief Registers a host-side hook, e.g. to poll a user interface
+         * or to report progress.
+         * The hook is called after the first simulated cycle at or after
+         * every @a period master cycles. The kernel does not skip ahead
+         * past a due hook. Between calls, hooks have no cost.
+         * @param period the number of master cycles between calls (at least 1).
+         * @param hook the callback.
+         * @return an identifier for SetCycleHookPeriod and RemoveCycleHook.
+         */
+        size_t AddCycleHook(CycleNo period, CycleHook&& hook);
+
+        /**
+         * @brief Changes the period of a hook, counted from its last call.
+         */
+        void SetCycleHookPeriod(size_t id, CycleNo period);
+
+        /**
+         * @brief Unregisters a hook.
+         */
+        void RemoveCycleHook(size_t id);
+
         /**
          * @brief Get the currently scheduled processes
          */
@@ -173,6 +315,60 @@ public:
          */
         inline int GetDebugMode() const { return m_debugMode; }
 
+        /**
+         * Redirects debug output to a binary trace.
+         * @param trace the trace recorder, or NULL to print debug output as text.
+         */
+        void SetDebugTrace(DebugTrace* trace) { m_debugTrace = trace; }
+
+        /**
+         * Gets the binary trace recorder for debug output.
+         * @return the trace recorder, or NULL if debug output is printed as text.
+         */
+        inline DebugTrace* GetDebugTrace() const { return m_debugTrace; }
+
+        /**
+         * Sets the journal where components record their external
+         * inputs, or from which they replay them.
+         * @param journal the journal, or NULL to use the host inputs.
+         */
+        void SetInputJournal(InputJournal* journal) { m_journal = journal; }
+
+        /**
+         * Gets the journal of external inputs.
+         * @return the journal, or NULL if inputs are taken from the host.
+         */
+        inline InputJournal* GetInputJournal() const { return m_journal; }
+
+        /**
+         * Seeds the pseudo-random number generator of the model. Each
+         * kernel has its own generator, so that a simulation only
+         * depends on its own seed.
+         * @param seed the seed, usually RandomSeed from the configuration.
+         */
+        void SeedRandom(unsigned seed) { m_random.seed(seed); }
+
+        /**
+         * Gets the pseudo-random number generator of the model.
+         */
+        std::mt19937& GetRandom() { return m_random; }
+
+        /**
+         * @brief Enables or disables host time profiling.
+         * When enabled, Step() counts the invocations of every process
+         * and measures the host time spent in them. When disabled, Step()
+         * runs without any profiling code.
+         */
+        void SetProfiling(bool enable) { m_profiling = enable; }
+        bool IsProfiling() const { return m_profiling; }
+
+        /**
+         * @brief Clears the profile of the kernel and of all processes.
+         */
+        void ResetProfile();
+
+        const KernelProfile& GetProfile() const { return m_profile; }
+
         /**
          * @brief Advances the simulation.
          * Advances the simulation by the specified number of cycles. It will abort early if
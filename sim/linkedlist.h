@@ -26,6 +26,7 @@ namespace Simulator
         DefineStateVariable(T   , last);   ///< Last item of the list being pushed (when m_pushed)
 
         void Update() override;
+        friend class TypedStorageBatch<LinkedList>;
 
     public:
         /// Is the list empty?
@@ -120,6 +120,7 @@ namespace Simulator
         RegisterStateObject(m_tail, "tail");
         RegisterStateObject(m_first, "first");
         RegisterStateObject(m_last, "last");
+        SetUpdateType(*this);
     }
 
 
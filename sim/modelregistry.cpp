@@ -20,6 +20,7 @@ ComponentModelRegistry::Entity::operator<(const ComponentModelRegistry::Entity&
 ComponentModelRegistry::ComponentModelRegistry()
     : m_symbols(),
       m_objects(),
+      m_setup_mutex(),
       m_entities(),
       m_objprops(),
       m_linkprops(),
@@ -103,6 +104,7 @@ void
 ComponentModelRegistry::registerObject(const Object& obj,
                                        const string& type)
 {
+    SetupLock lock(m_setup_mutex);
     assert(m_objects.find(&obj) == m_objects.end()
            || m_objects.find(&obj)->second == makeSymbol(type));
     m_objects[&obj] = makeSymbol(type);
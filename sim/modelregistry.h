@@ -3,6 +3,7 @@
 #define MODEL_REGISTRY_H
 
 #include "sim/kernel.h"
+#include "sim/setuplock.h"
 #include "programs/mgsim.h"
 
 #include <ostream>
@@ -73,6 +74,10 @@ protected:
     // the component graph. See uses of registerObject() for examples.
     std::map<ObjectRef, Symbol>         m_objects;
 
+    // m_setup_mutex: serializes registrations when components are
+    // constructed from multiple host threads.
+    Simulator::SetupMutex               m_setup_mutex;
+
 public:
     // Register an object with a logical type.
     void registerObject(const Simulator::Object& obj,
@@ -135,6 +140,7 @@ public:
     void registerProperty(const Simulator::Object& obj,
                           const std::string& name)
     {
+        Simulator::SetupLock lock(m_setup_mutex);
         m_objprops[refObject(obj)]
             .push_back(std::make_pair(makeSymbol(name),
                                       refEntity()));
@@ -145,6 +151,7 @@ public:
                           const std::string& name,
                           const T& value)
     {
+        Simulator::SetupLock lock(m_setup_mutex);
         m_objprops[refObject(obj)]
             .push_back(std::make_pair(makeSymbol(name),
                                       refEntity(value)));
@@ -167,6 +174,7 @@ public:
                           const std::string& name,
                           bool sibling = false, bool bidi = false)
     {
+        Simulator::SetupLock lock(m_setup_mutex);
         m_linkprops[std::make_pair(refObject(left),
                                    std::make_pair(refObject(right),
                                                   std::make_pair(sibling,
@@ -202,6 +210,7 @@ public:
                                 const T& value,
                                 bool sibling = false, bool bidi = false)
     {
+        Simulator::SetupLock lock(m_setup_mutex);
         m_linkprops[std::make_pair(refObject(left),
                                    std::make_pair(refObject(right),
                                                   std::make_pair(sibling,
@@ -271,6 +280,7 @@ ComponentModelRegistry::registerTaggedRelation<Simulator::Object>(const Simulato
                                                                   bool sibling,
                                                                   bool bidi)
 {
+    Simulator::SetupLock lock(m_setup_mutex);
     m_linkprops[std::make_pair(refObject(left),
                                std::make_pair(refObject(right),
                                               std::make_pair(sibling,
@@ -1,5 +1,8 @@
 #include <cstdio>
+#include <cassert>
+#include <algorithm>
 #include "sim/kernel.h"
+#include "sim/debugtrace.h"
 
 namespace Simulator
 {
@@ -27,6 +30,7 @@ namespace Simulator
           m_children()
     {
         // Add ourself to the parent's children array
+        Kernel::SetupGuard guard(*GetKernel());
         parent.m_children.push_back(this);
     }
 
@@ -46,6 +50,14 @@ namespace Simulator
         }
     }
 
+    void Object::ReorderChildren(const std::vector<Object*>& order)
+    {
+        assert(order.size() <= m_children.size());
+        auto first = m_children.end() - order.size();
+        assert(std::is_permutation(first, m_children.end(), order.begin()));
+        std::copy(order.begin(), order.end(), first);
+    }
+
     void Object::OutputWrite_(const char* msg, ...) const
     {
         va_list args;
@@ -61,6 +73,15 @@ namespace Simulator
     {
         va_list args;
 
+        DebugTrace *trace = GetKernel()->GetDebugTrace();
+        if (trace != NULL)
+        {
+            va_start(args, msg);
+            trace->Record(DebugTrace::REC_DEADLOCK, GetKernel()->GetCycleNo(), *this, GetKernel()->GetActiveProcess(), msg, args);
+            va_end(args);
+            return;
+        }
+
         fprintf(stderr, "[%08lld:%s]\t(%s)\td ", (unsigned long long)GetKernel()->GetCycleNo(), GetName().c_str(),
                 GetKernel()->GetActiveProcess()->GetName().c_str());
         va_start(args, msg);
@@ -73,6 +94,15 @@ namespace Simulator
     {
         va_list args;
 
+        DebugTrace *trace = GetKernel()->GetDebugTrace();
+        if (trace != NULL)
+        {
+            va_start(args, msg);
+            trace->Record(DebugTrace::REC_DEBUG, GetKernel()->GetCycleNo(), *this, GetKernel()->GetActiveProcess(), msg, args);
+            va_end(args);
+            return;
+        }
+
         fprintf(stderr, "[%08lld:%s]\t", (unsigned long long)GetKernel()->GetCycleNo(), GetName().c_str());
         const Process *p = GetKernel()->GetActiveProcess();
         if (p)
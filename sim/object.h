@@ -69,6 +69,13 @@ namespace Simulator
         unsigned int       GetNumChildren() const { return (unsigned int)m_children.size(); }
         /// Get a child of the object. @param i the index of the child. @return the child at index i.
         Object*            GetChild(int i)  const { return m_children[i]; }
+        /**
+         * @brief Restore the order of the last children of the object.
+         * Used after children were constructed concurrently.
+         * @param order the expected order of the last children; must be
+         * a permutation of the last order.size() children.
+         */
+        void ReorderChildren(const std::vector<Object*>& order);
         /// Get the object fully qualified name. @return the object name.
         const std::string& GetName()   const { return m_name; }
 
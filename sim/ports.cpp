@@ -1,5 +1,6 @@
 #include "ports.h"
 #include "sampling.h"
+#include "ctz.h"
 #include <sstream>
 #include <algorithm>
 
@@ -18,40 +19,57 @@ namespace Simulator
                                                  SVC_CUMULATIVE);
     }
 
-    SimpleArbitratedPort::SimpleArbitratedPort(Kernel& k, const string& name)
-        : ArbitratedPort(k, name),
-          m_processes(),
+    ArbitrationSet::ArbitrationSet()
+        : m_processes(),
+          m_slots(),
           m_requests(),
-          m_lastrequest()
+          m_lastrequest(),
+          m_count(0)
     {
     }
 
-    void SimpleArbitratedPort::AddProcess(const Process& process)
+    size_t ArbitrationSet::Add(const Process& process)
     {
-        assert(find(m_processes.begin(),
-                    m_processes.end(),
-                    &process) == m_processes.end());
+        assert(Find(process) == m_processes.size());
+        size_t slot = m_processes.size();
         m_processes.push_back(&process);
+        m_slots[&process] = slot;
+        m_lastrequest.push_back(0);
+        if (m_requests.size() * WORD_BITS < m_processes.size())
+            m_requests.push_back(0);
+        return slot;
     }
 
-    void SimpleArbitratedPort::AddRequest(const Process& process, CycleNo c)
+    size_t ArbitrationSet::FindRequest(size_t from) const
     {
-	auto p = find(m_requests.begin(),
-		      m_requests.end(),
-		      &process);
-        if (p != m_requests.end())
+        if (m_count == 0)
+            return m_processes.size();
+
+        // Search from the given slot to the end, then wrap around
+        // and search from the start up to the given slot.
+        const size_t nwords = m_requests.size();
+        size_t i = from / WORD_BITS;
+        Word w = m_requests[i] & (~Word(0) << (from % WORD_BITS));
+        for (size_t n = 0; n <= nwords; ++n)
         {
-            // A process can request more than once in an arbitrator cycle
-            // if the requester is in a higher frequency domain than the
-            // arbitrator.
-            // However the same process cannot request more than once
-            // in the same cycle.
-	    auto lastreq = m_lastrequest[p - m_requests.begin()];
-            assert(c != lastreq);
-            return;
+            if (w != 0)
+                return i * WORD_BITS + ctzll(w);
+            i = (i + 1 == nwords) ? 0 : i + 1;
+            w = m_requests[i];
         }
-        m_requests.push_back(&process);
-        m_lastrequest.push_back(c);
+        assert(false);
+        return m_processes.size();
+    }
+
+    SimpleArbitratedPort::SimpleArbitratedPort(Kernel& k, const string& name)
+        : ArbitratedPort(k, name),
+          m_processes()
+    {
+    }
+
+    void SimpleArbitratedPort::AddProcess(const Process& process)
+    {
+        m_processes.Add(process);
     }
 
     PriorityArbitratedPort::PriorityArbitratedPort(Kernel& k,
@@ -64,31 +82,11 @@ namespace Simulator
     void PriorityArbitratedPort::Arbitrate()
     {
         SetSelectedProcess(NULL);
-        if (m_requests.empty()) return;
+        if (m_processes.Empty()) return;
 
-        if (m_requests.size() == 1)
-        {
-            // Optimization for common case
-            SetSelectedProcess(*m_requests.begin());
-        }
-        else
-        {
-            // Choose the request with the highest priority
-            auto min = m_processes.size();
-            for (auto i : m_requests)
-            {
-                // The position in the vector is its priority
-                size_t priority = find(m_processes.begin(), m_processes.end(), i) - m_processes.begin();
-                if (priority < min)
-                {
-                    min = priority;
-                    SetSelectedProcess(i);
-                }
-            }
-        }
-        assert(GetSelectedProcess() != NULL);
-        m_requests.clear();
-	m_lastrequest.clear();
+        // The slot of a process is its priority
+        SetSelectedProcess(m_processes[m_processes.FindRequest(0)]);
+        m_processes.Clear();
         MarkBusy();
     }
 
@@ -108,44 +106,13 @@ namespace Simulator
         assert(m_lastSelected < m_processes.size());
 
         SetSelectedProcess(NULL);
-        if (m_requests.empty()) return;
-
-        if (m_requests.size() == 1)
-        {
-            SetSelectedProcess(*m_requests.begin());
-            m_lastSelected = find(m_processes.begin(),
-                                  m_processes.end(),
-                                  GetSelectedProcess()) - m_processes.begin();
-        }
-        else
-        {
-            auto sz = m_processes.size();
-            auto min = sz;
-            for (auto i : m_requests)
-            {
-                // pos = position of the requesting process in the
-                // list of all processes.
-                auto pos = find(m_processes.begin(),
-                                m_processes.end(),
-                                i) - m_processes.begin();
+        if (m_processes.Empty()) return;
 
-                // Compute the distance between the requesting process
-                // and the last selected.
-                auto d = (pos + sz - m_lastSelected) % sz;
-                if (d != 0 && d < min)
-                {
-                    // Different process, shortest distance, select
-                    // this one.
-                    min = d;
-                    SetSelectedProcess(i);
-                }
-            }
-            // Remember which one we selected
-            m_lastSelected = (m_lastSelected + min) % sz;
-        }
-        assert(GetSelectedProcess() != NULL);
-        m_requests.clear();
-	m_lastrequest.clear();
+        // Select the first requesting process after the last
+        // selected one, and remember it for the next round.
+        m_lastSelected = m_processes.FindRequest((m_lastSelected + 1) % m_processes.size());
+        SetSelectedProcess(m_processes[m_lastSelected]);
+        m_processes.Clear();
         MarkBusy();
     }
 
@@ -158,73 +125,25 @@ namespace Simulator
     void PriorityCyclicArbitratedPort::Arbitrate()
     {
         SetSelectedProcess(NULL);
-        if (m_requests.empty()) return;
-
-        if (m_requests.size() == 1)
+        if (!m_processes.Empty())
         {
-            // Optimization for common case
-            SetSelectedProcess(*m_requests.begin());
-
-            // If we just selected a cyclic process, remember it for
-            // the next round of cyclic arbitration.
-            size_t maybe_cyclic_last = find(m_cyclicprocesses.begin(),
-                                            m_cyclicprocesses.end(),
-                                            GetSelectedProcess()) - m_cyclicprocesses.begin();
-            if (maybe_cyclic_last < m_cyclicprocesses.size())
-                m_lastSelected = maybe_cyclic_last;
+            // First try to select using priorities.
+            SetSelectedProcess(m_processes[m_processes.FindRequest(0)]);
+        }
+        else if (!m_cyclicprocesses.Empty())
+        {
+            // No priority process requested, select the next cyclic
+            // process and remember it for the next round of cyclic
+            // arbitration.
+            m_lastSelected = m_cyclicprocesses.FindRequest((m_lastSelected + 1) % m_cyclicprocesses.size());
+            SetSelectedProcess(m_cyclicprocesses[m_lastSelected]);
         }
         else
         {
-            // First try to select using priorities.
-            auto sz = m_processes.size();
-            auto min = sz;
-            for (auto i : m_requests)
-            {
-                // The position in the vector is its priority
-                size_t priority = find(m_processes.begin(), m_processes.end(), i) - m_processes.begin();
-                if (priority == sz)
-                {
-                    // this request is for a cyclic process, don't use
-                    // it as a candidate.
-                    continue;
-                }
-                if (priority < min)
-                {
-                    min = priority;
-                    SetSelectedProcess(i);
-                }
-            }
-
-            if (min == sz)
-            {
-                // no priority process found, the request is for a
-                // cyclic process.
-                min = sz = m_cyclicprocesses.size();
-                for (auto i : m_requests)
-                {
-                    // pos = position of the requesting process in the
-                    // list of all processes.
-                    auto pos = find(m_cyclicprocesses.begin(),
-                                    m_cyclicprocesses.end(),
-                                    i) - m_cyclicprocesses.begin();
-
-                    // Find the distance between the requesting process
-                    // and the last selected
-                    auto d = (pos + sz - m_lastSelected) % sz;
-                    if (d != 0 && d < min)
-                    {
-                        // Different process, shortest distance,
-                        // select this one.
-                        min = d;
-                        SetSelectedProcess(i);
-                    }
-                }
-                // Remember which one we selected
-                m_lastSelected = (m_lastSelected + min) % sz;
-            }
+            return;
         }
-        assert(GetSelectedProcess() != NULL);
-        m_requests.clear();
+        m_processes.Clear();
+        m_cyclicprocesses.Clear();
         MarkBusy();
     }
 
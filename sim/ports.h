@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <map>
 #include <set>
+#include <unordered_map>
 #include <limits>
 
 namespace Simulator
@@ -62,6 +63,93 @@ namespace Simulator
         const std::string& GetName() const { return m_name; }
     };
 
+    //
+    // ArbitrationSet: the processes that may access an arbitrated
+    // port, and those that have requested access within this cycle.
+    //
+    // Each process registered with the port gets a dense slot number,
+    // in order of registration. The requests are kept as a bitmap
+    // over the slots, so that selecting a requester in priority or
+    // round-robin order is a find-first-set over a few words instead
+    // of a search through the list of processes.
+    //
+    class ArbitrationSet
+    {
+        typedef uint64_t Word;
+        static const size_t WORD_BITS = 64;
+
+        // Up to this number of processes, slots are looked up by
+        // scanning the list rather than through the hash table.
+        static const size_t LINEAR_LOOKUP = 8;
+
+        std::vector<const Process*>                m_processes;   ///< Registered processes, by slot
+        std::unordered_map<const Process*, size_t> m_slots;       ///< Slot of each process
+        std::vector<Word>                          m_requests;    ///< Bitmap of requests, by slot
+        std::vector<CycleNo>                       m_lastrequest; ///< Cycle of the last request, by slot
+        size_t                                     m_count;       ///< Number of requests
+
+    public:
+        // The number of registered processes.
+        size_t size() const { return m_processes.size(); }
+
+        // The process in the given slot.
+        const Process* operator[](size_t slot) const { return m_processes[slot]; }
+
+        // Return the slot of a process, or size() if it is not registered.
+        size_t Find(const Process& process) const
+        {
+            if (m_processes.size() <= LINEAR_LOOKUP)
+            {
+                return std::find(m_processes.begin(), m_processes.end(), &process) - m_processes.begin();
+            }
+            auto p = m_slots.find(&process);
+            return (p == m_slots.end()) ? m_processes.size() : p->second;
+        }
+
+        // Register a process; returns its slot.
+        size_t Add(const Process& process);
+
+        // Register a request from the process in the given slot.
+        void Request(size_t slot, CycleNo c)
+        {
+            Word& w = m_requests[slot / WORD_BITS];
+            const Word bit = Word(1) << (slot % WORD_BITS);
+            if (w & bit)
+            {
+                // A process can request more than once in an arbitrator cycle
+                // if the requester is in a higher frequency domain than the
+                // arbitrator.
+                // However the same process cannot request more than once
+                // in the same cycle.
+                assert(c != m_lastrequest[slot]);
+                return;
+            }
+            w |= bit;
+            m_lastrequest[slot] = c;
+            ++m_count;
+        }
+
+        // The number of requests within this cycle.
+        size_t Count() const { return m_count; }
+        bool Empty() const { return m_count == 0; }
+
+        // Return the first requesting slot at or after the given slot,
+        // wrapping around, or size() if there are no requests.
+        size_t FindRequest(size_t from) const;
+
+        // Forget all requests.
+        void Clear()
+        {
+            if (m_count != 0)
+            {
+                std::fill(m_requests.begin(), m_requests.end(), 0);
+                m_count = 0;
+            }
+        }
+
+        ArbitrationSet();
+    };
+
     //
     // SimpleArbitratedPort: simple base class for ports using a
     // simple list of processes.
@@ -73,17 +161,9 @@ namespace Simulator
     class SimpleArbitratedPort : public ArbitratedPort
     {
     protected:
-        typedef std::vector<const Process*> ProcessList;
-
-        // The list of all processes that *may* access the port.
-        ProcessList    m_processes;
-
-        // The list of all processes that have requested access within
-        // this cycle.
-        ProcessList    m_requests;
-
-        // The last cycle counter of a request.
-	std::vector<CycleNo>        m_lastrequest;
+        // The processes that *may* access the port, and those that
+        // have requested access within this cycle.
+        ArbitrationSet m_processes;
 
     public:
         // Register a process that may access the port.
@@ -93,14 +173,15 @@ namespace Simulator
         // Test if a process may access the port.
         bool CanAccess(const Process& process) const
         {
-            return std::find(m_processes.begin(),
-                             m_processes.end(),
-                             &process) != m_processes.end();
+            return m_processes.Find(process) != m_processes.size();
         }
 
         // Register a process as wanting to access the port (candidate for
         // arbitration).
-        void AddRequest(const Process& process, CycleNo c);
+        void AddRequest(const Process& process, CycleNo c)
+        {
+            m_processes.Request(m_processes.Find(process), c);
+        }
 
         // Constructor, destructor etc.
         SimpleArbitratedPort(Kernel&, const std::string& name);
@@ -176,14 +257,22 @@ namespace Simulator
     {
     protected:
         // The set of cyclic processes (that have lowest priority)
-        ProcessList m_cyclicprocesses;
+        ArbitrationSet m_cyclicprocesses;
 
         // Test if a process may access the port.
         bool CanAccess(const Process& process) const {
             return SimpleArbitratedPort::CanAccess(process)
-                || (std::find(m_cyclicprocesses.begin(),
-                              m_cyclicprocesses.end(),
-                              &process) != m_cyclicprocesses.end());
+                || m_cyclicprocesses.Find(process) != m_cyclicprocesses.size();
+        }
+
+        // Register a process as wanting to access the port.
+        void AddRequest(const Process& process, CycleNo c)
+        {
+            size_t slot = m_processes.Find(process);
+            if (slot != m_processes.size())
+                m_processes.Request(slot, c);
+            else
+                m_cyclicprocesses.Request(m_cyclicprocesses.Find(process), c);
         }
 
     private:
@@ -199,7 +288,7 @@ namespace Simulator
             SimpleArbitratedPort::AddProcess(process);
         }
         void AddCyclicProcess(const Process& process) {
-            m_cyclicprocesses.push_back(&process);
+            m_cyclicprocesses.Add(process);
         }
 
     protected:
@@ -35,7 +35,9 @@ namespace Simulator
           m_activations(0),
           m_next(0),
           m_pPrev(0),
-          m_stalls(0)
+          m_stalls(0),
+          m_wakeup(0),
+          m_profile()
 #if !defined(NDEBUG) && !defined(DISABLE_TRACE_CHECKS)
         , m_storages(),
           m_currentStorages()
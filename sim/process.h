@@ -46,6 +46,18 @@ namespace Simulator
     // Forward declaration
     class Object;
 
+    // Host-side profile of a process: the number of invocations of its
+    // delegate and the host time spent in it, for each cycle phase
+    // (indexed by CyclePhase). Only filled in while the kernel profiles.
+    struct ProcessProfile
+    {
+        uint64_t calls[3];    ///< Number of invocations per phase
+        uint64_t hosttime[3]; ///< Host time in nanoseconds per phase
+
+        uint64_t GetCalls() const { return calls[0] + calls[1] + calls[2]; }
+        uint64_t GetHostTime() const { return hosttime[0] + hosttime[1] + hosttime[2]; }
+    };
+
     // Processes are member variables in components and represent the information
     // about a single process in that component.
     class Process
@@ -61,6 +73,8 @@ namespace Simulator
         Process**         m_pPrev;         ///< Prev pointer in the list of processes that require updates
 
         uint64_t          m_stalls;        ///< Number of times the process stalled (failed).
+        CycleNo           m_wakeup;        ///< Master cycle the process waits for, if declared in its last commit (0 otherwise).
+        ProcessProfile    m_profile;       ///< Host time profile of this process.
 
 #if !defined(NDEBUG) && !defined(DISABLE_TRACE_CHECKS)
         StorageTraceSet   m_storages;         ///< Set of storage traces this process can have
@@ -79,6 +93,8 @@ namespace Simulator
         const Process* GetNext() const { return m_next;  }
         RunState GetState() const { return m_state; }
         const std::string& GetName() const { return m_name; }
+        uint64_t GetStalls() const { return m_stalls; }
+        const ProcessProfile& GetProfile() const { return m_profile; }
 
         // Deactivate a process from receiving invocations from its
         // clock. Used by storages (cf storage.h) when they become empty.
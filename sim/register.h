@@ -21,6 +21,7 @@ namespace Simulator
     protected:
         // Update: update the register between cycles.
         void Update() override;
+        friend class TypedStorageBatch<Register>;
 
     public:
         // Empty: returns true iff the register is currently empty.
@@ -99,6 +99,7 @@ namespace Simulator
     {
         RegisterStateObject(m_cur, "cur");
         RegisterStateObject(m_new, "new");
+        SetUpdateType(*this);
     }
 
 }
@@ -0,0 +1,159 @@
+// -*- c++ -*-
+#ifndef SIM_RINGQUEUE_H
+#define SIM_RINGQUEUE_H
+
+#include "sim/log2.h"
+#include "sim/serialization.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <deque>
+#include <iterator>
+#include <memory>
+
+namespace Simulator
+{
+    /// The FIFO queue behind Buffer<T>.
+    //
+    // When the capacity is bounded, the items are stored in a single
+    // allocation used as a ring of a power-of-two size, so that
+    // pushes and pops do not allocate and indexing is a mask. An
+    // unbounded capacity ((size_t)-1), or one too large to allocate
+    // up front, uses a std::deque instead.
+    template <typename T>
+    class RingQueue
+    {
+        // Largest ring allocated up front, in items.
+        static const size_t MAX_RING_SIZE = 65536;
+
+        std::unique_ptr<T[]> m_ring;   ///< The ring, if bounded
+        size_t               m_mask;   ///< Size of the ring minus one
+        size_t               m_head;   ///< Index in the ring of the front item
+        size_t               m_size;   ///< Number of items in the ring
+        std::deque<T>        m_deque;  ///< The items, if unbounded
+
+        template <typename Q, typename V>
+        class iterator_base
+        {
+            Q*     m_queue;
+            size_t m_pos;
+
+        public:
+            typedef std::bidirectional_iterator_tag iterator_category;
+            typedef T                               value_type;
+            typedef std::ptrdiff_t                  difference_type;
+            typedef V*                              pointer;
+            typedef V&                              reference;
+
+            reference operator*()  const { return (*m_queue)[m_pos]; }
+            pointer   operator->() const { return &(*m_queue)[m_pos]; }
+
+            iterator_base& operator++() { ++m_pos; return *this; }
+            iterator_base& operator--() { --m_pos; return *this; }
+            iterator_base operator++(int) { iterator_base r(*this); ++m_pos; return r; }
+            iterator_base operator--(int) { iterator_base r(*this); --m_pos; return r; }
+
+            bool operator==(const iterator_base& rhs) const { return m_pos == rhs.m_pos && m_queue == rhs.m_queue; }
+            bool operator!=(const iterator_base& rhs) const { return !(*this == rhs); }
+
+            iterator_base() : m_queue(NULL), m_pos(0) {}
+            iterator_base(Q& queue, size_t pos) : m_queue(&queue), m_pos(pos) {}
+        };
+
+    public:
+        typedef iterator_base<RingQueue, T>             iterator;
+        typedef iterator_base<const RingQueue, const T> const_iterator;
+        typedef std::reverse_iterator<const_iterator>   const_reverse_iterator;
+
+        bool   empty() const { return size() == 0; }
+        size_t size()  const { return m_ring ? m_size : m_deque.size(); }
+
+        T& operator[](size_t i)
+        {
+            assert(i < size());
+            return m_ring ? m_ring[(m_head + i) & m_mask] : m_deque[i];
+        }
+
+        const T& operator[](size_t i) const
+        {
+            assert(i < size());
+            return m_ring ? m_ring[(m_head + i) & m_mask] : m_deque[i];
+        }
+
+        const T& front() const { return (*this)[0]; }
+
+        void push_back(T&& item)
+        {
+            if (!m_ring) {
+                m_deque.push_back(std::move(item));
+                return;
+            }
+            assert(m_size <= m_mask);
+            m_ring[(m_head + m_size) & m_mask] = std::move(item);
+            ++m_size;
+        }
+
+        void pop_front()
+        {
+            if (!m_ring) {
+                m_deque.pop_front();
+                return;
+            }
+            assert(m_size > 0);
+            // Release what the item holds, as the deque would.
+            m_ring[m_head] = T();
+            m_head = (m_head + 1) & m_mask;
+            --m_size;
+        }
+
+        // Used for deserialization.
+        void resize(size_t size)
+        {
+            if (!m_ring) {
+                m_deque.resize(size);
+                return;
+            }
+            assert(size <= m_mask + 1);
+            for (size_t i = std::min(size, m_size); i < std::max(size, m_size); ++i)
+                m_ring[(m_head + i) & m_mask] = T();
+            m_size = size;
+        }
+
+        iterator               begin()        { return iterator(*this, 0); }
+        iterator               end()          { return iterator(*this, size()); }
+        const_iterator         begin()  const { return const_iterator(*this, 0); }
+        const_iterator         end()    const { return const_iterator(*this, size()); }
+        const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+        const_reverse_iterator rend()   const { return const_reverse_iterator(begin()); }
+
+        explicit RingQueue(size_t capacity)
+            : m_ring(),
+              m_mask(0),
+              m_head(0),
+              m_size(0),
+              m_deque()
+        {
+            if (capacity <= MAX_RING_SIZE)
+            {
+                size_t size = (size_t)1 << ilog2(std::max<size_t>(capacity, 1));
+                m_ring.reset(new T[size]);
+                m_mask = size - 1;
+            }
+        }
+
+        RingQueue(const RingQueue&) = delete;
+        RingQueue& operator=(const RingQueue&) = delete;
+    };
+
+    namespace Serialization
+    {
+        // Serialized as a std::deque, so that the format does not
+        // depend on the backend.
+        template<typename T>
+        struct serialize_trait<RingQueue<T> >
+            : public container_serializer<RingQueue<T>, 'q'> {};
+    }
+}
+
+#endif
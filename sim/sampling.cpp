@@ -10,7 +10,7 @@ using namespace std;
 namespace Simulator
 {
     VariableRegistry::VariableRegistry()
-        : m_registry()
+        : m_registry(), m_setup_mutex()
     {}
 
     void VariableRegistry::RegisterVariable(void *var, const string& name,
@@ -19,6 +19,8 @@ namespace Simulator
                                             size_t width, void *maxval,
                                             serializer_func_t ser)
     {
+        SetupLock lock(m_setup_mutex);
+
         if (m_registry.find(name) != m_registry.end())
             throw exceptf<>("Duplicate variable registration: %s",
                             name.c_str());
@@ -8,6 +8,7 @@
 
 #include <sim/serialization.h>
 #include <sim/streamserializer.h>
+#include <sim/setuplock.h>
 
 namespace Simulator
 {
@@ -44,6 +45,7 @@ namespace Simulator
 
         typedef std::map<std::string, VarInfo> var_registry_t;
         var_registry_t m_registry;
+        SetupMutex     m_setup_mutex;
 
         const var_registry_t& GetRegistry() const { return m_registry; }
 
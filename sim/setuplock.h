@@ -0,0 +1,44 @@
+// -*- c++ -*-
+#ifndef SETUPLOCK_H
+#define SETUPLOCK_H
+
+#include <sim/types.h>
+
+// Locks protecting the shared registries (configuration, variables,
+// component model, process and clock lists) while components are
+// constructed from multiple host threads. See --enable-parallel-setup.
+// When the feature is not configured these compile to nothing.
+
+#ifdef ENABLE_PARALLEL_SETUP
+#include <mutex>
+
+namespace Simulator
+{
+    // A recursive mutex that can be embedded in copyable registries;
+    // copies get their own, unlocked, mutex.
+    class SetupMutex : public std::recursive_mutex
+    {
+    public:
+        SetupMutex() : std::recursive_mutex() {}
+        SetupMutex(const SetupMutex&) : std::recursive_mutex() {}
+        SetupMutex& operator=(const SetupMutex&) { return *this; }
+    };
+
+    typedef std::lock_guard<std::recursive_mutex> SetupLock;
+}
+
+#else
+
+namespace Simulator
+{
+    struct SetupMutex {};
+
+    struct SetupLock
+    {
+        explicit SetupLock(SetupMutex&) {}
+    };
+}
+
+#endif
+
+#endif
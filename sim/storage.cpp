@@ -1,4 +1,5 @@
 #include "sim/storage.h"
+#include <atomic>
 #include <cctype>
 
 using namespace std;
@@ -27,9 +28,25 @@ namespace Simulator
         return r;
     }
 
+    size_t StorageBatch::NewTypeIndex()
+    {
+        static std::atomic<size_t> next(0);
+        return next++;
+    }
+
+    StorageBatch::StorageBatch(Clock& clock)
+        : m_next(NULL),
+          m_clock(clock),
+          m_storages()
+    {}
+
+    StorageBatch::~StorageBatch()
+    {}
+
     Storage::Storage(const std::string& name, Object& parent, Clock& clock)
         : Object(name, parent),
-          m_next(NULL),
+          m_batch(NULL),
+          m_self(NULL),
           m_clock(clock),
           InitStateVariable(activated, false)
     {}
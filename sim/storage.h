@@ -6,14 +6,66 @@
 #include <sim/kernel.h>
 #include <sim/sampling.h>
 
+#include <vector>
+
 namespace Simulator
 {
+    class Storage;
+
+    /// The storages of one concrete type that require updates on a
+    /// clock.
+    //
+    // Kernel::UpdateStorages updates the active storages batch by
+    // batch, so that the update of a storage is a direct call, which
+    // can be inlined, in a loop over a contiguous array of pointers.
+    class StorageBatch
+    {
+        friend class Kernel;
+
+        StorageBatch*      m_next;     ///< Next batch in the list of batches that require updates
+        Clock&             m_clock;    ///< The clock that governs the storages
+
+    protected:
+        std::vector<void*> m_storages; ///< The storages to update, as pointers to their concrete type
+
+    public:
+        // Push: queue a storage for the update round of this cycle.
+        void Push(void* storage);
+
+        // Update: update and deactivate the queued storages.
+        // Returns the number of storages updated.
+        virtual size_t Update() = 0;
+
+        // Used for introspection of the active storages.
+        const StorageBatch* GetNext() const { return m_next; }
+        size_t GetSize() const { return m_storages.size(); }
+        virtual const Storage& GetStorage(size_t i) const = 0;
+
+        // Allocate a new index for Clock::GetStorageBatch.
+        static size_t NewTypeIndex();
+
+        StorageBatch(Clock& clock);
+        virtual ~StorageBatch();
+        StorageBatch(const StorageBatch&) = delete;
+        StorageBatch& operator=(const StorageBatch&) = delete;
+    };
+
+    template<typename S>
+    class TypedStorageBatch : public StorageBatch
+    {
+    public:
+        size_t Update() override;
+        const Storage& GetStorage(size_t i) const override;
+
+        TypedStorageBatch(Clock& clock) : StorageBatch(clock) {}
+    };
 
     /// A storage element that needs cycle-accurate update semantics
     class Storage
         : public virtual Object
     {
-        Storage*              m_next;         ///< Next pointer in the list of storages that require updates
+        StorageBatch*         m_batch;        ///< The batch that updates this storage
+        void*                 m_self;         ///< This storage, as a pointer to its concrete type
         Clock&                m_clock;        ///< The clock that governs this storage
         DefineStateVariable(bool, activated); ///< Has the storage already been activated this cycle?
 
@@ -30,15 +82,18 @@ namespace Simulator
         // before the next clock cycle.
         void RegisterUpdate();
 
-    public:
-        // Retrieve the next storage that requires updates.
-        const Storage* GetNext() const { return m_next; }
-        Storage* GetNext() { return m_next; }
+        // SetUpdateType: select the batch that updates this storage.
+        // Must be called by the constructor of every concrete
+        // storage type S, which must declare TypedStorageBatch<S> as
+        // a friend if its Update() is not public.
+        template<typename S>
+        void SetUpdateType(S& self);
 
+    public:
         // Accessor for the clock that governs this storage.
         Clock& GetClock() const { return m_clock; }
 
-        // Used in Kernel::UpdateStorages.
+        // Used in StorageBatch::Update.
         void Deactivate() { m_activated = false; }
         virtual void Update() = 0;
 
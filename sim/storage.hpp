@@ -28,10 +28,67 @@ namespace Simulator
     void Storage::RegisterUpdate()
     {
         if (!m_activated) {
-            m_next = GetClock().ActivateStorage(*this);
+            assert(m_batch != NULL);
+            m_batch->Push(m_self);
             m_activated = true;
         }
     }
+
+    template<typename S>
+    inline
+    void Storage::SetUpdateType(S& self)
+    {
+        m_batch = &GetClock().GetStorageBatch<S>();
+        m_self  = &self;
+    }
+
+    inline
+    void StorageBatch::Push(void* storage)
+    {
+        Kernel::SetupGuard guard(m_clock.GetKernel());
+        if (m_storages.empty()) {
+            m_next = m_clock.ActivateStorageBatch(*this);
+        }
+        m_storages.push_back(storage);
+    }
+
+    template<typename S>
+    size_t TypedStorageBatch<S>::Update()
+    {
+        // The storages are not activated again during the update, so
+        // the array is stable.
+        for (void* p : m_storages)
+        {
+            S& s = *static_cast<S*>(p);
+            s.S::Update();
+            s.Storage::Deactivate();
+        }
+        size_t n = m_storages.size();
+        m_storages.clear();
+        return n;
+    }
+
+    template<typename S>
+    const Storage& TypedStorageBatch<S>::GetStorage(size_t i) const
+    {
+        return *static_cast<const S*>(m_storages[i]);
+    }
+
+    template<typename S>
+    StorageBatch& Clock::GetStorageBatch()
+    {
+        // One index per storage type, shared by all clocks.
+        static const size_t index = StorageBatch::NewTypeIndex();
+
+        Kernel::SetupGuard guard(GetKernel());
+        if (index >= m_batches.size()) {
+            m_batches.resize(index + 1, NULL);
+        }
+        if (m_batches[index] == NULL) {
+            m_batches[index] = new TypedStorageBatch<S>(*this);
+        }
+        return *m_batches[index];
+    }
 }
 
 
@@ -0,0 +1,31 @@
+#! /bin/bash
+# Measure the simulator startup cost as a function of the number of cores.
+#
+# Usage: bench-startup.sh SIM CONFIG PROGRAM "CORES..." "THREADS..."
+#
+# For every core count and setup thread count, runs SIM with -n (exit
+# after the system is configured) and prints one line with the wall
+# time of the whole process and the instantiation costs reported by
+# the simulator (wall time, user time, resident set size).
+set -e
+sim=${1:?}
+cfg=${2:?}
+prog=${3:?}
+cores=${4:?}
+threads=${5:-1}
+
+printf "%8s %8s %12s %12s %12s %12s\n" cores threads total_ms setup_ms user_ms rss_kib
+for n in $cores; do
+  for t in $threads; do
+    start=$(date +%s%N)
+    out=$("$sim" -c "$cfg" -i -n -o NumProcessors=$n -o NumSetupThreads=$t $SIMARGS "$prog" 2>&1) || {
+        echo "$out" >&2
+        echo "$0: $sim failed for NumProcessors=$n NumSetupThreads=$t" >&2
+        exit 1
+    }
+    end=$(date +%s%N)
+    costs=$(echo "$out" | sed -n -e 's/^Instantiation costs: \([0-9]*\) us wall, \([0-9]*\) us user, \([0-9-]*\) KiB.*/\1 \2 \3/p')
+    set -- $costs
+    printf "%8d %8d %12d %12d %12d %12d\n" $n $t $(( (end - start) / 1000000 )) $(( ${1:-0} / 1000 )) $(( ${2:-0} / 1000 )) ${3:-0}
+  done
+done
@@ -0,0 +1,179 @@
+#! /usr/bin/env python
+# Host throughput benchmark over the test programs.
+#
+# Runs the simulator over a matrix of programs x memory types x core
+# counts, records the simulation speed, memory usage and startup time
+# in a JSON file and optionally compares the results against a
+# previously recorded baseline.
+
+import os
+import re
+import sys
+import json
+import time
+import getopt
+import platform
+import subprocess
+
+def usage():
+    sys.stdout.write("""Usage: %s [OPTIONS...] PROGRAMS...
+
+Options:
+  -s SIM        Simulator to run (default: ./mgsim)
+  -c FILE       Configuration file (default: programs/config.ini)
+  -m MEMORIES   Memory types, space-separated (default: serial parallel banked ddr cdma zlcdma)
+  -n CORES      Core counts, space-separated (default: 1 4 16)
+  -r N          Repeat each run N times and keep the fastest (default: 1)
+  -o FILE       Write the results to FILE (default: bench.json)
+  -b FILE       Compare the results against the baseline in FILE
+  -t PERCENT    Tolerance for the comparison (default: 10)
+
+Extra simulator arguments can be passed via the SIMARGS environment
+variable. The exit status is 1 if a run failed or a regression was
+found, 0 otherwise.
+""" % sys.argv[0])
+    sys.exit(0)
+
+def log(msg):
+    sys.stderr.write("%s\n" % msg)
+
+sim = './mgsim'
+cfg = 'programs/config.ini'
+memories = 'serial parallel banked ddr cdma zlcdma'.split()
+cores = [1, 4, 16]
+repeat = 1
+outfile = 'bench.json'
+basefile = None
+tolerance = 10.0
+(opts, programs) = getopt.getopt(sys.argv[1:], 's:c:m:n:r:o:b:t:h')
+for (o, val) in opts:
+    if o == '-s': sim = val
+    elif o == '-c': cfg = val
+    elif o == '-m': memories = val.split()
+    elif o == '-n': cores = [int(x) for x in val.split()]
+    elif o == '-r': repeat = max(1, int(val))
+    elif o == '-o': outfile = val
+    elif o == '-b': basefile = val
+    elif o == '-t': tolerance = float(val)
+    elif o == '-h': usage()
+if not programs:
+    usage()
+simargs = os.environ.get('SIMARGS', '').split()
+
+# Statistics printed by the simulator at the end of the simulation.
+stats = {
+    'cycles':       re.compile(r'^(\d+)\s+# master cycle counter', re.M),
+    'instructions': re.compile(r'^(\d+)\s+# total executed instructions', re.M),
+    'rss_kib':      re.compile(r'^(\d+)\s+# maximum resident set size', re.M),
+}
+
+def markers(prog):
+    """Return the PLACES and TEST_INPUTS markers embedded in a test
+    program, as used by tools/runtest.sh."""
+    places = None
+    inputs = []
+    f = open(prog, 'rb')
+    data = f.read().decode('latin-1')
+    f.close()
+    m = re.search(r'PLACES:([0-9 ]*)', data)
+    if m:
+        places = [int(x) for x in m.group(1).split()]
+    m = re.search(r'TEST_INPUTS:(\w+):([0-9 ]*)', data)
+    if m and m.group(2).split():
+        inputs = ['-' + m.group(1), m.group(2).split()[0]]
+    return (places, inputs)
+
+def run(args):
+    start = time.time()
+    p = subprocess.Popen(args, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    out = p.communicate()[0].decode('utf-8', 'replace')
+    return (p.returncode, time.time() - start, out)
+
+def measure(prog, mem, ncores, extra):
+    base = [sim, '-c', cfg, '-o', 'MemoryType=%s' % mem, '-o', 'NumProcessors=%d' % ncores] + simargs + extra
+    best = None
+    for i in range(repeat):
+        # Startup: configure the system and exit.
+        (rc, startup, out) = run(base + ['-n', prog])
+        if rc != 0:
+            return (None, out)
+        (rc, wall, out) = run(base + ['-t', prog])
+        if rc != 0:
+            return (None, out)
+        r = {}
+        for (k, pat) in stats.items():
+            m = pat.search(out)
+            if m is None:
+                return (None, out)
+            r[k] = int(m.group(1))
+        r['startup_s'] = startup
+        r['run_s'] = max(wall - startup, 1e-6)
+        if best is None or r['run_s'] < best['run_s']:
+            best = r
+    best['cycles_per_s'] = best['cycles'] / best['run_s']
+    best['instructions_per_s'] = best['instructions'] / best['run_s']
+    return (best, None)
+
+def key(r):
+    return '%s:%s:%d' % (r['program'], r['memory'], r['cores'])
+
+results = []
+failed = False
+for prog in programs:
+    (places, extra) = markers(prog)
+    for mem in memories:
+        for ncores in cores:
+            if places is not None and ncores not in places:
+                continue
+            desc = '%s %s %d' % (prog, mem, ncores)
+            (r, err) = measure(prog, mem, ncores, extra)
+            if r is None:
+                log('%s: FAILED' % desc)
+                log(err)
+                failed = True
+                continue
+            r.update({'program': os.path.basename(prog), 'memory': mem, 'cores': ncores})
+            log('%s: %.0f cycles/s, %.0f instructions/s, %d KiB, startup %.3f s' %
+                (desc, r['cycles_per_s'], r['instructions_per_s'], r['rss_kib'], r['startup_s']))
+            results.append(r)
+
+doc = {
+    'version': 1,
+    'date': time.strftime('%Y-%m-%dT%H:%M:%S'),
+    'host': platform.node(),
+    'simulator': sim,
+    'config': cfg,
+    'results': results,
+}
+f = open(outfile, 'w')
+json.dump(doc, f, indent=1, sort_keys=True)
+f.write('\n')
+f.close()
+log('Results written to %s.' % outfile)
+
+if basefile is not None:
+    f = open(basefile)
+    base = dict((key(r), r) for r in json.load(f)['results'])
+    f.close()
+
+    # Measures where higher is better (+1) or lower is better (-1).
+    measures = [('cycles_per_s', 1), ('instructions_per_s', 1), ('rss_kib', -1), ('startup_s', -1)]
+    regressions = 0
+    for r in results:
+        b = base.get(key(r))
+        if b is None:
+            continue
+        if r['cycles'] != b['cycles']:
+            log('%s: note: simulated cycles changed from %d to %d' % (key(r), b['cycles'], r['cycles']))
+        for (m, sign) in measures:
+            if not b[m]:
+                continue
+            change = 100. * (r[m] - b[m]) / b[m]
+            if sign * change < -tolerance:
+                log('%s: REGRESSION: %s %g -> %g (%+.1f%%)' % (key(r), m, b[m], r[m], change))
+                regressions += 1
+    log('%d regression(s) against %s (tolerance %g%%).' % (regressions, basefile, tolerance))
+    if regressions:
+        failed = True
+
+sys.exit(1 if failed else 0)